@@ -0,0 +1,480 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include <Columnar.hpp>
+#include <Document.hpp>
+#include <PaddedReadStream.hpp>
+#include <Patch.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include <alloc_counter.hpp>
+
+using namespace mudong;
+
+// Reader/Writer内部热点函数的微基准。Reader的parse*为私有函数，
+// 这里通过只含对应元素的小文档与空Handler间接测量，额外开销仅为一次parse()调用。
+namespace {
+
+struct NullHandler {
+    bool Null()                    { return true; }
+    bool Bool(bool)                { return true; }
+    bool Int32(int32_t)            { return true; }
+    bool Int64(int64_t)            { return true; }
+    bool Double(double)            { return true; }
+    bool String(std::string_view)  { return true; }
+    bool Key(std::string_view)     { return true; }
+    bool StartObject()             { return true; }
+    bool EndObject()               { return true; }
+    bool StartArray()              { return true; }
+    bool EndArray()                { return true; }
+};
+
+// 以逗号分隔的count个元素组成的数组，元素由gen(i)生成
+template <typename Gen>
+std::string makeArray(int64_t count, Gen&& gen) {
+    std::string json = "[";
+    for (int64_t i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        json += gen(i);
+    }
+    json += "]";
+    return json;
+}
+
+void parseWith(benchmark::State& s, const std::string& json, int64_t items) {
+    NullHandler handler;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        json::PaddedReadStream is(json);
+        if (json::Reader::parse(is, handler) != json::ParseError::PARSE_OK) {
+            s.SkipWithError("parse failed");
+            break;
+        }
+    }
+    alloc_counter::report(s, scope);
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(json.size()));
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations()) * items);
+}
+
+std::mt19937_64 rng(42);
+
+// ---- Reader::parseNumber ----
+
+void BM_parseNumber_int(benchmark::State& s) {
+    std::uniform_int_distribution<int32_t> dist;
+    parseWith(s, makeArray(s.range(0), [&](int64_t) { return std::to_string(dist(rng)); }), s.range(0));
+}
+
+void BM_parseNumber_int64(benchmark::State& s) {
+    std::uniform_int_distribution<int64_t> dist;
+    parseWith(s, makeArray(s.range(0), [&](int64_t) { return std::to_string(dist(rng)); }), s.range(0));
+}
+
+void BM_parseNumber_double(benchmark::State& s) {
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    char buf[32];
+    parseWith(s, makeArray(s.range(0), [&](int64_t) {
+        std::snprintf(buf, sizeof(buf), "%.17g", dist(rng));
+        return std::string(buf);
+    }), s.range(0));
+}
+
+void BM_parseNumber_exponent(benchmark::State& s) {
+    std::uniform_real_distribution<double> mant(1, 10);
+    std::uniform_int_distribution<int> exp(-300, 300);
+    char buf[32];
+    parseWith(s, makeArray(s.range(0), [&](int64_t) {
+        std::snprintf(buf, sizeof(buf), "%.6fe%d", mant(rng), exp(rng));
+        return std::string(buf);
+    }), s.range(0));
+}
+
+// ---- Reader::parseString，参数为字符串长度 ----
+
+void BM_parseString_ascii(benchmark::State& s) {
+    std::string json = "\"" + std::string(static_cast<size_t>(s.range(0)), 'a') + "\"";
+    parseWith(s, json, 1);
+}
+
+void BM_parseString_escapes(benchmark::State& s) {
+    std::string body;
+    while (body.size() < static_cast<size_t>(s.range(0))) body += "ab\\n\\\"\\\\";
+    parseWith(s, "\"" + body + "\"", 1);
+}
+
+void BM_parseString_unicode(benchmark::State& s) {
+    std::string body;
+    while (body.size() < static_cast<size_t>(s.range(0))) body += "\\u4e2d\\u6587\\ud83d\\ude00";
+    parseWith(s, "\"" + body + "\"", 1);
+}
+
+// ---- Reader::parseWhiteSpace，参数为空白字符个数 ----
+
+void BM_parseWhiteSpace(benchmark::State& s) {
+    std::string ws;
+    static const char chars[] = " \n\t\r";
+    for (int64_t i = 0; i < s.range(0); i++) ws += chars[i % 4];
+    parseWith(s, ws + "0" + ws, 1);
+}
+
+// ---- Writer ----
+
+void BM_Writer_Double(benchmark::State& s) {
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::vector<double> values(static_cast<size_t>(s.range(0)));
+    for (auto& d: values) d = dist(rng);
+    json::StringWriteStream os;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        json::Writer writer(os);
+        writer.StartArray();
+        for (double d: values) writer.Double(d);
+        writer.EndArray();
+        benchmark::DoNotOptimize(os.take());
+    }
+    alloc_counter::report(s, scope);
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations()) * s.range(0));
+}
+
+void BM_Writer_String(benchmark::State& s) {
+    // 参数1为是否含需要转义的字符
+    std::string str(static_cast<size_t>(s.range(0)), 'a');
+    if (s.range(1))
+        for (size_t i = 0; i < str.size(); i += 8) str[i] = i % 16 == 0 ? '"' : '\n';
+    json::StringWriteStream os;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        json::Writer writer(os);
+        writer.String(str);
+        benchmark::DoNotOptimize(os.take());
+    }
+    alloc_counter::report(s, scope);
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * s.range(0));
+}
+
+// ---- itoa/countDigits，参数为十进制位数 ----
+
+std::vector<int64_t> numbersWithDigits(int64_t digits) {
+    int64_t lo = 1;
+    for (int64_t i = 1; i < digits; i++) lo *= 10;
+    int64_t hi = digits >= 19 ? std::numeric_limits<int64_t>::max() : lo * 10 - 1;
+    std::uniform_int_distribution<int64_t> dist(digits == 1 ? 0 : lo, hi);
+    std::vector<int64_t> v(1024);
+    for (auto& x: v) x = dist(rng);
+    return v;
+}
+
+void BM_countDigits(benchmark::State& s) {
+    auto values = numbersWithDigits(s.range(0));
+    for (auto _: s) {
+        unsigned sum = 0;
+        for (int64_t x: values) sum += json::countDigits(static_cast<uint64_t>(x));
+        benchmark::DoNotOptimize(sum);
+    }
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations() * values.size()));
+}
+
+void BM_itoa(benchmark::State& s) {
+    auto values = numbersWithDigits(s.range(0));
+    char buf[32];
+    for (auto _: s) {
+        for (int64_t x: values) {
+            benchmark::DoNotOptimize(json::itoa(x, buf));
+            benchmark::ClobberMemory();
+        }
+    }
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations() * values.size()));
+}
+
+// ---- Value ----
+
+json::Value makeObject(int64_t members) {
+    json::Value obj(json::ValueType::TYPE_OBJECT);
+    for (int64_t i = 0; i < members; i++)
+        obj.addMember(json::Value("key_" + std::to_string(i)), json::Value(static_cast<int32_t>(i)));
+    return obj;
+}
+
+void BM_findMember(benchmark::State& s) {
+    json::Value obj = makeObject(s.range(0));
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < s.range(0); i++) keys.push_back("key_" + std::to_string(i));
+    std::shuffle(keys.begin(), keys.end(), rng);
+    size_t i = 0;
+    for (auto _: s) {
+        benchmark::DoNotOptimize(obj.findMember(keys[i]));
+        if (++i == keys.size()) i = 0;
+    }
+}
+
+// 在结构相同的记录中按key逐条查找最后一个成员。参数0为查找方式：0为字符串，1为KeyHandle；
+// 参数1为是否以setSharedKeys()解析
+void BM_findMember_records(benchmark::State& s) {
+    std::string json = "[";
+    for (int i = 0; i < 4096; i++) {
+        if (i > 0) json += ",";
+        json += "{";
+        for (int k = 0; k < 12; k++) json += "\"field_" + std::to_string(k) + "\":" + std::to_string(k) + ",";
+        json += "\"price\":" + std::to_string(i) + "}";
+    }
+    json += "]";
+    json::Document doc;
+    doc.setSharedKeys(s.range(1) != 0);
+    doc.parse(json);
+    const json::Value& records = doc;
+
+    json::KeyHandle price("price");
+    for (auto _: s) {
+        int64_t sum = 0;
+        if (s.range(0) == 0)
+            for (auto& record: records.getArray()) sum += record["price"].getInt32();
+        else
+            for (auto& record: records.getArray()) sum += record[price].getInt32();
+        benchmark::DoNotOptimize(sum);
+    }
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations()) * 4096);
+}
+
+// 参数为数组元素个数，每个元素为含4个成员的对象
+json::Value makeTree(int64_t elements) {
+    json::Value arr(json::ValueType::TYPE_ARRAY);
+    for (int64_t i = 0; i < elements; i++) {
+        json::Value obj(json::ValueType::TYPE_OBJECT);
+        obj.addMember("id", static_cast<int32_t>(i));
+        obj.addMember("name", "name");
+        obj.addMember("price", 1.5);
+        obj.addMember("ok", true);
+        arr.addValue(std::move(obj));
+    }
+    return arr;
+}
+
+// Value拷贝只增加引用计数，与子树大小无关
+void BM_Value_copy(benchmark::State& s) {
+    json::Value tree = makeTree(s.range(0));
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        json::Value copy(tree);
+        benchmark::DoNotOptimize(copy);
+    }
+    alloc_counter::report(s, scope);
+}
+
+// 释放整棵树，构建不计时
+void BM_Value_destroy(benchmark::State& s) {
+    size_t frees = 0;
+    for (auto _: s) {
+        s.PauseTiming();
+        auto* tree = new json::Value(makeTree(s.range(0)));
+        size_t before = alloc_counter::counters.frees;
+        s.ResumeTiming();
+        delete tree;
+        frees += alloc_counter::counters.frees - before;
+    }
+    s.counters["frees/op"] = static_cast<double>(frees) / static_cast<double>(s.iterations());
+    s.SetItemsProcessed(static_cast<int64_t>(s.iterations()) * s.range(0));
+}
+
+// ---- 以预先序列化的片段组装信封，参数为片段中的元素个数 ----
+
+std::string makeFragment(int64_t elements) {
+    json::StringWriteStream os;
+    json::Writer writer(os);
+    makeTree(elements).writeTo(writer);
+    return os.take();
+}
+
+template <typename Embed>
+void envelopeWith(benchmark::State& s, Embed&& embed) {
+    std::string fragment = makeFragment(s.range(0));
+    json::StringWriteStream os;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        json::Value envelope(json::ValueType::TYPE_OBJECT);
+        envelope.addMember("status", "ok");
+        envelope.addMember(json::Value("data"), embed(fragment));
+        json::Writer writer(os);
+        envelope.writeTo(writer);
+        benchmark::DoNotOptimize(os.take());
+    }
+    alloc_counter::report(s, scope);
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(fragment.size()));
+}
+
+// 解析片段后随信封重新序列化
+void BM_envelope_parsed(benchmark::State& s) {
+    envelopeWith(s, [](const std::string& fragment) {
+        json::Document doc;
+        doc.parse(fragment);
+        return json::Value(std::move(doc));
+    });
+}
+
+// 片段作为原始值原样拷贝
+void BM_envelope_raw(benchmark::State& s) {
+    envelopeWith(s, [](const std::string& fragment) { return json::Value::raw(fragment); });
+}
+
+// ---- JSON Patch，参数为数组元素个数与是否原子执行 ----
+
+// 每次替换一个元素的一个成员，路径上的容器只在首次修改或被共享时复制
+void BM_patch_replace(benchmark::State& s) {
+    json::Value tree = makeTree(s.range(0));
+    std::vector<json::Value> patches;
+    for (int64_t i = 0; i < 64; i++) {
+        json::Value op(json::ValueType::TYPE_OBJECT);
+        op.addMember("op", "replace");
+        op.addMember(json::Value("path"), json::Value("/" + std::to_string(i * s.range(0) / 64) + "/price"));
+        op.addMember("value", static_cast<double>(i));
+        json::Value patch(json::ValueType::TYPE_ARRAY);
+        patch.addValue(std::move(op));
+        patches.push_back(std::move(patch));
+    }
+    bool atomic = s.range(1) != 0;
+    size_t i = 0;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        if (json::Patch::apply(tree, patches[i], atomic) != json::PatchError::PATCH_OK) {
+            s.SkipWithError("patch failed");
+            break;
+        }
+        if (++i == patches.size()) i = 0;
+    }
+    alloc_counter::report(s, scope);
+}
+
+// ---- 紧凑数值数组，参数为每个数组的元素个数与是否紧凑存储 ----
+
+// 解析64个浮点数组并求和，bytes/op反映建树占用的内存
+void BM_parse_numericArrays(benchmark::State& s) {
+    std::string json = "[";
+    for (int64_t i = 0; i < 64; i++) {
+        json += i > 0 ? ",[" : "[";
+        for (int64_t j = 0; j < s.range(0); j++) {
+            if (j > 0) json += ",";
+            json += std::to_string(static_cast<double>(i * j) + 0.25);
+        }
+        json += "]";
+    }
+    json += "]";
+    bool packed = s.range(1) != 0;
+    json::Document doc;
+    doc.setPackedArrays(packed);
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        doc.parse(json);
+        const json::Value& root = doc;
+        double sum = 0;
+        for (size_t i = 0; i < root.getSize(); i++) {
+            if (packed) {
+                for (double d: root[i].getDoubles()) sum += d;
+            }
+            else {
+                for (auto& v: root[i].getArray()) sum += v.getDouble();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    alloc_counter::report(s, scope);
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(json.size()));
+}
+
+// ---- 按列抽取NDJSON记录，参数为方式：0为逐行Document再取字段，1为ColumnarBuilder，2为其4线程版本 ----
+
+void BM_columnar_lines(benchmark::State& s) {
+    std::string text;
+    for (int i = 0; i < 20000; i++) {
+        text += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",\"b\"],\"price\":" + std::to_string(i) +
+                ".25,\"user\":{\"name\":\"user" + std::to_string(i) + "\",\"level\":3},\"note\":null}\n";
+    }
+    std::vector<json::ColumnSpec> specs = {
+        {"/id", json::ColumnType::COLUMN_INT64},
+        {"/price", json::ColumnType::COLUMN_DOUBLE},
+        {"/user/name", json::ColumnType::COLUMN_STRING},
+    };
+    for (auto _: s) {
+        if (s.range(0) == 0) {
+            std::vector<int64_t> ids;
+            std::vector<double> prices;
+            std::string names;
+            json::Document doc;
+            std::string_view rest = text;
+            while (!rest.empty()) {
+                size_t end = rest.find('\n');
+                doc.parse(rest.substr(0, end));
+                ids.push_back(doc["id"].getInt64());
+                prices.push_back(doc["price"].getDouble());
+                names.append(doc["user"]["name"].getStringView());
+                rest.remove_prefix(end + 1);
+            }
+            benchmark::DoNotOptimize(names.size() + ids.size() + prices.size());
+        }
+        else {
+            json::ColumnarBuilder builder(specs);
+            builder.parseLines(text, s.range(0) == 1 ? 1 : 4);
+            benchmark::DoNotOptimize(builder.getRows());
+        }
+    }
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(text.size()));
+}
+
+// ---- 首尾相接的多个文档，参数为方式：0为自行按行切分后逐个parse()，1为DocumentStream ----
+
+void BM_documentStream(benchmark::State& s) {
+    std::string text;
+    for (int i = 0; i < 10000; i++)
+        text += "{\"seq\":" + std::to_string(i) + ",\"level\":\"info\",\"msg\":\"request done\",\"ms\":" +
+                std::to_string(i % 97) + ".5}\n";
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        size_t count = 0;
+        if (s.range(0) == 0) {
+            json::Document doc;
+            std::string_view rest = text;
+            while (!rest.empty()) {
+                size_t end = rest.find('\n');
+                if (doc.parse(rest.substr(0, end)) == json::ParseError::PARSE_OK) count++;
+                rest.remove_prefix(end + 1);
+            }
+        }
+        else {
+            json::DocumentStream stream(text);
+            for (auto& doc: stream) {
+                benchmark::DoNotOptimize(&doc);
+                count++;
+            }
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    alloc_counter::report(s, scope);
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(text.size()));
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_parseNumber_int)->Range(8, 4096);
+BENCHMARK(BM_parseNumber_int64)->Range(8, 4096);
+BENCHMARK(BM_parseNumber_double)->Range(8, 4096);
+BENCHMARK(BM_parseNumber_exponent)->Range(8, 4096);
+BENCHMARK(BM_parseString_ascii)->Range(8, 1 << 16);
+BENCHMARK(BM_parseString_escapes)->Range(8, 1 << 16);
+BENCHMARK(BM_parseString_unicode)->Range(8, 1 << 16);
+BENCHMARK(BM_parseWhiteSpace)->Range(8, 1 << 16);
+BENCHMARK(BM_Writer_Double)->Range(8, 4096);
+BENCHMARK(BM_Writer_String)->Ranges({{8, 1 << 16}, {0, 1}});
+BENCHMARK(BM_countDigits)->DenseRange(1, 19, 3);
+BENCHMARK(BM_itoa)->DenseRange(1, 19, 3);
+BENCHMARK(BM_findMember)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK(BM_findMember_records)->Ranges({{0, 1}, {0, 1}});
+BENCHMARK(BM_Value_copy)->Range(8, 4096);
+BENCHMARK(BM_Value_destroy)->Range(8, 4096);
+BENCHMARK(BM_envelope_parsed)->Range(8, 4096);
+BENCHMARK(BM_envelope_raw)->Range(8, 4096);
+BENCHMARK(BM_patch_replace)->Ranges({{8, 1 << 16}, {0, 1}});
+BENCHMARK(BM_parse_numericArrays)->Ranges({{16, 4096}, {0, 1}});
+BENCHMARK(BM_columnar_lines)->DenseRange(0, 2)->UseRealTime();
+BENCHMARK(BM_documentStream)->DenseRange(0, 1);
+
+BENCHMARK_MAIN();
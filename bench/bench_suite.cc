@@ -0,0 +1,393 @@
+#include <benchmark/benchmark.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#ifdef MUDONG_BENCH_HAS_RAPIDJSON
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#endif
+#ifdef MUDONG_BENCH_HAS_NLOHMANN
+#include <nlohmann/json.hpp>
+#endif
+#ifdef MUDONG_BENCH_HAS_SIMDJSON
+#include <simdjson.h>
+#endif
+
+#include <alloc_counter.hpp>
+
+#include "corpus.hpp"
+
+using namespace mudong;
+
+namespace {
+
+// 语料只生成一次，所有基准共享；输入均在内存中，计时不含文件读取
+struct Corpus {
+    const char*              name;
+    std::vector<std::string> inputs; // 大文档语料只有一个元素，小消息语料逐条解析
+    size_t                   bytes;  // 所有输入的总字节数
+};
+
+Corpus makeCorpus(const char* name, std::vector<std::string> inputs) {
+    size_t bytes = 0;
+    for (auto& input: inputs) bytes += input.size();
+    return {name, std::move(inputs), bytes};
+}
+
+const std::vector<Corpus>& corpora() {
+    static const std::vector<Corpus> all = {
+            makeCorpus("numbers", {corpus::numbers()}),
+            makeCorpus("strings", {corpus::strings()}),
+            makeCorpus("nested", {corpus::nested()}),
+            makeCorpus("pretty", {corpus::pretty()}),
+            makeCorpus("small_messages", corpus::smallMessages()),
+    };
+    return all;
+}
+
+void parseOrDie(json::Document& doc, const std::string& json) {
+    if (doc.parse(json) != json::ParseError::PARSE_OK) {
+        std::fprintf(stderr, "bench: corpus failed to parse\n");
+        std::exit(1);
+    }
+}
+
+// MB/s与每次迭代的分配次数、字节数
+void report(benchmark::State& s, const Corpus& c, const alloc_counter::Scope& scope) {
+    s.SetBytesProcessed(static_cast<int64_t>(s.iterations()) * static_cast<int64_t>(c.bytes));
+    alloc_counter::report(s, scope);
+}
+
+void BM_parse(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            json::Document doc;
+            parseOrDie(doc, input);
+            benchmark::DoNotOptimize(doc);
+        }
+    }
+    report(s, c, scope);
+}
+
+// 预扫描后按各容器的最终大小预留
+void BM_parse_exact(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            json::Document doc;
+            doc.setExactReserve(true);
+            parseOrDie(doc, input);
+            benchmark::DoNotOptimize(doc);
+        }
+    }
+    report(s, c, scope);
+}
+
+// 复用Document与节点缓存，稳定状态下的解析
+void BM_parse_pooled(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    json::NodePool::local().setLimits(1 << 20, size_t(256) << 20);
+    for (auto& input: inputs) parseOrDie(*json::DocumentPool::local().acquire(), input); // 预热
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            auto doc = json::DocumentPool::local().acquire();
+            parseOrDie(*doc, input);
+            benchmark::DoNotOptimize(*doc);
+        }
+    }
+    report(s, c, scope);
+    json::NodePool::local().setLimits(0, 0);
+}
+
+void BM_serialize(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<json::Document> docs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) parseOrDie(docs[i], inputs[i]);
+
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& doc: docs) {
+            json::StringWriteStream os;
+            json::Writer writer(os);
+            doc.writeTo(writer);
+            benchmark::DoNotOptimize(os.getStringView().data());
+        }
+    }
+    report(s, c, scope);
+}
+
+// 缓存序列化结果后，每次修改一个值再输出：沿第一个元素逐层访问到叶子，路径上的容器失效
+void BM_serialize_cached(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<json::Document> docs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        parseOrDie(docs[i], inputs[i]);
+        docs[i].cacheSerialization();
+    }
+
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& doc: docs) {
+            json::Value* leaf = &doc;
+            while (leaf->getSize() > 0 && (leaf->isArray() || leaf->isObject()))
+                leaf = leaf->isArray() ? &(*leaf)[0] : &leaf->beginMember()->value;
+            json::StringWriteStream os;
+            json::Writer writer(os);
+            doc.writeTo(writer);
+            benchmark::DoNotOptimize(os.getStringView().data());
+        }
+    }
+    report(s, c, scope);
+}
+
+void BM_roundtrip(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            json::Document doc;
+            parseOrDie(doc, input);
+            json::StringWriteStream os;
+            json::Writer writer(os);
+            doc.writeTo(writer);
+            benchmark::DoNotOptimize(os.getStringView().data());
+        }
+    }
+    report(s, c, scope);
+}
+
+// 数字保留原文，解析与输出都不做转换
+void BM_roundtrip_raw(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            json::Document doc;
+            doc.setRawNumbers(true);
+            parseOrDie(doc, input);
+            json::StringWriteStream os;
+            json::Writer writer(os);
+            doc.writeTo(writer);
+            benchmark::DoNotOptimize(os.getStringView().data());
+        }
+    }
+    report(s, c, scope);
+}
+
+// 遍历DOM，访问每个值与key
+size_t traverse(const json::Value& v) {
+    switch (v.getType()) {
+        case json::ValueType::TYPE_NULL:   return 1;
+        case json::ValueType::TYPE_BOOL:   return v.getBool();
+        case json::ValueType::TYPE_INT32:
+        case json::ValueType::TYPE_INT64:  return static_cast<size_t>(v.getInt64());
+        case json::ValueType::TYPE_DOUBLE: return static_cast<size_t>(v.getDouble());
+        case json::ValueType::TYPE_STRING: return v.getStringView().size();
+        case json::ValueType::TYPE_RAW:    return v.getRaw().size();
+        case json::ValueType::TYPE_ARRAY: {
+            size_t sum = 0;
+            for (auto& e: v.getArray()) sum += traverse(e);
+            return sum;
+        }
+        case json::ValueType::TYPE_OBJECT: {
+            size_t sum = 0;
+            for (auto& m: v.getObject()) sum += m.key.getStringView().size() + traverse(m.value);
+            return sum;
+        }
+    }
+    return 0;
+}
+
+void BM_traverse(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<json::Document> docs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) parseOrDie(docs[i], inputs[i]);
+
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& doc: docs) benchmark::DoNotOptimize(traverse(doc));
+    }
+    report(s, c, scope);
+}
+
+// 两份独立解析的文档做深度比较
+void BM_equals(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<json::Document> docs(inputs.size()), copies(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        parseOrDie(docs[i], inputs[i]);
+        parseOrDie(copies[i], inputs[i]);
+    }
+
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (size_t i = 0; i < docs.size(); i++) {
+            if (docs[i] != copies[i]) {
+                s.SkipWithError("not equal");
+                return;
+            }
+        }
+    }
+    report(s, c, scope);
+}
+
+void BM_hash(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<json::Document> docs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) parseOrDie(docs[i], inputs[i]);
+
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& doc: docs) benchmark::DoNotOptimize(doc.hash());
+    }
+    report(s, c, scope);
+}
+
+// DOM占用的内存：解析后仍存活的字节数与分配峰值，与时间无关
+void BM_memory(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    size_t live = 0, peak = 0, allocations = 0;
+    for (auto _: s) {
+        std::vector<json::Document> docs(inputs.size());
+        size_t before = alloc_counter::counters.live;
+        alloc_counter::Scope scope;
+        for (size_t i = 0; i < inputs.size(); i++) parseOrDie(docs[i], inputs[i]);
+        live = alloc_counter::counters.live - before;
+        peak = scope.peak();
+        allocations = scope.allocations();
+    }
+    s.counters["dom_bytes"] = static_cast<double>(live);
+    s.counters["peak_bytes"] = static_cast<double>(peak);
+    s.counters["allocs"] = static_cast<double>(allocations);
+    s.counters["bytes/input_byte"] = static_cast<double>(live) / static_cast<double>(c.bytes);
+}
+
+#ifdef MUDONG_BENCH_HAS_RAPIDJSON
+void BM_parse_rapidjson(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            rapidjson::Document doc;
+            doc.Parse(input.data(), input.size());
+            if (doc.HasParseError()) std::exit(1);
+            benchmark::DoNotOptimize(doc);
+        }
+    }
+    report(s, c, scope);
+}
+
+void BM_roundtrip_rapidjson(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            rapidjson::Document doc;
+            doc.Parse(input.data(), input.size());
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            doc.Accept(writer);
+            benchmark::DoNotOptimize(buffer.GetString());
+        }
+    }
+    report(s, c, scope);
+}
+#endif
+
+#ifdef MUDONG_BENCH_HAS_NLOHMANN
+void BM_parse_nlohmann(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            auto doc = nlohmann::json::parse(input);
+            benchmark::DoNotOptimize(doc);
+        }
+    }
+    report(s, c, scope);
+}
+
+void BM_roundtrip_nlohmann(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: inputs) {
+            std::string out = nlohmann::json::parse(input).dump();
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    report(s, c, scope);
+}
+#endif
+
+#ifdef MUDONG_BENCH_HAS_SIMDJSON
+void BM_parse_simdjson(benchmark::State& s, const Corpus& c) {
+    const auto& inputs = c.inputs;
+    std::vector<simdjson::padded_string> padded;
+    for (auto& input: inputs) padded.emplace_back(input);
+    simdjson::dom::parser parser;
+    alloc_counter::Scope scope;
+    for (auto _: s) {
+        for (auto& input: padded) {
+            simdjson::dom::element doc;
+            if (parser.parse(input).get(doc)) std::exit(1);
+            benchmark::DoNotOptimize(doc);
+        }
+    }
+    report(s, c, scope);
+}
+#endif
+
+// 语料生成较慢，在main()中注册以便共享
+void registerAll() {
+    using Fn = void (*)(benchmark::State&, const Corpus&);
+    std::vector<std::pair<const char*, Fn>> benches = {
+            {"parse",     BM_parse},
+            {"parse/exact",  BM_parse_exact},
+            {"parse/pooled", BM_parse_pooled},
+            {"serialize", BM_serialize},
+            {"serialize/cached", BM_serialize_cached},
+            {"roundtrip", BM_roundtrip},
+            {"roundtrip/raw", BM_roundtrip_raw},
+            {"traverse",  BM_traverse},
+            {"equals",    BM_equals},
+            {"hash",      BM_hash},
+#ifdef MUDONG_BENCH_HAS_RAPIDJSON
+            {"parse/rapidjson",     BM_parse_rapidjson},
+            {"roundtrip/rapidjson", BM_roundtrip_rapidjson},
+#endif
+#ifdef MUDONG_BENCH_HAS_NLOHMANN
+            {"parse/nlohmann",     BM_parse_nlohmann},
+            {"roundtrip/nlohmann", BM_roundtrip_nlohmann},
+#endif
+#ifdef MUDONG_BENCH_HAS_SIMDJSON
+            {"parse/simdjson", BM_parse_simdjson},
+#endif
+    };
+    for (auto& c: corpora()) {
+        for (auto& [name, fn]: benches) {
+            benchmark::RegisterBenchmark((std::string(name) + "/" + c.name).c_str(), fn, c)
+                    ->Unit(benchmark::kMillisecond);
+        }
+        benchmark::RegisterBenchmark((std::string("memory/") + c.name).c_str(), BM_memory, c)
+                ->Unit(benchmark::kMillisecond)->Iterations(1);
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    registerAll();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
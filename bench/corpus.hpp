@@ -0,0 +1,159 @@
+//
+// Created by mudong on 24-03-14.
+//
+
+#pragma once
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// 基准测试用的生成语料，固定随机种子，每次运行内容相同。
+// 各语料模仿常见的公开测试集：canada(数字密集)、twitter(字符串密集)、citm(格式化输出)，
+// 另有深层嵌套与大量小消息两种极端形态。
+namespace corpus {
+
+namespace detail {
+
+inline void appendIndent(std::string& out, int indent) {
+    out.push_back('\n');
+    out.append(static_cast<size_t>(indent) * 2, ' ');
+}
+
+inline std::string randomWord(std::mt19937& rng, size_t minLen, size_t maxLen) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    std::uniform_int_distribution<size_t> len(minLen, maxLen);
+    std::uniform_int_distribution<size_t> pick(0, sizeof(letters) - 2);
+    std::string word(len(rng), ' ');
+    for (auto& c: word) c = letters[pick(rng)];
+    return word;
+}
+
+} // namespace detail
+
+// 数字密集：GeoJSON多边形坐标，大量带小数的double
+inline std::string numbers(size_t points = 100000) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> lon(-180, 180), lat(-90, 90);
+    std::string out = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\","
+                      "\"properties\":{\"name\":\"Canada\",\"id\":124},"
+                      "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    char buf[64];
+    for (size_t i = 0; i < points; i++) {
+        if (i % 1000 == 0) out += i == 0 ? "[" : "],[";
+        else out += ",";
+        std::snprintf(buf, sizeof(buf), "[%.15g,%.15g]", lon(rng), lat(rng));
+        out += buf;
+    }
+    out += "]]}}]}";
+    return out;
+}
+
+// 字符串密集：社交网络时间线，含转义与多字节UTF-8
+inline std::string strings(size_t statuses = 2000) {
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> words(5, 30), coin(0, 9);
+    std::uniform_int_distribution<int64_t> id(1000000000000000LL, 9000000000000000LL);
+    std::string out = "{\"statuses\":[";
+    for (size_t i = 0; i < statuses; i++) {
+        if (i > 0) out += ",";
+        std::string text;
+        for (int w = words(rng); w > 0; w--) {
+            text += detail::randomWord(rng, 1, 10);
+            switch (coin(rng)) {
+                case 0: text += "\\n"; break;
+                case 1: text += "\\\"quoted\\\" "; break;
+                case 2: text += " \xe4\xb8\xad\xe6\x96\x87 "; break; // 中文
+                case 3: text += " \\u00e9t\\u00e9 "; break;
+                default: text += " ";
+            }
+        }
+        out += "{\"id\":" + std::to_string(id(rng)) +
+               ",\"id_str\":\"" + std::to_string(id(rng)) + "\"" +
+               ",\"text\":\"" + text + "\"" +
+               ",\"source\":\"<a href=\\\"http://example.com/app\\\" rel=\\\"nofollow\\\">app<\\/a>\"" +
+               ",\"truncated\":" + (coin(rng) == 0 ? "true" : "false") +
+               ",\"in_reply_to_status_id\":null" +
+               ",\"user\":{\"id\":" + std::to_string(id(rng)) +
+               ",\"name\":\"" + detail::randomWord(rng, 4, 16) + "\"" +
+               ",\"screen_name\":\"" + detail::randomWord(rng, 4, 12) + "\"" +
+               ",\"description\":\"" + detail::randomWord(rng, 20, 80) + "\"" +
+               ",\"followers_count\":" + std::to_string(coin(rng) * 1234) +
+               ",\"verified\":false}" +
+               ",\"retweet_count\":" + std::to_string(coin(rng)) +
+               ",\"lang\":\"" + (coin(rng) < 5 ? "en" : "zh") + "\"}";
+    }
+    out += "]}";
+    return out;
+}
+
+// 深层嵌套：数组与对象交替，深度为depth，重复count次
+inline std::string nested(size_t depth = 500, size_t count = 50) {
+    std::string out = "[";
+    for (size_t n = 0; n < count; n++) {
+        if (n > 0) out += ",";
+        for (size_t i = 0; i < depth; i++) out += i % 2 == 0 ? "{\"k\":" : "[";
+        out += std::to_string(n);
+        for (size_t i = depth; i > 0; i--) out += (i - 1) % 2 == 0 ? "}" : "]";
+    }
+    out += "]";
+    return out;
+}
+
+// 大量小消息：每条几十字节，模拟RPC/日志场景，逐条解析
+inline std::vector<std::string> smallMessages(size_t count = 10000) {
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> value(0, 100000);
+    std::vector<std::string> messages;
+    messages.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        messages.push_back("{\"seq\":" + std::to_string(i) +
+                           ",\"op\":\"" + detail::randomWord(rng, 3, 8) + "\"" +
+                           ",\"ok\":true,\"v\":" + std::to_string(value(rng)) + "}");
+    }
+    return messages;
+}
+
+// 格式化输出：演出票务数据，带缩进与换行，空白字符占比高
+inline std::string pretty(size_t events = 3000) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> price(1000, 500000), seats(0, 20);
+    std::string out = "{";
+    detail::appendIndent(out, 1);
+    out += "\"events\": {";
+    for (size_t i = 0; i < events; i++) {
+        if (i > 0) out += ",";
+        detail::appendIndent(out, 2);
+        out += "\"" + std::to_string(138586341 + i) + "\": {";
+        detail::appendIndent(out, 3);
+        out += "\"id\": " + std::to_string(138586341 + i) + ",";
+        detail::appendIndent(out, 3);
+        out += "\"name\": \"" + detail::randomWord(rng, 8, 24) + "\",";
+        detail::appendIndent(out, 3);
+        out += "\"logo\": null,";
+        detail::appendIndent(out, 3);
+        out += "\"subTopicIds\": [";
+        for (int s = seats(rng); s >= 0; s--) {
+            detail::appendIndent(out, 4);
+            out += std::to_string(337184269 + s) + (s > 0 ? "," : "");
+        }
+        detail::appendIndent(out, 3);
+        out += "],";
+        detail::appendIndent(out, 3);
+        out += "\"prices\": [";
+        detail::appendIndent(out, 4);
+        out += "{ \"amount\": " + std::to_string(price(rng)) + ", \"seatCategoryId\": 338937295 }";
+        detail::appendIndent(out, 3);
+        out += "]";
+        detail::appendIndent(out, 2);
+        out += "}";
+    }
+    detail::appendIndent(out, 1);
+    out += "}";
+    detail::appendIndent(out, 0);
+    out += "}";
+    return out;
+}
+
+} // namespace corpus
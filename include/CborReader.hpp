@@ -0,0 +1,240 @@
+//
+// Created by mudong on 24-03-02.
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "Exception.hpp"
+#include "Reader.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 解析CBOR数据并向Handler发送与Reader相同的事件，支持定长与不定长的string/array/map。
+// tag被忽略，仅解析其内容；byte string、undefined及其他simple value不能表示为JSON，视为PARSE_BAD_VALUE。
+// 超出int64范围的非负整数在Handler提供Uint64()时交给它，否则与超出范围的负整数一样视为PARSE_NUMBER_TOO_BIG。
+class CborReader: noncopyable {
+public:
+    // maxDepth为array与map的最大嵌套层数，超过时返回PARSE_DEPTH_EXCEEDED
+    template <typename Handler>
+    static ParseError parse(std::string_view data, Handler& handler, size_t maxDepth = kDefaultMaxDepth) {
+        try {
+            detail::ScratchString scratch;
+            Input in{data.data(), data.data() + data.size(), maxDepth, scratch.buffer};
+            parseValue(in, handler);
+            if (in.cur != in.end) throw Exception(ParseError::PARSE_ROOT_NOT_SINGULAR);
+            return ParseError::PARSE_OK;
+        }
+        catch (Exception& e) {
+            return e.err();
+        }
+    }
+
+private:
+#define CALL(expr) if (!(expr)) throw Exception(ParseError::PARSE_USER_STOPPED)
+
+    static constexpr uint64_t kIndefinite = std::numeric_limits<uint64_t>::max();
+
+    struct Input {
+        const char* cur;
+        const char* end;
+        size_t      maxDepth;
+        std::string& buffer; // 不定长字符串的拼接缓冲区，整次解析共用一个，与Reader相同借自ScratchString
+        size_t      depth = 0;
+
+        void enter() {
+            if (depth++ >= maxDepth) throw Exception(ParseError::PARSE_DEPTH_EXCEEDED);
+        }
+        void leave() { depth--; }
+
+        const char* take(uint64_t n) {
+            if (static_cast<uint64_t>(end - cur) < n)
+                throw Exception(ParseError::PARSE_EXPECT_VALUE);
+            const char* p = cur;
+            cur += n;
+            return p;
+        }
+        uint8_t byte() { return static_cast<uint8_t>(*take(1)); }
+        uint8_t peek() {
+            if (cur == end) throw Exception(ParseError::PARSE_EXPECT_VALUE);
+            return static_cast<uint8_t>(*cur);
+        }
+
+        uint64_t bigEndian(size_t n) {
+            const char* p = take(n);
+            uint64_t v = 0;
+            for (size_t i = 0; i < n; ++i)
+                v = (v << 8) | static_cast<uint8_t>(p[i]);
+            return v;
+        }
+
+        // 读取初始字节中低5位表示的参数，不定长返回kIndefinite
+        uint64_t argument(uint8_t info) {
+            if (info < 24) return info;
+            switch (info) {
+                case 24: return bigEndian(1);
+                case 25: return bigEndian(2);
+                case 26: return bigEndian(4);
+                case 27: return bigEndian(8);
+                case 31: return kIndefinite;
+                default: throw Exception(ParseError::PARSE_BAD_VALUE);
+            }
+        }
+
+        bool atBreak() {
+            if (peek() != 0xff) return false;
+            cur++;
+            return true;
+        }
+    };
+
+    // 定长字符串直接指向输入，不定长字符串的各分块拼接到in.buffer中，Handler返回前有效
+    static std::string_view parseText(Input& in, uint64_t len) {
+        if (len != kIndefinite)
+            return std::string_view(in.take(len), len);
+        std::string& buffer = in.buffer;
+        buffer.clear();
+        while (!in.atBreak()) {
+            uint8_t head = in.byte();
+            uint64_t n = in.argument(head & 0x1f);
+            if ((head >> 5) != 3 || n == kIndefinite)
+                throw Exception(ParseError::PARSE_BAD_STRING_CHAR);
+            buffer.append(in.take(n), n);
+        }
+        return buffer;
+    }
+
+    static double halfToDouble(uint16_t half) {
+        int exp = (half >> 10) & 0x1f;
+        int mant = half & 0x3ff;
+        double val;
+        if (exp == 0)       val = std::ldexp(mant, -24);
+        else if (exp != 31) val = std::ldexp(mant + 1024, exp - 25);
+        else                val = mant == 0 ? INFINITY : NAN;
+        return (half & 0x8000) ? -val : val;
+    }
+
+    template <typename Handler>
+    static void parseInt(Handler& handler, uint64_t u64, bool negative) {
+        if (u64 > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            if constexpr (detail::HasUint64<Handler>::value) {
+                if (!negative) {
+                    CALL(handler.Uint64(u64));
+                    return;
+                }
+            }
+            throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
+        }
+        auto i64 = static_cast<int64_t>(u64);
+        if (negative) i64 = -1 - i64;
+        if (i64 <= std::numeric_limits<int32_t>::max() &&
+            i64 >= std::numeric_limits<int32_t>::min()) {
+            CALL(handler.Int32(static_cast<int32_t>(i64)));
+        }
+        else {
+            CALL(handler.Int64(i64));
+        }
+    }
+
+    template <typename Handler>
+    static void parseArray(Input& in, Handler& handler, uint64_t n) {
+        in.enter();
+        CALL(handler.StartArray());
+        if (n == kIndefinite) {
+            while (!in.atBreak()) parseValue(in, handler);
+        }
+        else {
+            for (uint64_t i = 0; i < n; ++i) parseValue(in, handler);
+        }
+        CALL(handler.EndArray());
+        in.leave();
+    }
+
+    template <typename Handler>
+    static void parseKey(Input& in, Handler& handler) {
+        uint8_t head = in.byte();
+        while ((head >> 5) == 6) { // skip tags
+            in.argument(head & 0x1f);
+            head = in.byte();
+        }
+        if ((head >> 5) != 3) throw Exception(ParseError::PARSE_MISS_KEY);
+        CALL(handler.Key(parseText(in, in.argument(head & 0x1f))));
+    }
+
+    template <typename Handler>
+    static void parseMap(Input& in, Handler& handler, uint64_t n) {
+        in.enter();
+        CALL(handler.StartObject());
+        if (n == kIndefinite) {
+            while (!in.atBreak()) {
+                parseKey(in, handler);
+                parseValue(in, handler);
+            }
+        }
+        else {
+            for (uint64_t i = 0; i < n; ++i) {
+                parseKey(in, handler);
+                parseValue(in, handler);
+            }
+        }
+        CALL(handler.EndObject());
+        in.leave();
+    }
+
+    template <typename Handler>
+    static void parseValue(Input& in, Handler& handler) {
+        uint8_t head = in.byte();
+        while ((head >> 5) == 6) { // skip tags
+            in.argument(head & 0x1f);
+            head = in.byte();
+        }
+        uint8_t info = head & 0x1f;
+
+        switch (head >> 5) {
+            case 0: return parseInt(handler, in.argument(info), false);
+            case 1: return parseInt(handler, in.argument(info), true);
+            case 3:
+                CALL(handler.String(parseText(in, in.argument(info))));
+                return;
+            case 4: return parseArray(in, handler, in.argument(info));
+            case 5: return parseMap(in, handler, in.argument(info));
+            case 7:
+                switch (info) {
+                    case 20: CALL(handler.Bool(false)); return;
+                    case 21: CALL(handler.Bool(true));  return;
+                    case 22: CALL(handler.Null());      return;
+                    case 25: CALL(handler.Double(halfToDouble(static_cast<uint16_t>(in.bigEndian(2))))); return;
+                    case 26: {
+                        auto bits = static_cast<uint32_t>(in.bigEndian(4));
+                        float f;
+                        std::memcpy(&f, &bits, sizeof(f));
+                        CALL(handler.Double(static_cast<double>(f)));
+                        return;
+                    }
+                    case 27: {
+                        uint64_t bits = in.bigEndian(8);
+                        double d;
+                        std::memcpy(&d, &bits, sizeof(d));
+                        CALL(handler.Double(d));
+                        return;
+                    }
+                    default: throw Exception(ParseError::PARSE_BAD_VALUE);
+                }
+            default: throw Exception(ParseError::PARSE_BAD_VALUE); // byte string
+        }
+    }
+#undef CALL
+};
+
+} // namespace json
+
+} // namespace mudong
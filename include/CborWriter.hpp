@@ -0,0 +1,152 @@
+//
+// Created by mudong on 24-03-02.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <string_view>
+#include <vector>
+
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// CBOR(RFC 8949)格式的Handler，接口与Writer一致。
+// array/map使用不定长编码(0x9f/0xbf ... 0xff)，事件到达即写出，无需缓冲。
+template <typename WriteStream>
+class CborWriter: noncopyable {
+public:
+    explicit CborWriter(WriteStream& os):
+            os_(os), seeValue_(false)
+    {}
+
+    bool Null() {
+        if (!prefix()) return false;
+        putByte(0xf6);
+        return true;
+    }
+
+    bool Bool(bool b) {
+        if (!prefix()) return false;
+        putByte(b ? 0xf5 : 0xf4);
+        return true;
+    }
+
+    bool Int32(int32_t i32) {
+        return Int64(i32);
+    }
+
+    bool Int64(int64_t i64) {
+        if (!prefix()) return false;
+        if (i64 >= 0) putHead(0, static_cast<uint64_t>(i64));
+        else          putHead(1, ~static_cast<uint64_t>(i64)); // -1 - n
+        return true;
+    }
+
+    bool Double(double d) {
+        if (!prefix()) return false;
+        // 能无损表示为float的值使用单精度编码
+        auto f = static_cast<float>(d);
+        if (static_cast<double>(f) == d) {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            putByte(0xfa);
+            putBigEndian(bits, 4);
+        }
+        else {
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            putByte(0xfb);
+            putBigEndian(bits, 8);
+        }
+        return true;
+    }
+
+    bool String(std::string_view s) {
+        if (!prefix()) return false;
+        putString(s);
+        return true;
+    }
+
+    bool StartObject() {
+        if (!prefix()) return false;
+        stack_.push_back(true);
+        putByte(0xbf);
+        return true;
+    }
+
+    bool Key(std::string_view s) {
+        assert(!stack_.empty() && stack_.back());
+        putString(s);
+        return true;
+    }
+
+    bool EndObject() {
+        assert(!stack_.empty() && stack_.back());
+        stack_.pop_back();
+        putByte(0xff);
+        return true;
+    }
+
+    bool StartArray() {
+        if (!prefix()) return false;
+        stack_.push_back(false);
+        putByte(0x9f);
+        return true;
+    }
+
+    bool EndArray() {
+        assert(!stack_.empty() && !stack_.back());
+        stack_.pop_back();
+        putByte(0xff);
+        return true;
+    }
+
+private:
+    // 与Writer相同，根值之后再写入值时返回false，不输出任何内容
+    bool prefix() {
+        if (!seeValue_)
+            seeValue_ = true;
+        else if (stack_.empty())
+            return false;
+        return true;
+    }
+
+    void putString(std::string_view s) {
+        putHead(3, s.size());
+        os_.put(s);
+    }
+
+    // 初始字节高3位为major type，低5位为参数或其字节数
+    void putHead(uint8_t major, uint64_t arg) {
+        auto mt = static_cast<uint8_t>(major << 5);
+        if (arg < 24)                { putByte(static_cast<uint8_t>(mt | arg)); }
+        else if (arg <= 0xff)        { putByte(static_cast<uint8_t>(mt | 24)); putBigEndian(arg, 1); }
+        else if (arg <= 0xffff)      { putByte(static_cast<uint8_t>(mt | 25)); putBigEndian(arg, 2); }
+        else if (arg <= 0xffffffff)  { putByte(static_cast<uint8_t>(mt | 26)); putBigEndian(arg, 4); }
+        else                         { putByte(static_cast<uint8_t>(mt | 27)); putBigEndian(arg, 8); }
+    }
+
+    void putByte(uint8_t b) { os_.put(static_cast<char>(b)); }
+
+    void putBigEndian(uint64_t v, size_t n) {
+        char* p = os_.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            p[i] = static_cast<char>(v >> (8 * (n - 1 - i)));
+        os_.commit(n);
+    }
+
+private:
+    std::vector<bool> stack_; // true: in map
+    WriteStream&      os_;
+    bool              seeValue_;
+};
+
+} // namespace json
+
+} // namespace mudong
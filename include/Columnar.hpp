@@ -0,0 +1,409 @@
+//
+// Created by mudong on 24-04-02.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <string_view>
+
+#include "Value.hpp"
+#include "Reader.hpp"
+#include "StringReadStream.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+enum class ColumnType {
+    COLUMN_INT64,
+    COLUMN_DOUBLE,
+    COLUMN_BOOL,
+    COLUMN_STRING,
+};
+
+// 一列的定义：path为记录内的JSON Pointer(RFC 6901)，只能经过对象成员，""表示记录本身
+struct ColumnSpec {
+    std::string path;
+    ColumnType  type;
+};
+
+// 一列的数据，每条记录一行。值按类型连续存放，null的行在数组中占位(0、false或空串)，
+// 由有效位图区分：字段缺失、值为null或类型不符(如INT64列遇到字符串或浮点数)时为null，
+// 整数写入DOUBLE列时转换为double
+class Column {
+    friend class ColumnarBuilder;
+public:
+    Column(std::string path, ColumnType type):
+            path_(std::move(path)), type_(type)
+    {
+        offsets_.push_back(0);
+    }
+
+    const std::string& getPath() const { return path_; }
+    ColumnType         getType() const { return type_; }
+    size_t             getSize() const { return size_; }
+
+    bool isNull(size_t row) const {
+        assert(row < size_);
+        return ((valid_[row / 64] >> (row % 64)) & 1) == 0;
+    }
+    size_t getNullCount() const {
+        size_t valid = 0;
+        for (uint64_t word: valid_) valid += static_cast<size_t>(__builtin_popcountll(word));
+        return size_ - valid;
+    }
+
+    ArrayView<int64_t> getInt64s () const { assert(type_ == ColumnType::COLUMN_INT64);  return {ints_.data(), ints_.size()}; }
+    ArrayView<double>  getDoubles() const { assert(type_ == ColumnType::COLUMN_DOUBLE); return {doubles_.data(), doubles_.size()}; }
+    ArrayView<uint8_t> getBools  () const { assert(type_ == ColumnType::COLUMN_BOOL);   return {bools_.data(), bools_.size()}; }
+    std::string_view getString(size_t row) const {
+        assert(type_ == ColumnType::COLUMN_STRING && row < size_);
+        return std::string_view(chars_.data() + offsets_[row], offsets_[row + 1] - offsets_[row]);
+    }
+
+    // 底层缓冲区：第i行有效当且仅当validity[i / 64]的第i % 64位为1；
+    // 字符串列第i行为chars[offsets[i], offsets[i + 1])
+    ArrayView<uint64_t> getValidity() const { return {valid_.data(), valid_.size()}; }
+    ArrayView<size_t>   getOffsets () const { return {offsets_.data(), offsets_.size()}; }
+    std::string_view    getChars   () const { return chars_; }
+
+private:
+    void addInt64(int64_t i64) {
+        if (type_ == ColumnType::COLUMN_INT64) { ints_.push_back(i64); pushValid(true); }
+        else if (type_ == ColumnType::COLUMN_DOUBLE) { doubles_.push_back(static_cast<double>(i64)); pushValid(true); }
+        else addNull();
+    }
+    void addDouble(double d) {
+        if (type_ == ColumnType::COLUMN_DOUBLE) { doubles_.push_back(d); pushValid(true); }
+        else addNull();
+    }
+    void addBool(bool b) {
+        if (type_ == ColumnType::COLUMN_BOOL) { bools_.push_back(b); pushValid(true); }
+        else addNull();
+    }
+    void addString(std::string_view s) {
+        if (type_ != ColumnType::COLUMN_STRING) { addNull(); return; }
+        chars_.append(s);
+        offsets_.push_back(chars_.size());
+        pushValid(true);
+    }
+    void addNull() {
+        switch (type_) {
+            case ColumnType::COLUMN_INT64:  ints_.push_back(0);              break;
+            case ColumnType::COLUMN_DOUBLE: doubles_.push_back(0);           break;
+            case ColumnType::COLUMN_BOOL:   bools_.push_back(0);             break;
+            case ColumnType::COLUMN_STRING: offsets_.push_back(chars_.size()); break;
+        }
+        pushValid(false);
+    }
+
+    void pushValid(bool valid) {
+        if (size_ % 64 == 0) valid_.push_back(0);
+        if (valid) valid_.back() |= uint64_t(1) << (size_ % 64);
+        size_++;
+    }
+
+    // 只保留前n行，丢弃解析失败的记录已写入的值
+    void truncate(size_t n) {
+        if (n >= size_) return;
+        size_ = n;
+        valid_.resize((n + 63) / 64);
+        if (n % 64 != 0) valid_.back() &= (uint64_t(1) << (n % 64)) - 1;
+        if (!ints_.empty()) ints_.resize(n);
+        if (!doubles_.empty()) doubles_.resize(n);
+        if (!bools_.empty()) bools_.resize(n);
+        offsets_.resize(n + 1);
+        chars_.resize(offsets_.back());
+    }
+
+    // 在末尾接上other的各行
+    void append(const Column& other) {
+        assert(type_ == other.type_);
+        ints_.insert(ints_.end(), other.ints_.begin(), other.ints_.end());
+        doubles_.insert(doubles_.end(), other.doubles_.begin(), other.doubles_.end());
+        bools_.insert(bools_.end(), other.bools_.begin(), other.bools_.end());
+        size_t base = chars_.size();
+        chars_.append(other.chars_);
+        for (size_t i = 1; i < other.offsets_.size(); i++) offsets_.push_back(base + other.offsets_[i]);
+
+        // other的位图整体左移size_ % 64位接在后面，超出行数的位均为0
+        size_t shift = size_ % 64;
+        if (shift == 0) {
+            valid_.insert(valid_.end(), other.valid_.begin(), other.valid_.end());
+        }
+        else {
+            for (uint64_t word: other.valid_) {
+                valid_.back() |= word << shift;
+                valid_.push_back(word >> (64 - shift));
+            }
+        }
+        size_ += other.size_;
+        valid_.resize((size_ + 63) / 64);
+    }
+
+private:
+    std::string           path_;
+    ColumnType            type_;
+    size_t                size_ = 0;
+    std::vector<uint64_t> valid_;
+    std::vector<int64_t>  ints_;
+    std::vector<double>   doubles_;
+    std::vector<uint8_t>  bools_;
+    std::string           chars_;
+    std::vector<size_t>   offsets_;
+};
+
+// 把记录流直接写入按列存放的缓冲区，不建立DOM。作为Reader的Handler使用：
+// 根为数组时其每个元素是一条记录，否则根本身是一条记录；不是对象的记录只能匹配路径为""的列。
+// 每条记录恰好产生一行，各列的行对齐；同一记录中重复的key只取第一个。
+//
+//     ColumnarBuilder builder({{"/id", ColumnType::COLUMN_INT64}, {"/user/name", ColumnType::COLUMN_STRING}});
+//     builder.parseLines(ndjson, 0); // 按CPU核数分块并行
+//     for (int64_t id: builder.getColumn(0).getInt64s()) ...
+class ColumnarBuilder: noncopyable {
+public:
+    explicit ColumnarBuilder(std::vector<ColumnSpec> specs):
+            specs_(std::move(specs))
+    {
+        nodes_.emplace_back();
+        for (size_t i = 0; i < specs_.size(); i++) {
+            columns_.emplace_back(specs_[i].path, specs_[i].type);
+            int node = 0;
+            std::string_view path = specs_[i].path;
+            assert((path.empty() || path[0] == '/') && "column path must be a JSON pointer");
+            while (!path.empty()) {
+                path.remove_prefix(1);
+                size_t end = std::min(path.find('/'), path.size());
+                node = child(node, unescape(path.substr(0, end)), true);
+                path.remove_prefix(end);
+            }
+            assert(nodes_[static_cast<size_t>(node)].column < 0 && "duplicate column path");
+            nodes_[static_cast<size_t>(node)].column = static_cast<int>(i);
+        }
+    }
+
+    size_t getRows() const { return rows_; }
+    const std::vector<Column>& getColumns() const { return columns_; }
+    const Column& getColumn(size_t i) const { return columns_[i]; }
+    const Column* findColumn(std::string_view path) const {
+        for (auto& column: columns_)
+            if (column.getPath() == path) return &column;
+        return nullptr;
+    }
+
+    // 清空各列，保留缓冲区的容量
+    void clear() {
+        for (auto& column: columns_) column.truncate(0);
+        rows_ = 0;
+        levels_.clear();
+    }
+
+    // 解析一段JSON文本，记录追加到各列末尾。失败时丢弃出错的记录，之前的记录保留
+    ParseError parse(std::string_view json) {
+        StringReadStream is(json);
+        ParseError err = Reader::parse(is, *this);
+        if (err != ParseError::PARSE_OK) abort();
+        return err;
+    }
+
+    // 解析NDJSON：每个非空行是一段JSON文本。threads大于1时按行边界分块，各线程分别建列后按顺序拼接，
+    // 为0时取硬件线程数。失败时出错行之前的记录保留
+    ParseError parseLines(std::string_view text, size_t threads = 1) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        if (threads == 1 || text.size() < kMinChunkSize * 2) return parseChunk(text);
+
+        std::vector<std::string_view> chunks;
+        size_t chunkSize = std::max(kMinChunkSize, text.size() / threads + 1);
+        while (!text.empty()) {
+            size_t end = text.find('\n', std::min(chunkSize, text.size()) - 1);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            chunks.push_back(text.substr(0, end));
+            text.remove_prefix(end);
+        }
+
+        std::vector<std::unique_ptr<ColumnarBuilder>> builders;
+        std::vector<ParseError> errors(chunks.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            builders.push_back(std::make_unique<ColumnarBuilder>(specs_));
+            workers.emplace_back([&, i]() { errors[i] = builders[i]->parseChunk(chunks[i]); });
+        }
+        for (auto& worker: workers) worker.join();
+
+        ParseError err = ParseError::PARSE_OK;
+        for (size_t i = 0; i < chunks.size() && err == ParseError::PARSE_OK; i++) {
+            append(*builders[i]);
+            err = errors[i];
+        }
+        return err;
+    }
+
+    // 在末尾接上other的各行，other须由相同的列定义构造。可用于自行分块并行解析后合并
+    void append(const ColumnarBuilder& other) {
+        assert(columns_.size() == other.columns_.size());
+        for (size_t i = 0; i < columns_.size(); i++) columns_[i].append(other.columns_[i]);
+        rows_ += other.rows_;
+    }
+
+public:
+    bool Null() {
+        if (int column = beginValue(); column >= 0) columns_[static_cast<size_t>(column)].addNull();
+        return endValue();
+    }
+    bool Bool(bool b) {
+        if (int column = beginValue(); column >= 0) columns_[static_cast<size_t>(column)].addBool(b);
+        return endValue();
+    }
+    bool Int32(int32_t i32) {
+        return Int64(i32);
+    }
+    bool Int64(int64_t i64) {
+        if (int column = beginValue(); column >= 0) columns_[static_cast<size_t>(column)].addInt64(i64);
+        return endValue();
+    }
+    bool Double(double d) {
+        if (int column = beginValue(); column >= 0) columns_[static_cast<size_t>(column)].addDouble(d);
+        return endValue();
+    }
+    bool String(std::string_view s) {
+        if (int column = beginValue(); column >= 0) columns_[static_cast<size_t>(column)].addString(s);
+        return endValue();
+    }
+    bool StartObject() {
+        beginValue();
+        levels_.push_back({target_, true});
+        return true;
+    }
+    bool Key(std::string_view s) {
+        int node = levels_.back().node;
+        key_ = node < 0 ? -1 : child(node, s, false);
+        return true;
+    }
+    bool EndObject() {
+        levels_.pop_back();
+        return endValue();
+    }
+    bool StartArray() {
+        if (levels_.empty()) {
+            // 根数组，元素是记录
+            rootArray_ = true;
+            levels_.push_back({-1, false});
+            return true;
+        }
+        beginValue();
+        levels_.push_back({-1, false}); // 数组内的值不对应任何列
+        return true;
+    }
+    bool EndArray() {
+        levels_.pop_back();
+        if (levels_.empty() && rootArray_) return true;
+        return endValue();
+    }
+
+private:
+    static constexpr size_t kMinChunkSize = 64 * 1024;
+
+    // 路径上的一段key，column为以此结尾的列，不是列时为-1
+    struct Node {
+        std::string      key;
+        int              column = -1;
+        std::vector<int> children;
+    };
+    // 打开的容器，node为对应的路径节点，不对应任何路径时为-1
+    struct Level {
+        int  node;
+        bool object;
+    };
+
+    static std::string unescape(std::string_view token) {
+        std::string key;
+        for (size_t i = 0; i < token.size(); i++) {
+            if (token[i] == '~' && i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1')) {
+                key += token[i + 1] == '0' ? '~' : '/';
+                i++;
+            }
+            else {
+                key += token[i];
+            }
+        }
+        return key;
+    }
+
+    int child(int node, std::string_view key, bool create) {
+        for (int c: nodes_[static_cast<size_t>(node)].children)
+            if (nodes_[static_cast<size_t>(c)].key == key) return c;
+        if (!create) return -1;
+        int c = static_cast<int>(nodes_.size());
+        nodes_.push_back({std::string(key), -1, {}});
+        nodes_[static_cast<size_t>(node)].children.push_back(c);
+        return c;
+    }
+
+    bool atRecord() const {
+        return levels_.size() == (rootArray_ ? 1 : 0);
+    }
+
+    // 一个值开始，记下它对应的路径节点，返回应写入的列，不写入时为-1
+    int beginValue() {
+        if (levels_.empty()) rootArray_ = false;
+        if (atRecord()) target_ = 0;
+        else if (levels_.back().object && levels_.back().node >= 0) target_ = key_;
+        else target_ = -1;
+        if (target_ < 0) return -1;
+
+        int column = nodes_[static_cast<size_t>(target_)].column;
+        // 同一记录中重复的key：该列本行已有值
+        if (column >= 0 && columns_[static_cast<size_t>(column)].getSize() > rows_) return -1;
+        return column;
+    }
+
+    // 一个值结束，若它是一条记录则补齐未出现的列
+    bool endValue() {
+        if (!atRecord()) return true;
+        for (auto& column: columns_)
+            if (column.getSize() == rows_) column.addNull();
+        rows_++;
+        return true;
+    }
+
+    // 解析失败，丢弃未完成的记录
+    void abort() {
+        for (auto& column: columns_) column.truncate(rows_);
+        levels_.clear();
+    }
+
+    ParseError parseChunk(std::string_view text) {
+        while (!text.empty()) {
+            size_t end = std::min(text.find('\n'), text.size());
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(std::min(end + 1, text.size()));
+            if (line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+            ParseError err = parse(line);
+            if (err != ParseError::PARSE_OK) return err;
+        }
+        return ParseError::PARSE_OK;
+    }
+
+private:
+    std::vector<ColumnSpec> specs_;
+    std::vector<Column>     columns_;
+    std::vector<Node>       nodes_;  // 各列路径组成的前缀树，0为记录本身
+    std::vector<Level>      levels_;
+    size_t                  rows_ = 0;
+    bool                    rootArray_ = false;
+    int                     key_ = -1;    // 最近的key对应的路径节点
+    int                     target_ = -1; // 当前值对应的路径节点
+};
+
+} // namespace json
+
+} // namespace mudong
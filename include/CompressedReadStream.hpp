@@ -0,0 +1,282 @@
+//
+// Created by mudong on 24-03-10.
+//
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define MUDONG_JSON_HAS_GZIP 1
+#endif
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define MUDONG_JSON_HAS_ZSTD 1
+#endif
+
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// Decoder concept，DecompressingReadStream只依赖以下接口：
+//     explicit Decoder(FILE* input);
+//     size_t read(char* out, size_t n);  解压至多n字节到out，返回0表示结束
+//     bool   good() const;               输入是否完整且未损坏，空输入不含完整的压缩数据，为false
+// Decoder只在一个线程中使用，无需加锁。
+
+#ifdef MUDONG_JSON_HAS_GZIP
+// 解压gzip/zlib格式，自动识别头部，支持多个gzip member首尾相接
+class GzipDecoder: noncopyable {
+public:
+    explicit GzipDecoder(FILE* input, size_t bufferSize = 65536):
+            input_(input), in_(bufferSize)
+    {
+        zs_.zalloc = Z_NULL;
+        zs_.zfree = Z_NULL;
+        zs_.opaque = Z_NULL;
+        zs_.next_in = Z_NULL;
+        zs_.avail_in = 0;
+        // 15: 最大窗口，+32: 自动识别gzip或zlib头部
+        good_ = inflateInit2(&zs_, 15 + 32) == Z_OK;
+        done_ = !good_;
+    }
+    ~GzipDecoder() { inflateEnd(&zs_); }
+
+    size_t read(char* out, size_t n) {
+        zs_.next_out = reinterpret_cast<Bytef*>(out);
+        zs_.avail_out = static_cast<uInt>(n);
+        while (!done_ && zs_.avail_out > 0) {
+            if (zs_.avail_in == 0 && !fill()) {
+                // 输入在压缩流结束前耗尽
+                good_ = ended_;
+                done_ = true;
+                break;
+            }
+            ended_ = false;
+            int ret = inflate(&zs_, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                ended_ = true;
+                if (zs_.avail_in == 0 && !fill()) done_ = true;
+                else inflateReset(&zs_);
+            }
+            else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                good_ = false;
+                done_ = true;
+            }
+        }
+        return n - zs_.avail_out;
+    }
+
+    bool good() const { return good_; }
+
+private:
+    bool fill() {
+        size_t len = fread(in_.data(), 1, in_.size(), input_);
+        zs_.next_in = reinterpret_cast<Bytef*>(in_.data());
+        zs_.avail_in = static_cast<uInt>(len);
+        return len > 0;
+    }
+
+    FILE*             input_;
+    std::vector<char> in_;
+    z_stream          zs_;
+    bool              good_;
+    bool              done_;
+    bool              ended_ = false; // 上一个member是否完整结束
+};
+#endif
+
+#ifdef MUDONG_JSON_HAS_ZSTD
+// 解压zstd格式，支持多个frame首尾相接
+class ZstdDecoder: noncopyable {
+public:
+    explicit ZstdDecoder(FILE* input):
+            input_(input),
+            dctx_(ZSTD_createDCtx()),
+            in_(ZSTD_DStreamInSize()),
+            inBuffer_{in_.data(), 0, 0}
+    {}
+    ~ZstdDecoder() { ZSTD_freeDCtx(dctx_); }
+
+    size_t read(char* out, size_t n) {
+        ZSTD_outBuffer output{out, n, 0};
+        while (!done_ && output.pos < output.size) {
+            if (inBuffer_.pos == inBuffer_.size) {
+                inBuffer_.size = fread(in_.data(), 1, in_.size(), input_);
+                inBuffer_.pos = 0;
+                if (inBuffer_.size == 0) {
+                    good_ = remaining_ == 0;
+                    done_ = true;
+                    break;
+                }
+            }
+            remaining_ = ZSTD_decompressStream(dctx_, &output, &inBuffer_);
+            if (ZSTD_isError(remaining_)) {
+                good_ = false;
+                done_ = true;
+            }
+        }
+        return output.pos;
+    }
+
+    bool good() const { return good_; }
+
+private:
+    FILE*             input_;
+    ZSTD_DCtx*        dctx_;
+    std::vector<char> in_;
+    ZSTD_inBuffer     inBuffer_;
+    size_t            remaining_ = 1; // 0表示当前frame已完整结束，初始非0使空输入与gzip一样视为不完整
+    bool              good_ = true;
+    bool              done_ = false;
+};
+#endif
+
+// 边读边解压的ReadStream，内存占用不超过两个固定大小的窗口，不会将整个文件解压到内存。
+// 窗口之间不连续，因此不提供getConstIter()。窗口末尾保留'\0'哨兵，peek()无需检查边界。
+//
+// background为true时由后台线程解压下一个窗口，与解析重叠；两个窗口交替使用，
+// 解析线程读完当前窗口后才交还给后台线程，因此窗口与解压器本身无需加锁，解压时不持有锁。
+// 否则只分配一个窗口，在解析线程中同步解压。
+template <typename Decoder>
+class DecompressingReadStream: noncopyable {
+public:
+    explicit DecompressingReadStream(FILE* input, bool background = false, size_t windowSize = 65536):
+            decoder_(input),
+            background_(background)
+    {
+        assert(windowSize > 0);
+        windows_[0].resize(windowSize + 1);
+        if (background_) windows_[1].resize(windowSize + 1);
+        if (background_) {
+            thread_ = std::thread([this]() { decodeLoop(); });
+        }
+        refill();
+    }
+
+    ~DecompressingReadStream() {
+        if (background_) {
+            {
+                std::lock_guard lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            thread_.join();
+        }
+    }
+
+    bool hasNext   () const { return cur_ < end_; }
+    char peek      () const { return *cur_; }
+    char next      ()       {
+        char c = *cur_;
+        if (++cur_ >= end_) refill();
+        return c;
+    }
+    void assertNext(char c) { assert(peek() == c); next(); }
+    size_t tell    () const { return consumed_ + static_cast<size_t>(cur_ - begin_); }
+
+    // 解析结束后检查，为false表示压缩数据损坏或被截断
+    bool good() const {
+        if (!background_) return decoder_.good();
+        std::lock_guard lock(mutex_);
+        return decoderGood_;
+    }
+
+private:
+    // 当前窗口读完后切换到下一个窗口，结束时cur_ == end_且*end_ == '\0'
+    void refill() {
+        if (eof_) {
+            cur_ = end_; // 与tell()一致，不计越过的哨兵
+            return;
+        }
+        size_t len;
+        if (!background_) {
+            auto& window = windows_[0];
+            len = decoder_.read(window.data(), window.size() - 1);
+            current_ = 0;
+        }
+        else {
+            std::unique_lock lock(mutex_);
+            if (current_ >= 0) {
+                // 交还读完的窗口
+                filled_[current_] = false;
+                cond_.notify_all();
+            }
+            int index = (current_ + 1) % 2;
+            cond_.wait(lock, [this, index]() { return filled_[index]; });
+            len = lengths_[index];
+            current_ = index;
+        }
+
+        auto& window = windows_[static_cast<size_t>(current_)];
+        window[len] = '\0';
+        consumed_ += static_cast<size_t>(end_ - begin_);
+        begin_ = window.data();
+        cur_ = window.data();
+        end_ = cur_ + len;
+        if (len == 0) eof_ = true;
+    }
+
+    void decodeLoop() {
+        int index = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mutex_);
+                cond_.wait(lock, [this, index]() { return stop_ || !filled_[index]; });
+                if (stop_) return;
+            }
+            auto& window = windows_[static_cast<size_t>(index)];
+            // 解压器只由本线程访问，结果连同长度一起在锁内发布
+            size_t len = decoder_.read(window.data(), window.size() - 1);
+            bool good = decoder_.good();
+            {
+                std::lock_guard lock(mutex_);
+                lengths_[index] = len;
+                filled_[index] = true;
+                decoderGood_ = good;
+            }
+            cond_.notify_all();
+            if (len == 0) return;
+            index = (index + 1) % 2;
+        }
+    }
+
+private:
+    Decoder                 decoder_;
+    std::vector<char>       windows_[2];
+    const char*             begin_ = nullptr;
+    const char*             cur_ = nullptr;
+    const char*             end_ = nullptr;
+    int                     current_ = -1; // 解析线程正在读取的窗口
+    bool                    eof_ = false;
+    size_t                  consumed_ = 0; // 之前各窗口的解压字节数
+
+    const bool              background_;
+    std::thread             thread_;
+    mutable std::mutex      mutex_;
+    std::condition_variable cond_;
+    bool                    filled_[2] = {false, false};
+    size_t                  lengths_[2] = {0, 0};
+    bool                    decoderGood_ = true; // 后台模式下最近一次解压后decoder_.good()的结果
+    bool                    stop_ = false;
+};
+
+#ifdef MUDONG_JSON_HAS_GZIP
+using GzipReadStream = DecompressingReadStream<GzipDecoder>;
+#endif
+#ifdef MUDONG_JSON_HAS_ZSTD
+using ZstdReadStream = DecompressingReadStream<ZstdDecoder>;
+#endif
+
+} // namespace json
+
+} // namespace mudong
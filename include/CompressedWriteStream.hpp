@@ -0,0 +1,191 @@
+//
+// Created by mudong on 24-03-10.
+//
+
+#pragma once
+
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define MUDONG_JSON_HAS_GZIP 1
+#endif
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define MUDONG_JSON_HAS_ZSTD 1
+#endif
+
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// Encoder concept，CompressingWriteStream只依赖以下接口：
+//     Encoder(FILE* output, int level);
+//     void write(const char* data, size_t n);  压缩并写出，可能在内部缓冲
+//     void finish();                           写出剩余数据与结尾，之后不再调用write()
+//     bool good() const;
+
+#ifdef MUDONG_JSON_HAS_GZIP
+class GzipEncoder: noncopyable {
+public:
+    explicit GzipEncoder(FILE* output, int level = Z_DEFAULT_COMPRESSION, size_t bufferSize = 65536):
+            output_(output), out_(bufferSize)
+    {
+        zs_.zalloc = Z_NULL;
+        zs_.zfree = Z_NULL;
+        zs_.opaque = Z_NULL;
+        // 15: 最大窗口，+16: 写出gzip头部与尾部，8: 默认内存级别
+        good_ = deflateInit2(&zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~GzipEncoder() { deflateEnd(&zs_); }
+
+    void write(const char* data, size_t n) {
+        zs_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs_.avail_in = static_cast<uInt>(n);
+        deflateAll(Z_NO_FLUSH);
+    }
+
+    void finish() {
+        zs_.next_in = Z_NULL;
+        zs_.avail_in = 0;
+        deflateAll(Z_FINISH);
+    }
+
+    bool good() const { return good_; }
+
+private:
+    void deflateAll(int flush) {
+        while (good_) {
+            zs_.next_out = reinterpret_cast<Bytef*>(out_.data());
+            zs_.avail_out = static_cast<uInt>(out_.size());
+            int ret = deflate(&zs_, flush);
+            if (ret == Z_STREAM_ERROR) good_ = false;
+            size_t len = out_.size() - zs_.avail_out;
+            if (len > 0 && fwrite(out_.data(), 1, len, output_) != len) good_ = false;
+            if (flush == Z_FINISH ? ret == Z_STREAM_END : zs_.avail_out != 0) break;
+        }
+    }
+
+    FILE*             output_;
+    std::vector<char> out_;
+    z_stream          zs_;
+    bool              good_;
+};
+#endif
+
+#ifdef MUDONG_JSON_HAS_ZSTD
+class ZstdEncoder: noncopyable {
+public:
+    explicit ZstdEncoder(FILE* output, int level = ZSTD_CLEVEL_DEFAULT):
+            output_(output),
+            cctx_(ZSTD_createCCtx()),
+            out_(ZSTD_CStreamOutSize())
+    {
+        good_ = !ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level));
+    }
+    ~ZstdEncoder() { ZSTD_freeCCtx(cctx_); }
+
+    void write(const char* data, size_t n) {
+        ZSTD_inBuffer input{data, n, 0};
+        compress(input, ZSTD_e_continue);
+    }
+
+    void finish() {
+        ZSTD_inBuffer input{nullptr, 0, 0};
+        compress(input, ZSTD_e_end);
+    }
+
+    bool good() const { return good_; }
+
+private:
+    void compress(ZSTD_inBuffer& input, ZSTD_EndDirective mode) {
+        while (good_) {
+            ZSTD_outBuffer output{out_.data(), out_.size(), 0};
+            size_t remaining = ZSTD_compressStream2(cctx_, &output, &input, mode);
+            if (ZSTD_isError(remaining)) good_ = false;
+            if (output.pos > 0 && fwrite(out_.data(), 1, output.pos, output_) != output.pos) good_ = false;
+            if (mode == ZSTD_e_end ? remaining == 0 : input.pos == input.size) break;
+        }
+    }
+
+    FILE*             output_;
+    ZSTD_CCtx*        cctx_;
+    std::vector<char> out_;
+    bool              good_;
+};
+#endif
+
+// 边写边压缩的WriteStream，满足Writer.hpp中描述的WriteStream concept。
+// 数据先写入固定大小的缓冲区，满后整体交给Encoder压缩；析构时调用finish()写出压缩流结尾。
+template <typename Encoder>
+class CompressingWriteStream: noncopyable {
+public:
+    template <typename... Args>
+    explicit CompressingWriteStream(FILE* output, Args&&... args):
+            encoder_(output, std::forward<Args>(args)...),
+            buffer_(65536), pos_(0), finished_(false)
+    {}
+    ~CompressingWriteStream() { finish(); }
+
+    void put(char c)                      { *reserve(1) = c; commit(1); }
+    void put(const std::string_view& str) {
+        if (str.size() >= buffer_.size()) {
+            flushBuffer();
+            encoder_.write(str.data(), str.size());
+            return;
+        }
+        std::memcpy(reserve(str.size()), str.data(), str.size());
+        commit(str.size());
+    }
+
+    // 同StringWriteStream::reserve()/commit()
+    char* reserve(size_t n) {
+        if (buffer_.size() - pos_ < n) {
+            flushBuffer();
+            if (buffer_.size() < n) buffer_.resize(n);
+        }
+        return buffer_.data() + pos_;
+    }
+    void commit(size_t n) { assert(pos_ + n <= buffer_.size()); pos_ += n; }
+
+    // 结束压缩流，之后不能再写入；不关闭FILE*
+    void finish() {
+        if (finished_) return;
+        flushBuffer();
+        encoder_.finish();
+        finished_ = true;
+    }
+
+    bool good() const { return encoder_.good(); }
+
+private:
+    void flushBuffer() {
+        assert(!finished_ || pos_ == 0);
+        if (pos_ > 0) encoder_.write(buffer_.data(), pos_);
+        pos_ = 0;
+    }
+
+    Encoder           encoder_;
+    std::vector<char> buffer_;
+    size_t            pos_;
+    bool              finished_;
+};
+
+#ifdef MUDONG_JSON_HAS_GZIP
+using GzipWriteStream = CompressingWriteStream<GzipEncoder>;
+#endif
+#ifdef MUDONG_JSON_HAS_ZSTD
+using ZstdWriteStream = CompressingWriteStream<ZstdEncoder>;
+#endif
+
+} // namespace json
+
+} // namespace mudong
@@ -6,34 +6,230 @@
 
 #include <string_view>
 #include <type_traits>
+#include <array>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 #include "Value.hpp"
 #include "Reader.hpp"
 #include "FileReadStream.hpp"
 #include "StringReadStream.hpp"
+#include "PaddedReadStream.hpp"
 
 namespace mudong {
 
 namespace json {
 
+namespace detail {
+
+// 结构预扫描：按'['与'{'在输入中出现的顺序(即StartArray/StartObject的顺序)记录每个容器的元素个数。
+// 只识别字符串、括号与逗号，不做校验；输入非法时结果没有意义，但只影响预留的容量。
+// 元素只在其位置上确实出现了值时才计数，[,,,,]这样只有逗号的非法输入不会按逗号个数预留，
+// 预留的元素个数不超过输入中实际出现的值的个数。
+inline void countElements(std::string_view json, std::vector<uint32_t>& sizes) {
+    // 只有这些字符影响计数，其余字符成段跳过
+    static const auto structural = []() {
+        std::array<bool, 256> table{};
+        for (unsigned char c: std::string_view("\"[]{},")) table[c] = true;
+        return table;
+    }();
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+    struct Open {
+        size_t index = 0;        // 容器在sizes中的下标
+        bool   hasValue = false; // 当前元素(上一个','之后)是否已出现值
+    };
+    SmallStack<Open, 64> open; // 未闭合的容器
+    // 当前容器里出现了值：同一个元素(包括对象成员的key与value)只计一次
+    auto seeValue = [&]() {
+        if (open.empty() || open.top().hasValue) return;
+        open.top().hasValue = true;
+        sizes[open.top().index]++;
+    };
+
+    sizes.clear();
+    const char* p = json.data();
+    const char* end = p + json.size();
+    while (true) {
+        while (p < end && isSpace(*p)) p++;
+        if (p < end && !structural[static_cast<unsigned char>(*p)]) {
+            seeValue();
+            while (p < end && !structural[static_cast<unsigned char>(*p)]) p++;
+        }
+        if (p == end) break;
+        switch (*p++) {
+            case '"':
+                seeValue();
+                // 找到未被转义的'"'：其前连续的'\\'为偶数个
+                while (true) {
+                    auto q = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+                    if (q == nullptr) return;
+                    size_t backslashes = 0;
+                    while (q - backslashes > p && q[-1 - static_cast<ptrdiff_t>(backslashes)] == '\\') backslashes++;
+                    p = q + 1;
+                    if (backslashes % 2 == 0) break;
+                }
+                break;
+            case '[':
+            case '{':
+                seeValue();
+                sizes.push_back(0);
+                open.push(Open{sizes.size() - 1, false});
+                break;
+            case ']':
+            case '}':
+                if (!open.empty()) open.pop();
+                break;
+            case ',':
+                if (!open.empty()) open.top().hasValue = false;
+                break;
+        }
+    }
+}
+
+// key的共享表：开放寻址，以Value持有字符串节点，相同内容的key返回同一节点的引用。
+// 条目数与key的长度有上限，超出时返回新建的Value，避免key各不相同的文档使表无限增长
+class KeyTable {
+public:
+    static constexpr size_t kMaxKeys = 4096;
+    static constexpr size_t kMaxKeyLength = 128;
+
+    Value intern(std::string_view key) {
+        if (key.size() > kMaxKeyLength) return Value(key);
+        if (slots_.empty()) slots_.resize(64);
+
+        uint64_t hash = hashBytes(key, 0);
+        size_t mask = slots_.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        for (; !slots_[i].key.isNull(); i = (i + 1) & mask) {
+            if (slots_[i].hash == hash && slots_[i].key.getStringView() == key) return slots_[i].key;
+        }
+        if (size_ >= kMaxKeys) return Value(key);
+
+        slots_[i] = {hash, Value(key)};
+        Value shared = slots_[i].key;
+        if (++size_ * 2 > slots_.size()) rehash();
+        return shared;
+    }
+
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        Value    key;  // null表示空位
+    };
+
+    void rehash() {
+        std::vector<Slot> old(slots_.size() * 2);
+        old.swap(slots_);
+        size_t mask = slots_.size() - 1;
+        for (auto& slot: old) {
+            if (slot.key.isNull()) continue;
+            size_t i = static_cast<size_t>(slot.hash) & mask;
+            while (!slots_[i].key.isNull()) i = (i + 1) & mask;
+            slots_[i] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t            size_ = 0;
+};
+
+} // namespace detail
+
 class Document: public Value {
 public:
     ParseError parse(const std::string_view& json) {
         StringReadStream is(json);
-        return parseStream(is);
+        clear();
+        prepare(json);
+        return parseImpl(is);
     }
 
     ParseError parse(const char* json, size_t len) {
         return parse(std::string_view(json, len));
     }
 
-    template <typename ReadStream, 
-              typename = std::enable_if_t<std::is_same<ReadStream, StringReadStream>::value ||
-                                          std::is_same<ReadStream, FileReadStream>::value>>
+    // std::string与C字符串自带'\0'结尾，走无边界检查的PaddedReadStream
+    ParseError parse(const std::string& json) {
+        PaddedReadStream is(json);
+        clear();
+        prepare(json);
+        return parseImpl(is);
+    }
+
+    ParseError parse(const char* json) {
+        PaddedReadStream is(json);
+        clear();
+        prepare(json);
+        return parseImpl(is);
+    }
+
+    // ReadStream需满足Reader.hpp中描述的接口
+    // 任意ReadStream无法预扫描，不受setExactReserve()影响
+    template <typename ReadStream>
     ParseError parseStream(ReadStream& is) {
-        return Reader::parse(is, *this);
+        clear();
+        return parseImpl(is);
     }
 
+    // 从流的当前位置解析一个JSON值，之后的内容留在流中，见Reader::parseNext()。
+    // 同样不受setExactReserve()影响
+    template <typename ReadStream>
+    ParseError parseNext(ReadStream& is) {
+        clear();
+        return parseImpl(is, false);
+    }
+
+    // 释放当前内容以便再次解析，内部栈的容量保留；parse()前会自动调用。
+    // 经由MsgPackReader等直接驱动Document时，解析失败后须先调用clear()再复用
+    void clear() {
+        static_cast<Value&>(*this) = Value();
+        stack_.clear();
+        key_ = Value();
+        seeValue_ = false;
+        packing_ = false;
+        packedSize_ = 0;
+        packedInts_.clear();
+        packedDoubles_.clear();
+        sizes_.clear();
+        nextSize_ = 0;
+    }
+
+    // 之后的parse()允许的最大嵌套层数，默认为kDefaultMaxDepth
+    void setMaxDepth(size_t maxDepth) { maxDepth_ = maxDepth; }
+
+    // 开启后，从内存中的字符串解析时先预扫描一遍输入，统计每个数组与对象的元素个数，
+    // 建树时按最终大小一次预留，避免容器逐步扩容。适合含大量大数组或大对象的文档
+    void setExactReserve(bool exact) { exactReserve_ = exact; }
+
+    // 开启后，数字不在解析时转换，而是保留原文(见Value::rawNumber())，每次getInt64()/getDouble()时转换，
+    // Writer原样输出原文。适合只转发而很少读取数字的场景，且超出int64的整数与"1.50"等写法不会改变
+    void setRawNumbers(bool raw) { rawNumbers_ = raw; }
+
+    // 开启后，对象的key经由Document内的共享表创建，内容相同的key共享同一个字符串节点：
+    // 结构相同的大量记录只为每个key分配一次，KeyHandle在这些记录中查找时只需比较指针。
+    // 共享表在多次parse()之间保留(上限见detail::KeyTable)，关闭时释放
+    void setSharedKeys(bool shared) {
+        sharedKeys_ = shared;
+        if (!shared) keys_.clear();
+    }
+
+    // 开启后，元素个数不少于kMinPackedSize且全为整数或全为浮点数的数组以紧凑形式存储(见Value::packed())，
+    // 每个元素占8字节而非16字节，可经由getInt64s()/getDoubles()直接遍历。适合含大量数值数组的文档；
+    // 与setRawNumbers()同时开启时不生效
+    void setPackedArrays(bool packed) { packedArrays_ = packed; }
+    static constexpr size_t kMinPackedSize = 4;
+
 public:
     bool Null() {
         addValue(Value(ValueType::TYPE_NULL));
@@ -44,15 +240,18 @@ public:
         return true;
     }
     bool Int32(int32_t i32) {
-        addValue(Value(i32));
+        if (packing_ && packedDoubles_.empty()) packedInts_.push_back(i32);
+        else addValue(Value(i32));
         return true;
     }
     bool Int64(int64_t i64) {
-        addValue(Value(i64));
+        if (packing_ && packedDoubles_.empty()) packedInts_.push_back(i64);
+        else addValue(Value(i64));
         return true;
     }
     bool Double(double d) {
-        addValue(Value(d));
+        if (packing_ && packedInts_.empty()) packedDoubles_.push_back(d);
+        else addValue(Value(d));
         return true;
     }
     bool String(const std::string_view& s) {
@@ -61,11 +260,12 @@ public:
     }
     bool StartObject() {
         auto value = addValue(Value(ValueType::TYPE_OBJECT));
+        if (nextSize_ < sizes_.size()) value->reserve(sizes_[nextSize_++]);
         stack_.emplace_back(value);
         return true;
     }
     bool Key(std::string_view s) {
-        addValue(Value(s));
+        addValue(sharedKeys_ ? keys_.intern(s) : Value(s));
         return true;
     }
     bool EndObject() {
@@ -76,20 +276,97 @@ public:
     }
     bool StartArray() {
         auto value = addValue(Value(ValueType::TYPE_ARRAY));
+        size_t size = nextSize_ < sizes_.size() ? sizes_[nextSize_++] : 0;
         stack_.emplace_back(value);
+        if (packedArrays_) {
+            // 数字先暂存，数组结束时再决定是否紧凑存储
+            packing_ = true;
+            packedSize_ = size;
+        }
+        else if (size > 0) {
+            value->reserve(size);
+        }
         return true;
     }
     bool EndArray() {
         assert(!stack_.empty());
         assert(stack_.back().type() == ValueType::TYPE_ARRAY);
+        if (packing_) endPacking();
         stack_.pop_back();
         return true;
     }
 
 private:
+    template <typename ReadStream>
+    ParseError parseImpl(ReadStream& is, bool singular = true) {
+        if (rawNumbers_) {
+            RawNumberHandler handler{*this};
+            return singular ? Reader::parse(is, handler, maxDepth_) : Reader::parseNext(is, handler, maxDepth_);
+        }
+        return singular ? Reader::parse(is, *this, maxDepth_) : Reader::parseNext(is, *this, maxDepth_);
+    }
+
+    // 开启setRawNumbers()时代替Document作为Handler，多出RawNumber()，其余回调原样转发
+    struct RawNumberHandler {
+        Document& doc;
+
+        bool Null  ()                   { return doc.Null(); }
+        bool Bool  (bool b)             { return doc.Bool(b); }
+        bool Int32 (int32_t i32)        { return doc.Int32(i32); }
+        bool Int64 (int64_t i64)        { return doc.Int64(i64); }
+        bool Double(double d)           { return doc.Double(d); }
+        bool String(std::string_view s) { return doc.String(s); }
+        bool Key   (std::string_view s) { return doc.Key(s); }
+        bool StartObject()              { return doc.StartObject(); }
+        bool EndObject  ()              { return doc.EndObject(); }
+        bool StartArray ()              { return doc.StartArray(); }
+        bool EndArray   ()              { return doc.EndArray(); }
+        bool RawNumber(std::string_view s) {
+            doc.addValue(Value::rawNumber(s));
+            return true;
+        }
+    };
+
+    void prepare(std::string_view json) {
+        if (exactReserve_) detail::countElements(json, sizes_);
+        else sizes_.clear();
+    }
+
+    // 暂存的数字转为普通元素，当前数组不再紧凑存储
+    void flushPacked() {
+        packing_ = false;
+        auto& top = stack_.back();
+        size_t n = packedInts_.size() + packedDoubles_.size();
+        top.value->reserve(std::max(n, packedSize_));
+        for (int64_t i64: packedInts_) {
+            if (i64 >= std::numeric_limits<int32_t>::min() && i64 <= std::numeric_limits<int32_t>::max())
+                top.value->addValue(Value(static_cast<int32_t>(i64)));
+            else
+                top.value->addValue(Value(i64));
+        }
+        for (double d: packedDoubles_) top.value->addValue(Value(d));
+        top.valueCount += static_cast<int>(n);
+        packedInts_.clear();
+        packedDoubles_.clear();
+    }
+
+    void endPacking() {
+        size_t n = packedInts_.size() + packedDoubles_.size();
+        if (n < kMinPackedSize) {
+            flushPacked();
+            return;
+        }
+        packing_ = false;
+        Value& array = *stack_.back().value;
+        if (!packedInts_.empty()) array = Value::packed(packedInts_.data(), n);
+        else array = Value::packed(packedDoubles_.data(), n);
+        packedInts_.clear();
+        packedDoubles_.clear();
+    }
+
     Value* addValue(Value&& value) {
-        ValueType type = value.getType();
-        (void)type;
+        // 数组中出现了非数字或另一类数字
+        if (packing_) flushPacked();
         if (seeValue_)
             assert(!stack_.empty() && "root not singular");
         else { 
@@ -113,7 +390,7 @@ private:
             assert(top.type() == ValueType::TYPE_OBJECT);
 
             if (top.valueCount % 2 == 0) {
-                assert(type == ValueType::TYPE_STRING && "miss quotation mark");
+                assert(value.type_ == ValueType::TYPE_STRING && "miss quotation mark");
                 key_ = std::move(value);
                 top.valueCount++;
                 return &key_;
@@ -152,6 +429,145 @@ private:
     std::vector<Level> stack_;
     Value key_;
     bool seeValue_ = false;
+    size_t maxDepth_ = kDefaultMaxDepth;
+    bool exactReserve_ = false;
+    bool rawNumbers_ = false;
+    bool sharedKeys_ = false;
+    detail::KeyTable keys_;
+    bool packedArrays_ = false;
+    bool packing_ = false;                // 最内层的数组仍可能紧凑存储
+    size_t packedSize_ = 0;               // 预扫描得到的元素个数，不紧凑存储时用于预留
+    std::vector<int64_t> packedInts_;     // 暂存的元素，最多一种非空
+    std::vector<double> packedDoubles_;
+    std::vector<uint32_t> sizes_; // 预扫描得到的各容器元素个数
+    size_t nextSize_ = 0;
+};
+
+// 逐个解析首尾相接或以空白分隔的多个JSON文档，输入只扫描一遍，各文档复用同一个Document及其缓冲区：
+//     DocumentStream stream(logs);
+//     for (Document& doc: stream) { ... }
+//     if (stream.error() != ParseError::PARSE_OK) ... // 出错的文档始于stream.offset()
+// 迭代得到的Document在下一次迭代时被覆盖，需要保留时移出或复制。解析选项经由document()设置
+class DocumentStream: noncopyable {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = Document;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Document*;
+        using reference         = Document&;
+
+        explicit Iterator(DocumentStream* stream): stream_(stream) { }
+
+        Document& operator* () const { return stream_->doc_; }
+        Document* operator->() const { return &stream_->doc_; }
+        Iterator& operator++() {
+            if (!stream_->next()) stream_ = nullptr;
+            return *this;
+        }
+        bool operator==(const Iterator& rhs) const { return stream_ == rhs.stream_; }
+        bool operator!=(const Iterator& rhs) const { return stream_ != rhs.stream_; }
+
+    private:
+        DocumentStream* stream_; // nullptr表示结束
+    };
+
+    explicit DocumentStream(std::string_view json): is_(json) { }
+
+    Document& document() { return doc_; }
+
+    // 解析下一个文档，输入结束或出错时返回false
+    bool next() {
+        if (error_ != ParseError::PARSE_OK || !Reader::hasNextValue(is_)) return false;
+        offset_ = is_.tell();
+        error_ = doc_.parseNext(is_);
+        if (error_ != ParseError::PARSE_OK) return false;
+        count_++;
+        return true;
+    }
+
+    // 只能遍历一次，begin()即解析第一个文档
+    Iterator begin() { return Iterator(next() ? this : nullptr); }
+    Iterator end  () { return Iterator(nullptr); }
+
+    // 出错时为错误码，offset()为出错文档的起始偏移；否则offset()为最近一个文档的起始偏移
+    ParseError error () const { return error_; }
+    size_t     offset() const { return offset_; }
+    // 已解析的文档数与已读取的字节数
+    size_t     count () const { return count_; }
+    size_t     tell  () const { return is_.tell(); }
+
+private:
+    StringReadStream is_;
+    Document         doc_;
+    ParseError       error_ = ParseError::PARSE_OK;
+    size_t           offset_ = 0;
+    size_t           count_ = 0;
+};
+
+// Document池，acquire()返回空的Document，句柄析构时清空后归还，Document内部的栈等缓冲区得以复用。
+// 配合NodePool开启节点缓存后，稳定状态下解析小消息几乎不分配内存：
+//     NodePool::local().setLimits(4096, 1 << 20);
+//     auto doc = DocumentPool::local().acquire();
+//     doc->parse(json);
+// 池不加锁，句柄须在取得它的线程上析构，且不能晚于池本身。
+class DocumentPool: noncopyable {
+public:
+    struct Releaser {
+        DocumentPool* pool;
+        void operator()(Document* doc) const { pool->release(doc); }
+    };
+    using Handle = std::unique_ptr<Document, Releaser>;
+
+    explicit DocumentPool(size_t maxDocuments = 16):
+            maxDocuments_(maxDocuments)
+    {
+        free_.reserve(maxDocuments_);
+    }
+
+    ~DocumentPool() {
+        for (auto* doc: free_) delete doc;
+    }
+
+    Handle acquire() {
+        Document* doc;
+        if (free_.empty()) {
+            doc = new Document;
+        }
+        else {
+            doc = free_.back();
+            free_.pop_back();
+        }
+        return Handle(doc, Releaser{this});
+    }
+
+    // 当前线程的池
+    static DocumentPool& local() {
+        thread_local DocumentPool pool;
+        return pool;
+    }
+
+    size_t available() const { return free_.size(); }
+
+private:
+    void release(Document* doc) {
+        if (free_.size() < maxDocuments_) {
+            doc->clear();
+            doc->setMaxDepth(kDefaultMaxDepth);
+            doc->setExactReserve(false);
+            doc->setRawNumbers(false);
+            doc->setSharedKeys(false);
+            doc->setPackedArrays(false);
+            free_.push_back(doc);
+        }
+        else {
+            delete doc;
+        }
+    }
+
+    const size_t           maxDocuments_;
+    std::vector<Document*> free_;
 };
 
 } // namespace json
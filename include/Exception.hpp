@@ -6,11 +6,15 @@
 
 #include <exception>
 #include <cassert>
+#include <cstddef>
 
 namespace mudong {
 
 namespace json {
 
+// Reader、MsgPackReader与CborReader默认允许的最大嵌套层数
+inline constexpr size_t kDefaultMaxDepth = 1024;
+
 #define ERROR_MAP(XX) \
     XX(OK, "ok") \
     XX(ROOT_NOT_SINGULAR, "root not singular") \
@@ -26,7 +30,8 @@ namespace json {
     XX(MISS_KEY, "miss key") \
     XX(MISS_COLON, "miss colon") \
     XX(MISS_COMMA_OR_CURLY_BRACKET, "miss comma or curly bracket") \
-    XX(USER_STOPPED, "user stopped parse")
+    XX(USER_STOPPED, "user stopped parse") \
+    XX(DEPTH_EXCEEDED, "nesting too deep")
 
 enum class ParseError: unsigned {
 #define GEN_ERRNO(e, s) PARSE_##e,
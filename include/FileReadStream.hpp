@@ -26,19 +26,24 @@ public:
             if (n == 0) break;
             buffer_.insert(buffer_.end(), buf, buf + n);
         }
+        // '\0'哨兵，peek()/next()无需边界检查，见PaddedReadStream
+        buffer_.push_back('\0');
 
         iter_ = buffer_.cbegin();
+        end_ = buffer_.cend() - 1;
     }
 
-    bool          hasNext     () const { return iter_ != buffer_.cend(); }
-    char          peek        () const { return hasNext() ? *iter_ : '\0'; }
+    bool          hasNext     () const { return iter_ < end_; }
+    char          peek        () const { return *iter_; }
     ConstIterator getConstIter() const { return iter_; }
-    char          next        ()       { return hasNext() ? *iter_++ : '\0'; }
+    size_t        tell        () const { return static_cast<size_t>(iter_ - buffer_.cbegin()); }
+    char          next        ()       { return *iter_++; }
     void          assertNext  (char c) { assert(peek() == c); next(); }
 
 private:
     std::vector<char> buffer_;
     ConstIterator     iter_;
+    ConstIterator     end_;
 };
 
 } // namespace json
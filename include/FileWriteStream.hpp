@@ -5,7 +5,10 @@
 #pragma once
 
 #include <cstdio>
+#include <cassert>
+#include <cstring>
 #include <string_view>
+#include <vector>
 
 #include "noncopyable.hpp"
 
@@ -15,14 +18,42 @@ namespace json {
 
 class FileWriteStream: noncopyable {
 public:
-    explicit FileWriteStream(FILE* output) : output_(output) { }
-    ~FileWriteStream() { fflush(output_); }
+    explicit FileWriteStream(FILE* output, size_t bufferSize = 65536) :
+        output_(output), buffer_(bufferSize), pos_(0) { }
+    ~FileWriteStream() { flush(); }
 
-    void put(char c)                      { fputc(c, output_); }
-    void put(const std::string_view& str) { fprintf(output_, "%.*s", static_cast<int>(str.size()), str.data()); }
+    void put(char c)                      { *reserve(1) = c; commit(1); }
+    void put(const std::string_view& str) {
+        if (str.size() >= buffer_.size()) {
+            flushBuffer();
+            fwrite(str.data(), 1, str.size(), output_);
+            return;
+        }
+        std::memcpy(reserve(str.size()), str.data(), str.size());
+        commit(str.size());
+    }
+
+    // 同StringWriteStream::reserve()/commit()
+    char* reserve(size_t n) {
+        if (buffer_.size() - pos_ < n) {
+            flushBuffer();
+            if (buffer_.size() < n) buffer_.resize(n);
+        }
+        return buffer_.data() + pos_;
+    }
+    void commit(size_t n) { assert(pos_ + n <= buffer_.size()); pos_ += n; }
+
+    void flush() { flushBuffer(); fflush(output_); }
 
 private:
-    FILE* output_;
+    void flushBuffer() {
+        if (pos_ > 0) fwrite(buffer_.data(), 1, pos_, output_);
+        pos_ = 0;
+    }
+
+    FILE*             output_;
+    std::vector<char> buffer_;
+    size_t            pos_;
 };
 
 } // namespace json
@@ -30,5 +61,5 @@ private:
 } // namespace mudong
 
 /*
-使用带缓冲的写，FileWriteStream对象析构时，调用fflush清空缓冲区，防止缓冲区中暂存的数据丢失
-*/
\ No newline at end of file
+使用带缓冲的写，数据先写入buffer_，满后整体fwrite；FileWriteStream对象析构时，调用flush清空缓冲区，防止缓冲区中暂存的数据丢失
+*/
@@ -0,0 +1,181 @@
+//
+// Created by mudong on 24-03-02.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "Exception.hpp"
+#include "Value.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 解析MessagePack数据并向Handler发送与Reader相同的事件，可直接构建Document。
+// 字符串以指向输入的string_view传给Handler，无需拷贝。
+// map的键必须为字符串；bin、ext不能表示为JSON，视为PARSE_BAD_VALUE；
+// 超出int64范围的uint64与Reader相同，Handler提供Uint64()时交给它，否则视为PARSE_NUMBER_TOO_BIG。
+class MsgPackReader: noncopyable {
+public:
+    // maxDepth为array与map的最大嵌套层数，超过时返回PARSE_DEPTH_EXCEEDED
+    template <typename Handler>
+    static ParseError parse(std::string_view data, Handler& handler, size_t maxDepth = kDefaultMaxDepth) {
+        try {
+            Input in{data.data(), data.data() + data.size(), maxDepth};
+            parseValue(in, handler);
+            if (in.cur != in.end) throw Exception(ParseError::PARSE_ROOT_NOT_SINGULAR);
+            return ParseError::PARSE_OK;
+        }
+        catch (Exception& e) {
+            return e.err();
+        }
+    }
+
+private:
+#define CALL(expr) if (!(expr)) throw Exception(ParseError::PARSE_USER_STOPPED)
+
+    struct Input {
+        const char* cur;
+        const char* end;
+        size_t      maxDepth;
+        size_t      depth = 0;
+
+        void enter() {
+            if (depth++ >= maxDepth) throw Exception(ParseError::PARSE_DEPTH_EXCEEDED);
+        }
+        void leave() { depth--; }
+
+        const char* take(size_t n) {
+            if (static_cast<size_t>(end - cur) < n)
+                throw Exception(ParseError::PARSE_EXPECT_VALUE);
+            const char* p = cur;
+            cur += n;
+            return p;
+        }
+        uint8_t byte() { return static_cast<uint8_t>(*take(1)); }
+
+        template <typename T>
+        T bigEndian() {
+            const char* p = take(sizeof(T));
+            uint64_t v = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+                v = (v << 8) | static_cast<uint8_t>(p[i]);
+            return static_cast<T>(v);
+        }
+    };
+
+    template <typename Handler>
+    static void parseInt(Handler& handler, int64_t i64) {
+        if (i64 <= std::numeric_limits<int32_t>::max() &&
+            i64 >= std::numeric_limits<int32_t>::min()) {
+            CALL(handler.Int32(static_cast<int32_t>(i64)));
+        }
+        else {
+            CALL(handler.Int64(i64));
+        }
+    }
+
+    template <typename Handler>
+    static void parseUint(Handler& handler, uint64_t u64) {
+        if (u64 > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            if constexpr (detail::HasUint64<Handler>::value) {
+                CALL(handler.Uint64(u64));
+                return;
+            }
+            throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
+        }
+        parseInt(handler, static_cast<int64_t>(u64));
+    }
+
+    template <typename Handler>
+    static void parseArray(Input& in, Handler& handler, uint32_t n) {
+        in.enter();
+        CALL(handler.StartArray());
+        for (uint32_t i = 0; i < n; ++i)
+            parseValue(in, handler);
+        CALL(handler.EndArray());
+        in.leave();
+    }
+
+    template <typename Handler>
+    static void parseMap(Input& in, Handler& handler, uint32_t n) {
+        in.enter();
+        CALL(handler.StartObject());
+        for (uint32_t i = 0; i < n; ++i) {
+            uint8_t tag = in.byte();
+            size_t len;
+            if ((tag & 0xe0) == 0xa0) len = tag & 0x1f;
+            else if (tag == 0xd9)     len = in.bigEndian<uint8_t>();
+            else if (tag == 0xda)     len = in.bigEndian<uint16_t>();
+            else if (tag == 0xdb)     len = in.bigEndian<uint32_t>();
+            else throw Exception(ParseError::PARSE_MISS_KEY);
+            CALL(handler.Key(std::string_view(in.take(len), len)));
+            parseValue(in, handler);
+        }
+        CALL(handler.EndObject());
+        in.leave();
+    }
+
+    template <typename Handler>
+    static void parseString(Input& in, Handler& handler, size_t len) {
+        CALL(handler.String(std::string_view(in.take(len), len)));
+    }
+
+    template <typename Handler>
+    static void parseValue(Input& in, Handler& handler) {
+        uint8_t tag = in.byte();
+
+        if (tag < 0x80) return parseInt(handler, tag);                        // positive fixint
+        if (tag >= 0xe0) return parseInt(handler, static_cast<int8_t>(tag));  // negative fixint
+        if ((tag & 0xf0) == 0x80) return parseMap(in, handler, tag & 0x0f);   // fixmap
+        if ((tag & 0xf0) == 0x90) return parseArray(in, handler, tag & 0x0f); // fixarray
+        if ((tag & 0xe0) == 0xa0) return parseString(in, handler, tag & 0x1f);// fixstr
+
+        switch (tag) {
+            case 0xc0: CALL(handler.Null());       return;
+            case 0xc2: CALL(handler.Bool(false));  return;
+            case 0xc3: CALL(handler.Bool(true));   return;
+            case 0xca: {
+                uint32_t bits = in.bigEndian<uint32_t>();
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                CALL(handler.Double(static_cast<double>(f)));
+                return;
+            }
+            case 0xcb: {
+                uint64_t bits = in.bigEndian<uint64_t>();
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                CALL(handler.Double(d));
+                return;
+            }
+            case 0xcc: return parseUint(handler, in.bigEndian<uint8_t>());
+            case 0xcd: return parseUint(handler, in.bigEndian<uint16_t>());
+            case 0xce: return parseUint(handler, in.bigEndian<uint32_t>());
+            case 0xcf: return parseUint(handler, in.bigEndian<uint64_t>());
+            case 0xd0: return parseInt(handler, in.bigEndian<int8_t>());
+            case 0xd1: return parseInt(handler, in.bigEndian<int16_t>());
+            case 0xd2: return parseInt(handler, in.bigEndian<int32_t>());
+            case 0xd3: return parseInt(handler, in.bigEndian<int64_t>());
+            case 0xd9: return parseString(in, handler, in.bigEndian<uint8_t>());
+            case 0xda: return parseString(in, handler, in.bigEndian<uint16_t>());
+            case 0xdb: return parseString(in, handler, in.bigEndian<uint32_t>());
+            case 0xdc: return parseArray(in, handler, in.bigEndian<uint16_t>());
+            case 0xdd: return parseArray(in, handler, in.bigEndian<uint32_t>());
+            case 0xde: return parseMap(in, handler, in.bigEndian<uint16_t>());
+            case 0xdf: return parseMap(in, handler, in.bigEndian<uint32_t>());
+            default:   throw Exception(ParseError::PARSE_BAD_VALUE); // nil-reserved, bin, ext
+        }
+    }
+#undef CALL
+};
+
+} // namespace json
+
+} // namespace mudong
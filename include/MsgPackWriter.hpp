@@ -0,0 +1,222 @@
+//
+// Created by mudong on 24-03-02.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// MessagePack格式的Handler，接口与Writer一致，可作为Value::writeTo()和Reader::parse()的目标。
+//
+// MessagePack的array/map头部需要预先写出元素个数，而Handler事件流直到End*才知道个数。
+// 因此容器内的数据先写入内部缓冲区，并记录每个容器头部应插入的位置；根值结束时，
+// 按位置顺序将数据段与最紧凑的头部交替写入WriteStream，无需移动已编码的数据。
+template <typename WriteStream>
+class MsgPackWriter: noncopyable {
+public:
+    explicit MsgPackWriter(WriteStream& os):
+            os_(os), seeValue_(false)
+    {}
+
+    bool Null() {
+        if (!prefix()) return false;
+        putByte(0xc0);
+        return true;
+    }
+
+    bool Bool(bool b) {
+        if (!prefix()) return false;
+        putByte(b ? 0xc3 : 0xc2);
+        return true;
+    }
+
+    bool Int32(int32_t i32) {
+        return Int64(i32);
+    }
+
+    bool Int64(int64_t i64) {
+        if (!prefix()) return false;
+        if (i64 >= 0) {
+            auto u = static_cast<uint64_t>(i64);
+            if (u < 0x80)             putByte(static_cast<uint8_t>(u)); // positive fixint
+            else if (u <= 0xff)       { putByte(0xcc); putBigEndian<uint8_t>(u); }
+            else if (u <= 0xffff)     { putByte(0xcd); putBigEndian<uint16_t>(u); }
+            else if (u <= 0xffffffff) { putByte(0xce); putBigEndian<uint32_t>(u); }
+            else                      { putByte(0xcf); putBigEndian<uint64_t>(u); }
+        }
+        else {
+            auto u = static_cast<uint64_t>(i64);
+            if (i64 >= -32)                 putByte(static_cast<uint8_t>(u)); // negative fixint
+            else if (i64 >= INT8_MIN)       { putByte(0xd0); putBigEndian<uint8_t>(u); }
+            else if (i64 >= INT16_MIN)      { putByte(0xd1); putBigEndian<uint16_t>(u); }
+            else if (i64 >= INT32_MIN)      { putByte(0xd2); putBigEndian<uint32_t>(u); }
+            else                            { putByte(0xd3); putBigEndian<uint64_t>(u); }
+        }
+        return true;
+    }
+
+    bool Double(double d) {
+        if (!prefix()) return false;
+        // 能无损表示为float的值使用float32编码
+        auto f = static_cast<float>(d);
+        if (static_cast<double>(f) == d) {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            putByte(0xca);
+            putBigEndian<uint32_t>(bits);
+        }
+        else {
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            putByte(0xcb);
+            putBigEndian<uint64_t>(bits);
+        }
+        return true;
+    }
+
+    bool String(std::string_view s) {
+        if (!prefix()) return false;
+        putString(s);
+        return true;
+    }
+
+    bool StartObject() {
+        if (!prefix()) return false;
+        startContainer(true);
+        return true;
+    }
+
+    bool Key(std::string_view s) {
+        assert(!stack_.empty() && headers_[stack_.back()].isMap);
+        putString(s);
+        return true;
+    }
+
+    bool EndObject() {
+        assert(!stack_.empty() && headers_[stack_.back()].isMap);
+        endContainer();
+        return true;
+    }
+
+    bool StartArray() {
+        if (!prefix()) return false;
+        startContainer(false);
+        return true;
+    }
+
+    bool EndArray() {
+        assert(!stack_.empty() && !headers_[stack_.back()].isMap);
+        endContainer();
+        return true;
+    }
+
+private:
+    struct Header {
+        Header(size_t offset_, bool isMap_):
+                offset(offset_), count(0), isMap(isMap_)
+        {}
+        size_t   offset; // 头部在buffer_中的插入位置
+        uint32_t count;
+        bool     isMap;
+    };
+
+    // 与Writer相同，根值之后再写入值时返回false，不输出任何内容
+    bool prefix() {
+        if (!seeValue_)
+            seeValue_ = true;
+        else if (stack_.empty())
+            return false;
+
+        if (!stack_.empty()) headers_[stack_.back()].count++;
+        return true;
+    }
+
+    void startContainer(bool isMap) {
+        stack_.push_back(headers_.size());
+        headers_.emplace_back(buffer_.size(), isMap);
+    }
+
+    void endContainer() {
+        stack_.pop_back();
+        if (stack_.empty()) flush();
+    }
+
+    // 根值完整后，将缓冲区与各容器头部合并写出
+    void flush() {
+        size_t pos = 0;
+        for (auto& header: headers_) {
+            os_.put(std::string_view(buffer_.data() + pos, header.offset - pos));
+            pos = header.offset;
+
+            char buf[5];
+            size_t n = 0;
+            uint32_t c = header.count;
+            if (c < 16) {
+                buf[n++] = static_cast<char>((header.isMap ? 0x80 : 0x90) | c);
+            }
+            else if (c <= 0xffff) {
+                buf[n++] = static_cast<char>(header.isMap ? 0xde : 0xdc);
+                buf[n++] = static_cast<char>(c >> 8);
+                buf[n++] = static_cast<char>(c);
+            }
+            else {
+                buf[n++] = static_cast<char>(header.isMap ? 0xdf : 0xdd);
+                for (int shift = 24; shift >= 0; shift -= 8)
+                    buf[n++] = static_cast<char>(c >> shift);
+            }
+            os_.put(std::string_view(buf, n));
+        }
+        os_.put(std::string_view(buffer_.data() + pos, buffer_.size() - pos));
+        buffer_.clear();
+        headers_.clear();
+    }
+
+    void putString(std::string_view s) {
+        auto n = s.size();
+        if (n < 32)               putByte(static_cast<uint8_t>(0xa0 | n)); // fixstr
+        else if (n <= 0xff)       { putByte(0xd9); putBigEndian<uint8_t>(n); }
+        else if (n <= 0xffff)     { putByte(0xda); putBigEndian<uint16_t>(n); }
+        else                      { putByte(0xdb); putBigEndian<uint32_t>(n); }
+        putBytes(s.data(), n);
+    }
+
+    void putByte(uint8_t b) {
+        char c = static_cast<char>(b);
+        putBytes(&c, 1);
+    }
+
+    template <typename T>
+    void putBigEndian(uint64_t v) {
+        char buf[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i)
+            buf[i] = static_cast<char>(v >> (8 * (sizeof(T) - 1 - i)));
+        putBytes(buf, sizeof(T));
+    }
+
+    // 根为标量时直接写出，否则写入缓冲区等待头部
+    void putBytes(const char* data, size_t n) {
+        if (stack_.empty()) os_.put(std::string_view(data, n));
+        else buffer_.append(data, n);
+    }
+
+private:
+    std::vector<Header> headers_; // 按容器出现顺序排列，offset单调不减
+    std::vector<size_t> stack_;   // 未结束容器在headers_中的下标
+    std::string         buffer_;
+    WriteStream&        os_;
+    bool                seeValue_;
+};
+
+} // namespace json
+
+} // namespace mudong
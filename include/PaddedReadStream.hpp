@@ -0,0 +1,80 @@
+//
+// Created by mudong on 24-03-09.
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <cstring>
+#include <cassert>
+
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 末尾带有'\0'哨兵的连续输入流，peek()/next()不做边界检查。
+// Reader读到'\0'后立即结束，因此最多越过末尾一个字节，正好落在哨兵上；
+// 输入中间出现的'\0'由hasNext()区分，不会被误认为结束。
+class PaddedReadStream: noncopyable {
+public:
+    using ConstIterator = const char*;
+
+public:
+    // 拷贝json并追加哨兵，适用于不以'\0'结尾的string_view
+    explicit PaddedReadStream(std::string_view json):
+            buffer_(json),
+            begin_(buffer_.c_str()),
+            cur_(begin_),
+            end_(cur_ + buffer_.size())
+    {}
+
+    // 零拷贝：std::string与C字符串本身以'\0'结尾，只保存指针，json必须比本对象存活得更久
+    explicit PaddedReadStream(const std::string& json):
+            begin_(json.c_str()),
+            cur_(begin_),
+            end_(cur_ + json.size())
+    {}
+
+    // 临时的std::string移入本对象持有，避免流指向已析构的缓冲区
+    explicit PaddedReadStream(std::string&& json):
+            buffer_(std::move(json)),
+            begin_(buffer_.c_str()),
+            cur_(begin_),
+            end_(cur_ + buffer_.size())
+    {}
+
+    explicit PaddedReadStream(const char* json):
+            begin_(json),
+            cur_(json),
+            end_(json + std::strlen(json))
+    {}
+
+    PaddedReadStream(const char* json, size_t len):
+            begin_(json),
+            cur_(json),
+            end_(json + len)
+    {
+        assert(json[len] == '\0' && "missing sentinel");
+    }
+
+    bool          hasNext     () const { return cur_ < end_; }
+    char          peek        () const { return *cur_; }
+    ConstIterator getConstIter() const { return cur_; }
+    size_t        tell        () const { return static_cast<size_t>(cur_ - begin_); }
+    char          next        ()       { return *cur_++; }
+    void          assertNext  (char c) { assert(peek() == c); next(); }
+
+private:
+    std::string   buffer_; // 仅拷贝或移入时使用
+    ConstIterator begin_;
+    ConstIterator cur_;
+    ConstIterator end_;
+};
+
+} // namespace json
+
+} // namespace mudong
@@ -0,0 +1,116 @@
+//
+// Created by mudong on 24-03-12.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <mutex>
+
+namespace mudong {
+
+namespace json {
+
+enum class ValueType;
+
+// 单次解析的统计信息。
+// 统计只在编译时定义MUDONG_JSON_ENABLE_STATS时开启，未定义时所有计数点展开为空，
+// lastStats()恒为全0。该宏须在所有包含本库头文件的编译单元中保持一致。
+struct ParseStats {
+    static constexpr size_t kValueTypes = 9; // ValueType的个数，与枚举的一致性由Value.hpp中的static_assert检查
+
+    uint64_t bytes = 0;                 // 读取的输入字节数，ReadStream提供tell()时有效
+    uint64_t values[kValueTypes] = {};  // 按ValueType分类的值个数，不含key
+    uint64_t keys = 0;
+    uint64_t stringBytes = 0;           // 字符串与key解码后的字节数
+    uint64_t escapes = 0;               // 转义序列个数
+    uint64_t maxDepth = 0;              // 最大嵌套深度
+    // Value分配的节点与容器缓冲区、Reader字符串缓冲区的扩容，均按实际的容量变化记录。
+    // 字符串缓冲区在一个字符串中多次扩容时只计一次，Handler自身与标准库内部的分配不计入，
+    // 因此是近似值，精确的分配次数见test/alloc_counter.hpp
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t totalNanos = 0;            // 整个parse()耗时
+    uint64_t handlerNanos = 0;          // 其中Handler回调(如Document建树)的耗时
+
+    uint64_t count(ValueType type) const { return values[static_cast<size_t>(type)]; }
+    uint64_t readerNanos() const { return totalNanos - handlerNanos; }
+
+    ParseStats& operator+=(const ParseStats& rhs) {
+        bytes += rhs.bytes;
+        for (size_t i = 0; i < kValueTypes; i++) values[i] += rhs.values[i];
+        keys += rhs.keys;
+        stringBytes += rhs.stringBytes;
+        escapes += rhs.escapes;
+        if (rhs.maxDepth > maxDepth) maxDepth = rhs.maxDepth;
+        allocations += rhs.allocations;
+        allocatedBytes += rhs.allocatedBytes;
+        totalNanos += rhs.totalNanos;
+        handlerNanos += rhs.handlerNanos;
+        return *this;
+    }
+};
+
+// 多个线程的统计汇总，各线程解析后调用add(Reader::lastStats())
+class ParseStatsCollector {
+public:
+    void add(const ParseStats& stats) {
+        std::lock_guard lock(mutex_);
+        total_ += stats;
+        parses_++;
+    }
+
+    ParseStats total() const {
+        std::lock_guard lock(mutex_);
+        return total_;
+    }
+
+    uint64_t parses() const {
+        std::lock_guard lock(mutex_);
+        return parses_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    ParseStats         total_;
+    uint64_t           parses_ = 0;
+};
+
+namespace detail {
+
+// 当前线程正在进行的解析的统计，计数点直接累加到这里
+inline ParseStats& activeStats() {
+    thread_local ParseStats stats;
+    return stats;
+}
+
+// 当前线程最近一次完成的解析的统计
+inline ParseStats& lastStats() {
+    thread_local ParseStats stats;
+    return stats;
+}
+
+inline uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+#ifdef MUDONG_JSON_ENABLE_STATS
+#define MUDONG_JSON_STATS(stmt) do { stmt; } while (0)
+#else
+#define MUDONG_JSON_STATS(stmt) do { } while (0)
+#endif
+
+inline void recordAllocation(size_t bytes) {
+    auto& stats = activeStats();
+    stats.allocations++;
+    stats.allocatedBytes += bytes;
+}
+
+} // namespace detail
+
+} // namespace json
+
+} // namespace mudong
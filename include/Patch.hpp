@@ -0,0 +1,523 @@
+//
+// Created by mudong on 24-03-20.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <string_view>
+
+#include "Value.hpp"
+
+namespace mudong {
+
+namespace json {
+
+#define PATCH_ERROR_MAP(XX) \
+    XX(OK, "ok") \
+    XX(NOT_ARRAY, "patch is not an array") \
+    XX(BAD_OPERATION, "bad operation") \
+    XX(BAD_POINTER, "bad JSON pointer") \
+    XX(PATH_NOT_FOUND, "path not found") \
+    XX(MOVE_INTO_CHILD, "move into its own child") \
+    XX(TEST_FAILED, "test failed")
+
+enum class PatchError: unsigned {
+#define GEN_ERRNO(e, s) PATCH_##e,
+    PATCH_ERROR_MAP(GEN_ERRNO)
+#undef GEN_ERRNO
+};
+
+inline const char* patchErrorStr(PatchError err) {
+    static const char* tab[] = {
+#define GEN_STRERR(e, n) n,
+            PATCH_ERROR_MAP(GEN_STRERR)
+#undef GEN_STRERR
+    };
+
+    assert(unsigned(err) < sizeof(tab) / sizeof(tab[0]));
+    return tab[unsigned(err)];
+}
+
+#undef PATCH_ERROR_MAP
+
+// JSON Patch(RFC 6902)与JSON Merge Patch(RFC 7396)，以及生成JSON Patch的diff。
+//
+// 修改沿用Value的引用计数共享：沿路径逐层下行时，被其他Value共享的数组与对象换成一份浅拷贝，
+// 子值只增加引用计数；独占的容器原地修改，未修改的子树始终共享。修改前保存的Value副本因此不受影响，
+// 一次操作的开销取决于路径上各容器的宽度，与文档的大小无关。路径上的容器视为被修改，
+// 其序列化与hash缓存失效。
+class Patch {
+public:
+    // 依次执行patch中的操作。atomic为true时任一操作失败则target保持不变：每次修改记录被替换或删除的值，
+    // 失败时逆序撤销，记录的开销与修改的数量成正比；为false时失败前的操作已生效
+    static inline PatchError apply(Value& target, const Value& patch, bool atomic = true);
+
+    // 按RFC 7396合并：patch中的对象逐个成员合并，值为null的成员被删除，其他值整体替换且与patch共享存储
+    static inline void merge(Value& target, const Value& patch);
+
+    // 生成将from变为to的JSON Patch。共享同一存储的子树直接跳过；数组按下标逐个比较，不识别元素的插入与移动；
+    // 生成的value与to共享存储
+    static inline Value diff(const Value& from, const Value& to);
+
+    // 按JSON Pointer(RFC 6901)查找，路径不存在或pointer不合法时返回nullptr。
+    // 紧凑数组(见Value::packed())的元素没有Value对象，也返回nullptr
+    static const Value* find(const Value& root, std::string_view pointer) {
+        std::vector<std::string> tokens;
+        if (!parsePointer(pointer, tokens)) return nullptr;
+        return find(root, tokens, tokens.size());
+    }
+
+private:
+    using Tokens = std::vector<std::string>;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // 拆分为逐层的token并还原"~1"与"~0"
+    static bool parsePointer(std::string_view pointer, Tokens& tokens) {
+        tokens.clear();
+        if (pointer.empty()) return true;
+        if (pointer[0] != '/') return false;
+        size_t i = 1;
+        while (true) {
+            std::string token;
+            while (i < pointer.size() && pointer[i] != '/') {
+                char ch = pointer[i++];
+                if (ch == '~') {
+                    if (i == pointer.size()) return false;
+                    char escaped = pointer[i++];
+                    if (escaped == '0') token += '~';
+                    else if (escaped == '1') token += '/';
+                    else return false;
+                }
+                else token += ch;
+            }
+            tokens.push_back(std::move(token));
+            if (i == pointer.size()) return true;
+            i++;
+        }
+    }
+
+    static void appendToken(std::string& path, std::string_view token) {
+        path += '/';
+        for (char ch: token) {
+            if (ch == '~') path += "~0";
+            else if (ch == '/') path += "~1";
+            else path += ch;
+        }
+    }
+
+    // 数组下标：十进制且无多余的前导0
+    static bool parseIndex(std::string_view token, size_t& index) {
+        if (token.empty() || token.size() > 18 || (token.size() > 1 && token[0] == '0')) return false;
+        index = 0;
+        for (char ch: token) {
+            if (ch < '0' || ch > '9') return false;
+            index = index * 10 + static_cast<size_t>(ch - '0');
+        }
+        return true;
+    }
+
+    // 子值在容器中的位置，不存在时返回npos
+    static size_t locate(const Value& value, const std::string& token) {
+        if (value.isObject()) {
+            auto iter = value.findMember(token);
+            return iter == value.cendMember() ? npos : static_cast<size_t>(iter - value.cbeginMember());
+        }
+        size_t index;
+        if (value.isArray() && parseIndex(token, index) && index < value.getSize()) return index;
+        return npos;
+    }
+
+    static const Value& childAt(const Value& value, size_t pos) {
+        return value.isArray() ? value.a_->data[pos] : value.o_->data[pos].value;
+    }
+
+    // 沿tokens的前n个下行
+    static const Value* find(const Value& root, const Tokens& tokens, size_t n) {
+        const Value* value = &root;
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = locate(*value, tokens[i]);
+            if (pos == npos || value->isPacked()) return nullptr;
+            value = &childAt(*value, pos);
+        }
+        return value;
+    }
+
+    // 与find()相同，但末端可以是紧凑数组的元素，此时在scratch中生成等值的临时Value；
+    // 只读，不修改文档，也就不会影响与之共享存储的副本
+    static const Value* findElement(const Value& root, const Tokens& tokens, Value& scratch) {
+        const Value* value = &root;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            size_t pos = locate(*value, tokens[i]);
+            if (pos == npos) return nullptr;
+            if (value->isPacked()) {
+                // 紧凑数组的元素都是数字，无法继续下行
+                if (i + 1 != tokens.size()) return nullptr;
+                scratch = value->packedAt(pos);
+                return &scratch;
+            }
+            value = &childAt(*value, pos);
+        }
+        return value;
+    }
+
+    // 即将修改容器：紧凑数组转为普通数组，被共享时换成副本，缓存失效
+    static void prepare(Value& container) {
+        container.unpack();
+        container.unshare();
+        container.touch();
+    }
+
+    // 沿tokens的前n个下行，途经的容器均已prepare()
+    static Value* walk(Value& root, const Tokens& tokens, size_t n) {
+        Value* value = &root;
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = locate(*value, tokens[i]);
+            if (pos == npos) return nullptr;
+            prepare(*value);
+            value = const_cast<Value*>(&childAt(*value, pos));
+        }
+        return value;
+    }
+
+    // 撤销一次修改所需的信息，原子执行失败时逆序回放
+    struct Undo {
+        enum Kind { kRoot, kAssign, kInsert, kErase };
+
+        Kind   kind;
+        Tokens path; // 被修改的位置，kRoot时为空
+        size_t pos;  // 在父容器中的下标
+        Value  old;  // kRoot、kAssign与kInsert时为修改前的值
+    };
+    using UndoLog = std::vector<Undo>;
+
+    static inline PatchError add(Value& root, const Tokens& path, Value value, UndoLog* undo);
+    static inline PatchError remove(Value& root, const Tokens& path, Value* removed, UndoLog* undo);
+    static inline PatchError replace(Value& root, const Tokens& path, const Value& value, UndoLog* undo);
+    static inline PatchError applyOne(Value& root, const Value& op, Tokens& path, Tokens& from, UndoLog* undo);
+    static inline void rollback(Value& root, UndoLog& undo);
+};
+
+inline PatchError Patch::apply(Value& target, const Value& patch, bool atomic) {
+    if (!patch.isArray()) return PatchError::PATCH_NOT_ARRAY;
+    // 元素都是数字，不是合法的操作
+    if (patch.isPacked()) return patch.getSize() == 0 ? PatchError::PATCH_OK : PatchError::PATCH_BAD_OPERATION;
+
+    UndoLog undo;
+    Tokens path, from;
+    for (auto& op: patch.getArray()) {
+        PatchError err = applyOne(target, op, path, from, atomic ? &undo : nullptr);
+        if (err != PatchError::PATCH_OK) {
+            if (atomic) rollback(target, undo);
+            return err;
+        }
+    }
+    return PatchError::PATCH_OK;
+}
+
+inline PatchError Patch::applyOne(Value& root, const Value& op, Tokens& path, Tokens& from, UndoLog* undo) {
+    if (!op.isObject()) return PatchError::PATCH_BAD_OPERATION;
+    auto member = [&op](std::string_view key) -> const Value* {
+        auto iter = op.findMember(key);
+        return iter == op.cendMember() ? nullptr : &iter->value;
+    };
+
+    const Value* name = member("op");
+    const Value* pathValue = member("path");
+    if (name == nullptr || !name->isString() || pathValue == nullptr || !pathValue->isString())
+        return PatchError::PATCH_BAD_OPERATION;
+    if (!parsePointer(pathValue->getStringView(), path)) return PatchError::PATCH_BAD_POINTER;
+
+    auto type = name->getStringView();
+    if (type == "remove") return remove(root, path, nullptr, undo);
+
+    if (type == "add" || type == "replace" || type == "test") {
+        const Value* value = member("value");
+        if (value == nullptr) return PatchError::PATCH_BAD_OPERATION;
+        if (type == "add") return add(root, path, *value, undo);
+        if (type == "replace") return replace(root, path, *value, undo);
+
+        Value scratch;
+        const Value* current = findElement(root, path, scratch);
+        if (current == nullptr) return PatchError::PATCH_PATH_NOT_FOUND;
+        // RFC 6902要求对象的比较与成员顺序无关
+        return current->equals(*value, true) ? PatchError::PATCH_OK : PatchError::PATCH_TEST_FAILED;
+    }
+
+    if (type == "move" || type == "copy") {
+        const Value* fromValue = member("from");
+        if (fromValue == nullptr || !fromValue->isString()) return PatchError::PATCH_BAD_OPERATION;
+        if (!parsePointer(fromValue->getStringView(), from)) return PatchError::PATCH_BAD_POINTER;
+
+        Value scratch;
+        const Value* source = findElement(root, from, scratch);
+        if (source == nullptr) return PatchError::PATCH_PATH_NOT_FOUND;
+        // 共享source的存储，之后经由任一位置的修改都会先复制
+        if (type == "copy") return add(root, path, *source, undo);
+
+        if (from == path) return PatchError::PATCH_OK;
+        if (from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin()))
+            return PatchError::PATCH_MOVE_INTO_CHILD;
+        Value moved;
+        PatchError err = remove(root, from, &moved, undo);
+        if (err != PatchError::PATCH_OK) return err;
+        return add(root, path, std::move(moved), undo);
+    }
+
+    return PatchError::PATCH_BAD_OPERATION;
+}
+
+inline PatchError Patch::add(Value& root, const Tokens& path, Value value, UndoLog* undo) {
+    if (path.empty()) {
+        if (undo != nullptr) undo->push_back({Undo::kRoot, Tokens(), 0, std::move(root)});
+        root = std::move(value);
+        return PatchError::PATCH_OK;
+    }
+    Value* parent = walk(root, path, path.size() - 1);
+    if (parent == nullptr) return PatchError::PATCH_PATH_NOT_FOUND;
+
+    const std::string& token = path.back();
+    if (parent->isObject()) {
+        size_t pos = locate(*parent, token);
+        prepare(*parent);
+        auto& members = parent->o_->data;
+        if (pos != npos) {
+            if (undo != nullptr) undo->push_back({Undo::kAssign, path, pos, std::move(members[pos].value)});
+            members[pos].value = std::move(value);
+        }
+        else {
+            if (undo != nullptr) undo->push_back({Undo::kErase, path, members.size(), Value()});
+            members.emplace_back(token, std::move(value));
+        }
+        return PatchError::PATCH_OK;
+    }
+    if (parent->isArray()) {
+        size_t index = parent->getSize();
+        if (token != "-") {
+            if (!parseIndex(token, index)) return PatchError::PATCH_BAD_POINTER;
+            if (index > parent->getSize()) return PatchError::PATCH_PATH_NOT_FOUND;
+        }
+        prepare(*parent);
+        auto& values = parent->a_->data;
+        if (undo != nullptr) undo->push_back({Undo::kErase, path, index, Value()});
+        values.insert(values.begin() + static_cast<ptrdiff_t>(index), std::move(value));
+        return PatchError::PATCH_OK;
+    }
+    return PatchError::PATCH_PATH_NOT_FOUND;
+}
+
+// 根不能删除
+inline PatchError Patch::remove(Value& root, const Tokens& path, Value* removed, UndoLog* undo) {
+    if (path.empty()) return PatchError::PATCH_BAD_POINTER;
+    Value* parent = walk(root, path, path.size() - 1);
+    if (parent == nullptr) return PatchError::PATCH_PATH_NOT_FOUND;
+
+    size_t pos = locate(*parent, path.back());
+    if (pos == npos) return PatchError::PATCH_PATH_NOT_FOUND;
+    prepare(*parent);
+    Value& child = const_cast<Value&>(childAt(*parent, pos));
+    if (removed != nullptr) *removed = child;
+    if (undo != nullptr) undo->push_back({Undo::kInsert, path, pos, std::move(child)});
+    if (parent->isArray()) {
+        auto& values = parent->a_->data;
+        values.erase(values.begin() + static_cast<ptrdiff_t>(pos));
+    }
+    else {
+        auto& members = parent->o_->data;
+        members.erase(members.begin() + static_cast<ptrdiff_t>(pos));
+    }
+    return PatchError::PATCH_OK;
+}
+
+inline PatchError Patch::replace(Value& root, const Tokens& path, const Value& value, UndoLog* undo) {
+    if (path.empty()) {
+        if (undo != nullptr) undo->push_back({Undo::kRoot, Tokens(), 0, std::move(root)});
+        root = value;
+        return PatchError::PATCH_OK;
+    }
+    Value* parent = walk(root, path, path.size() - 1);
+    if (parent == nullptr) return PatchError::PATCH_PATH_NOT_FOUND;
+
+    size_t pos = locate(*parent, path.back());
+    if (pos == npos) return PatchError::PATCH_PATH_NOT_FOUND;
+    prepare(*parent);
+    Value& child = const_cast<Value&>(childAt(*parent, pos));
+    if (undo != nullptr) undo->push_back({Undo::kAssign, path, pos, std::move(child)});
+    child = value;
+    return PatchError::PATCH_OK;
+}
+
+// 逆序撤销，每条记录执行时文档恰好处于该次修改之后的状态，其路径必然存在
+inline void Patch::rollback(Value& root, UndoLog& undo) {
+    for (auto iter = undo.rbegin(); iter != undo.rend(); ++iter) {
+        Undo& entry = *iter;
+        if (entry.kind == Undo::kRoot) {
+            root = std::move(entry.old);
+            continue;
+        }
+        Value* parent = walk(root, entry.path, entry.path.size() - 1);
+        assert(parent != nullptr);
+        prepare(*parent);
+        auto offset = static_cast<ptrdiff_t>(entry.pos);
+        if (parent->isArray()) {
+            auto& values = parent->a_->data;
+            if (entry.kind == Undo::kAssign) values[entry.pos] = std::move(entry.old);
+            else if (entry.kind == Undo::kInsert) values.insert(values.begin() + offset, std::move(entry.old));
+            else values.erase(values.begin() + offset);
+        }
+        else {
+            auto& members = parent->o_->data;
+            if (entry.kind == Undo::kAssign) members[entry.pos].value = std::move(entry.old);
+            else if (entry.kind == Undo::kInsert)
+                members.emplace(members.begin() + offset, entry.path.back(), std::move(entry.old));
+            else members.erase(members.begin() + offset);
+        }
+    }
+}
+
+inline void Patch::merge(Value& target, const Value& patch) {
+    struct Pair {
+        Value*       target;
+        const Value* patch;
+    };
+    detail::SmallStack<Pair, 32> stack;
+
+    stack.push({&target, &patch});
+    while (!stack.empty()) {
+        Pair pair = stack.top();
+        stack.pop();
+        Value& dst = *pair.target;
+        const Value& src = *pair.patch;
+        if (!src.isObject()) {
+            dst = src;
+            continue;
+        }
+        if (!dst.isObject()) dst.setObject();
+        else prepare(dst);
+
+        // 先完成本对象成员的增删与替换，再将需要合并的成员入栈，入栈的指针不会再因vector变化而失效
+        auto& members = dst.o_->data;
+        auto findKey = [&members](std::string_view key) {
+            return std::find_if(members.begin(), members.end(),
+                                [key](const Member& m) { return m.key.getStringView() == key; });
+        };
+        for (auto& m: src.getObject()) {
+            auto key = m.key.getStringView();
+            auto iter = findKey(key);
+            if (m.value.isNull()) {
+                if (iter != members.end()) members.erase(iter);
+            }
+            else if (m.value.isObject()) {
+                if (iter == members.end()) members.emplace_back(key, Value(ValueType::TYPE_OBJECT));
+            }
+            else {
+                if (iter == members.end()) members.emplace_back(key, Value(m.value));
+                else iter->value = m.value;
+            }
+        }
+        for (auto& m: src.getObject()) {
+            if (!m.value.isObject()) continue;
+            auto iter = findKey(m.key.getStringView());
+            assert(iter != members.end());
+            stack.push({&iter->value, &m.value});
+        }
+    }
+}
+
+inline Value Patch::diff(const Value& from, const Value& to) {
+    struct Item {
+        const Value* a;
+        const Value* b;
+        std::string  path;
+    };
+    std::vector<Item> stack;
+    std::vector<const Member*> sortedA, sortedB;
+    Value ops(ValueType::TYPE_ARRAY);
+
+    auto emit = [&ops](const char* op, const std::string& path, const Value* value) {
+        Value entry(ValueType::TYPE_OBJECT);
+        entry.reserve(value == nullptr ? 2 : 3);
+        entry.addMember("op", op);
+        entry.addMember("path", std::string_view(path));
+        if (value != nullptr) entry.addMember(Value("value"), Value(*value));
+        ops.addValue(std::move(entry));
+    };
+    auto childPath = [](const std::string& path, std::string_view token) {
+        std::string child = path;
+        appendToken(child, token);
+        return child;
+    };
+    auto byKey = [](const Member* l, const Member* r) { return l->key.getStringView() < r->key.getStringView(); };
+
+    stack.push_back({&from, &to, std::string()});
+    while (!stack.empty()) {
+        Item item = std::move(stack.back());
+        stack.pop_back();
+        const Value& a = *item.a;
+        const Value& b = *item.b;
+        if (&a == &b) continue;
+
+        // 紧凑数组不逐个比较元素，不同时整体替换
+        if (a.isArray() && b.isArray() && !a.isPacked() && !b.isPacked()) {
+            if (a.a_ == b.a_) continue; // 共享同一存储
+            auto& x = a.a_->data;
+            auto& y = b.a_->data;
+            size_t common = std::min(x.size(), y.size());
+            // 从尾部删除与追加，不影响前common个元素的下标
+            for (size_t i = x.size(); i > common; i--)
+                emit("remove", childPath(item.path, std::to_string(i - 1)), nullptr);
+            for (size_t i = common; i < y.size(); i++)
+                emit("add", childPath(item.path, std::to_string(i)), &y[i]);
+            for (size_t i = 0; i < common; i++)
+                stack.push_back({&x[i], &y[i], childPath(item.path, std::to_string(i))});
+            continue;
+        }
+
+        if (a.isObject() && b.isObject()) {
+            if (a.o_ == b.o_) continue;
+            auto& x = a.o_->data;
+            auto& y = b.o_->data;
+            // 成员顺序相同时按位置配对，否则按key排序后归并
+            size_t i = 0;
+            for (; i < x.size() && i < y.size() && x[i].key.getStringView() == y[i].key.getStringView(); i++)
+                stack.push_back({&x[i].value, &y[i].value, childPath(item.path, x[i].key.getStringView())});
+            if (i == x.size() && i == y.size()) continue;
+
+            sortedA.clear();
+            sortedB.clear();
+            for (size_t j = i; j < x.size(); j++) sortedA.push_back(&x[j]);
+            for (size_t j = i; j < y.size(); j++) sortedB.push_back(&y[j]);
+            std::sort(sortedA.begin(), sortedA.end(), byKey);
+            std::sort(sortedB.begin(), sortedB.end(), byKey);
+            auto p = sortedA.begin(), q = sortedB.begin();
+            while (p != sortedA.end() || q != sortedB.end()) {
+                if (q == sortedB.end() || (p != sortedA.end() && byKey(*p, *q))) {
+                    emit("remove", childPath(item.path, (*p)->key.getStringView()), nullptr);
+                    ++p;
+                }
+                else if (p == sortedA.end() || byKey(*q, *p)) {
+                    emit("add", childPath(item.path, (*q)->key.getStringView()), &(*q)->value);
+                    ++q;
+                }
+                else {
+                    stack.push_back({&(*p)->value, &(*q)->value, childPath(item.path, (*p)->key.getStringView())});
+                    ++p;
+                    ++q;
+                }
+            }
+            continue;
+        }
+
+        if (!a.equals(b)) emit("replace", item.path, &b);
+    }
+    return ops;
+}
+
+} // namespace json
+
+} // namespace mudong
@@ -5,12 +5,17 @@
 #pragma once
 
 #include <type_traits>
+#include <charconv>
+#include <cerrno>
+#include <cstdlib>
 #include <cmath>
+#include <limits>
 #include <string>
-#include <stdexcept>
+#include <vector>
 
 #include "Exception.hpp"
 #include "Value.hpp"
+#include "ParseStats.hpp"
 #include "FileReadStream.hpp"
 #include "StringReadStream.hpp"
 
@@ -18,15 +23,249 @@ namespace mudong {
 
 namespace json {
 
+// ReadStream concept，Reader只依赖以下接口：
+//     bool hasNext() const;      是否还有未读字符
+//     char peek() const;         返回下一个字符但不消耗，流结束时返回'\0'
+//     char next();               返回并消耗下一个字符，流结束时返回'\0'
+//     void assertNext(char c);   消耗下一个字符，调用方已确认其为c
+// Reader读到'\0'后必定立即结束(报错或停止)，因此流结束时next()可以不做边界检查而越过末尾一个字节，
+// 只要该字节为'\0'(见PaddedReadStream)。
+// 可选接口：ConstIterator getConstIter() const; 若提供，则迭代器之间的字符在内存中必须连续，
+// 数字将直接在原缓冲区上转换；否则先逐字符拷贝到局部缓冲区。
+// 可选接口：size_t tell() const; 返回已消耗的字节数，用于统计(见ParseStats.hpp)。
+template <typename ReadStream, typename = void>
+struct IsContiguousReadStream: std::false_type { };
+
+template <typename ReadStream>
+struct IsContiguousReadStream<ReadStream, std::void_t<decltype(std::declval<const ReadStream&>().getConstIter())>>:
+        std::true_type { };
+
+namespace detail {
+
+template <typename Stream, typename = void>
+struct HasTell: std::false_type { };
+
+template <typename Stream>
+struct HasTell<Stream, std::void_t<decltype(std::declval<const Stream&>().tell())>>: std::true_type { };
+
+template <typename Stream>
+size_t tellOrZero(const Stream& is) {
+    if constexpr (HasTell<Stream>::value) return is.tell();
+    else return 0;
+}
+
+// 包装用户Handler，统计值的个数与深度，并计时回调耗时
+template <typename Handler>
+class StatsHandler {
+public:
+    StatsHandler(Handler& handler, ParseStats& stats):
+            handler_(handler), stats_(stats)
+    {}
+
+    bool Null()                    { return value(ValueType::TYPE_NULL, [&]() { return handler_.Null(); }); }
+    bool Bool(bool b)              { return value(ValueType::TYPE_BOOL, [&]() { return handler_.Bool(b); }); }
+    bool Int32(int32_t i32)        { return value(ValueType::TYPE_INT32, [&]() { return handler_.Int32(i32); }); }
+    bool Int64(int64_t i64)        { return value(ValueType::TYPE_INT64, [&]() { return handler_.Int64(i64); }); }
+    bool Double(double d)          { return value(ValueType::TYPE_DOUBLE, [&]() { return handler_.Double(d); }); }
+    bool String(std::string_view s) {
+        stats_.stringBytes += s.size();
+        return value(ValueType::TYPE_STRING, [&]() { return handler_.String(s); });
+    }
+    // 仅当用户Handler接受数字原文时提供，按原文对应的类型计数
+    template <typename H = Handler, typename = std::enable_if_t<HasRawNumber<H>::value>>
+    bool RawNumber(std::string_view s) {
+        return value(rawNumberType(s), [&]() { return handler_.RawNumber(s); });
+    }
+    // 仅当用户Handler接受uint64时提供，计为int64
+    template <typename H = Handler, typename = std::enable_if_t<HasUint64<H>::value>>
+    bool Uint64(uint64_t u64) {
+        return value(ValueType::TYPE_INT64, [&]() { return handler_.Uint64(u64); });
+    }
+    bool Key(std::string_view s) {
+        stats_.keys++;
+        stats_.stringBytes += s.size();
+        return timed([&]() { return handler_.Key(s); });
+    }
+    bool StartArray() {
+        enter();
+        return value(ValueType::TYPE_ARRAY, [&]() { return handler_.StartArray(); });
+    }
+    bool EndArray() {
+        depth_--;
+        return timed([&]() { return handler_.EndArray(); });
+    }
+    bool StartObject() {
+        enter();
+        return value(ValueType::TYPE_OBJECT, [&]() { return handler_.StartObject(); });
+    }
+    bool EndObject() {
+        depth_--;
+        return timed([&]() { return handler_.EndObject(); });
+    }
+
+private:
+    template <typename F>
+    bool timed(F&& f) {
+        auto start = std::chrono::steady_clock::now();
+        bool ret = f();
+        stats_.handlerNanos += nanosSince(start);
+        return ret;
+    }
+
+    template <typename F>
+    bool value(ValueType type, F&& f) {
+        stats_.values[static_cast<size_t>(type)]++;
+        return timed(std::forward<F>(f));
+    }
+
+    void enter() {
+        if (++depth_ > stats_.maxDepth) stats_.maxDepth = depth_;
+    }
+
+    Handler&    handler_;
+    ParseStats& stats_;
+    uint64_t    depth_ = 0;
+};
+
+// 丢弃全部值，用于只校验语法
+struct NullHandler {
+    bool Null  ()                   { return true; }
+    bool Bool  (bool)               { return true; }
+    bool Int32 (int32_t)            { return true; }
+    bool Int64 (int64_t)            { return true; }
+    bool Double(double)             { return true; }
+    bool String(std::string_view)   { return true; }
+    bool Key   (std::string_view)   { return true; }
+    bool StartObject()              { return true; }
+    bool EndObject  ()              { return true; }
+    bool StartArray ()              { return true; }
+    bool EndArray   ()              { return true; }
+};
+
+// 每层容器的类型，对象为1，数组为0。前kInlineLevels层存放在对象内部，
+// 常见文档解析时不分配内存；更深时转移到堆上按倍数扩容。
+class LevelStack: noncopyable {
+public:
+    LevelStack() = default;
+
+    bool   empty() const { return size_ == 0; }
+    size_t size () const { return size_; }
+    bool   top  () const {
+        assert(size_ > 0);
+        size_t i = size_ - 1;
+        return (bits_[i / 64] >> (i % 64)) & 1;
+    }
+
+    void push(bool isObject) {
+        size_t word = size_ / 64, bit = size_ % 64;
+        if (word == capacity_) grow();
+        if (isObject) bits_[word] |= uint64_t(1) << bit;
+        else bits_[word] &= ~(uint64_t(1) << bit);
+        size_++;
+    }
+    void pop() { assert(size_ > 0); size_--; }
+
+private:
+    static constexpr size_t kInlineLevels = 512;
+
+    void grow() {
+        if (heap_.empty()) heap_.assign(inline_, inline_ + capacity_);
+        heap_.resize(capacity_ * 2);
+        bits_ = heap_.data();
+        capacity_ = heap_.size();
+    }
+
+    uint64_t              inline_[kInlineLevels / 64];
+    std::vector<uint64_t> heap_;
+    uint64_t*             bits_ = inline_;
+    size_t                capacity_ = kInlineLevels / 64; // 以uint64_t计
+    size_t                size_ = 0;
+};
+
+// 字符串解码用的缓冲区，从当前线程的缓存中借出，析构时归还，
+// 多次解析之间复用其容量。嵌套调用parse()时内层借到的是空缓冲区，互不影响。
+struct ScratchString: noncopyable {
+    static constexpr size_t kMaxRetained = 64 * 1024;
+
+    ScratchString(): buffer(std::move(cache())) {}
+    ~ScratchString() {
+        if (buffer.capacity() <= kMaxRetained) cache() = std::move(buffer);
+    }
+
+    static std::string& cache() {
+        thread_local std::string cache;
+        return cache;
+    }
+
+    std::string buffer;
+};
+
+} // namespace detail
+
 class Reader: noncopyable {
 public:
-    template <typename ReadStream, typename Handler,
-              typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
-    static ParseError parse(ReadStream& is, Handler& handler) {
+    // maxDepth为数组与对象的最大嵌套层数，超过时返回PARSE_DEPTH_EXCEEDED
+    template <typename ReadStream, typename Handler>
+    static ParseError parse(ReadStream& is, Handler& handler, size_t maxDepth = kDefaultMaxDepth) {
+        return parseTop(is, handler, maxDepth, true);
+    }
+
+    // 从is的当前位置解析一个JSON值，之后的内容留在流中，用于首尾相接或以空白分隔的多个JSON值(日志、套接字流)。
+    // 跳过前导空白，不读取值之后的字符，成功时is.tell()为该值结束处的偏移，可用同一个流与Handler继续调用；
+    // 流中只剩空白时返回PARSE_EXPECT_VALUE，可先用hasNextValue()判断。同一个Handler会收到多个根值，
+    // Writer须先调用setRootSeparator()
+    template <typename ReadStream, typename Handler>
+    static ParseError parseNext(ReadStream& is, Handler& handler, size_t maxDepth = kDefaultMaxDepth) {
+        return parseTop(is, handler, maxDepth, false);
+    }
+
+    // 跳过空白，返回流中是否还有内容
+    template <typename ReadStream>
+    static bool hasNextValue(ReadStream& is) {
+        parseWhiteSpace(is);
+        return is.hasNext();
+    }
+
+    // 检查json是否为单个合法的JSON值，用于插入原始片段(Value::raw())前校验不可信的输入。
+    // 数字照常转换，超出范围的数字与Document::parse()一样报PARSE_NUMBER_TOO_BIG
+    static ParseError validate(std::string_view json, size_t maxDepth = kDefaultMaxDepth) {
+        StringReadStream is(json);
+        detail::NullHandler handler;
+        return parseRoot(is, handler, maxDepth);
+    }
+
+    // 当前线程最近一次parse()的统计，需定义MUDONG_JSON_ENABLE_STATS，见ParseStats.hpp
+    static const ParseStats& lastStats() { return detail::lastStats(); }
+
+private:
+    template <typename Handler>
+    friend bool detail::writeRawValue(std::string_view json, Handler& handler);
+
+    template <typename ReadStream, typename Handler>
+    static ParseError parseTop(ReadStream& is, Handler& handler, size_t maxDepth, bool singular) {
+#ifdef MUDONG_JSON_ENABLE_STATS
+        auto& stats = detail::activeStats();
+        stats = ParseStats();
+        auto start = std::chrono::steady_clock::now();
+        size_t offset = detail::tellOrZero(is);
+        detail::StatsHandler<Handler> statsHandler(handler, stats);
+        ParseError err = parseRoot(is, statsHandler, maxDepth, singular);
+        stats.bytes = detail::tellOrZero(is) - offset;
+        stats.totalNanos = detail::nanosSince(start);
+        detail::lastStats() = stats;
+        return err;
+#else
+        return parseRoot(is, handler, maxDepth, singular);
+#endif
+    }
+
+    // singular为false时只解析一个值，不检查之后的内容
+    template <typename ReadStream, typename Handler>
+    static ParseError parseRoot(ReadStream& is, Handler& handler, size_t maxDepth, bool singular = true) {
         try {
             parseWhiteSpace(is);
-            parseValue(is, handler);
+            parseValue(is, handler, maxDepth);
+            if (!singular) return ParseError::PARSE_OK;
             parseWhiteSpace(is);
             if (is.hasNext()) throw Exception(ParseError::PARSE_ROOT_NOT_SINGULAR);
             return ParseError::PARSE_OK;
@@ -39,9 +278,7 @@ public:
 private:
 #define CALL(expr) if (!(expr)) throw Exception(ParseError::PARSE_USER_STOPPED)
 
-    template <typename ReadStream, 
-            typename = std::enable_if_t<std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value>>
+    template <typename ReadStream>
     static unsigned parseHex4(ReadStream& is) {
         unsigned u = 0;
         for (int i = 0; i < 4; ++i) {
@@ -56,20 +293,16 @@ private:
         return u;
     }
 
-    template <typename ReadStream, 
-            typename = std::enable_if_t<std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value>>
+    template <typename ReadStream>
     static void parseWhiteSpace(ReadStream& is) {
-        while (is.hasNext()) {
-            char ch = is.peek();
+        while (true) {
+            char ch = is.peek(); // '\0' at end
             if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') is.next();
             else break;
         }
     }
 
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
+    template <typename ReadStream, typename Handler>
     static void parseLiteral(ReadStream& is, Handler& handler, const char* literal, ValueType type) {
         char ch = *literal;
 
@@ -96,9 +329,45 @@ private:
         throw Exception(ParseError::PARSE_BAD_VALUE);
     }
 
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
+    // 非连续流中数字的字符先拷贝到这里，绝大多数数字不超过局部缓冲区
+    class NumberText {
+    public:
+        void push(char ch) {
+            if (n_ < sizeof(buf_)) buf_[n_++] = ch;
+            else {
+                if (overflow_.empty()) overflow_.assign(buf_, n_);
+                overflow_.push_back(ch);
+            }
+        }
+        const char* begin() const { return overflow_.empty() ? buf_ : overflow_.data(); }
+        const char* end  () const { return overflow_.empty() ? buf_ + n_ : overflow_.data() + overflow_.size(); }
+
+    private:
+        char        buf_[64];
+        size_t      n_ = 0;
+        std::string overflow_;
+    };
+
+    static double toDouble(const char* first, const char* last) {
+        double d = 0;
+#if defined(__cpp_lib_to_chars)
+        auto [ptr, ec] = std::from_chars(first, last, d);
+        if (ec == std::errc::result_out_of_range)
+            throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
+        assert(ec == std::errc() && ptr == last);
+        (void)ptr;
+#else
+        // 标准库未提供浮点数from_chars(gcc < 11)，拷贝到以'\0'结尾的缓冲区后使用strtod
+        std::string text(first, last);
+        errno = 0;
+        d = std::strtod(text.c_str(), nullptr);
+        if (errno == ERANGE && (d == 0.0 || std::isinf(d)))
+            throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
+#endif
+        return d;
+    }
+
+    template <typename ReadStream, typename Handler>
     static void parseNumber(ReadStream& is, Handler& handler) {
         if (is.peek() == 'N') {
             parseLiteral(is, handler, "NaN", ValueType::TYPE_DOUBLE);
@@ -109,17 +378,31 @@ private:
             return;
         }
 
-        auto start = is.getConstIter();
+        constexpr bool contiguous = IsContiguousReadStream<ReadStream>::value;
+        NumberText text;
+        const char* first = nullptr;
+        auto start = [&is]() {
+            if constexpr (contiguous) return is.getConstIter();
+            else return 0;
+        }();
+        if constexpr (contiguous) first = &*start; // 调用方保证至少还有一个字符
+        else (void)start;
+
+        auto consume = [&is, &text]() {
+            char ch = is.next();
+            if constexpr (!contiguous) text.push(ch);
+            else (void)ch;
+        };
 
-        if (is.peek() == '-') is.next();
+        if (is.peek() == '-') consume();
 
         if (is.peek() == '0') {
-            is.next();
+            consume();
             if (isDigit(is.peek())) throw Exception(ParseError::PARSE_BAD_VALUE);
         }
         else if (isDigit19(is.peek())) {
-            is.next();
-            while (isDigit(is.peek())) is.next();
+            consume();
+            while (isDigit(is.peek())) consume();
         }
         else throw Exception(ParseError::PARSE_BAD_VALUE);
 
@@ -127,18 +410,28 @@ private:
 
         if (is.peek() == '.') {
             expectType = ValueType::TYPE_DOUBLE;
-            is.next();
+            consume();
             if (!isDigit(is.peek())) throw Exception(ParseError::PARSE_BAD_VALUE);
-            while (isDigit(is.peek())) is.next();
+            while (isDigit(is.peek())) consume();
         }
 
         if (is.peek() == 'e' || is.peek() == 'E') {
             expectType = ValueType::TYPE_DOUBLE;
-            is.next();
-            if (is.peek() == '+' || is.peek() == '-') is.next();
+            consume();
+            if (is.peek() == '+' || is.peek() == '-') consume();
             if (!isDigit(is.peek())) throw Exception(ParseError::PARSE_BAD_VALUE);
-            is.next();
-            while (isDigit(is.peek())) is.next();
+            consume();
+            while (isDigit(is.peek())) consume();
+        }
+
+        const char* last;
+        if constexpr (contiguous) {
+            (void)text;
+            last = first + (is.getConstIter() - start);
+        }
+        else {
+            first = text.begin();
+            last = text.end();
         }
 
         //int32 or int64
@@ -162,70 +455,82 @@ private:
             }
         }
 
-        auto end = is.getConstIter();
-        if (start == end) throw Exception(ParseError::PARSE_BAD_VALUE);
-
-        try {
-            //
-            // std::stod() && std::stoi() are bad ideas,
-            // because new string buffer is needed
-            //
-            // std::stoi(const string& __str, size_t* __idx = 0, int __base = 10) { 
-            //     return __gnu_cxx::__stoa<long, int>(&std::strtol, "stoi", __str.c_str(),
-			// 		__idx, __base); 
-            // }
-            std::size_t idx;
-            if (expectType == ValueType::TYPE_DOUBLE) {
-                double d = __gnu_cxx::__stoa(&std::strtod, "stod", &*start, &idx);
-                assert(start + idx == end);
-                CALL(handler.Double(d));
+        // Handler接受数字原文时不做转换，超出范围的整数与浮点数也原样保留；带i32/i64后缀的数字照常转换
+        if constexpr (detail::HasRawNumber<Handler>::value) {
+            if (expectType != ValueType::TYPE_INT32 && expectType != ValueType::TYPE_INT64) {
+                CALL(handler.RawNumber(std::string_view(first, static_cast<size_t>(last - first))));
+                return;
             }
+        }
 
-            else {
-                int64_t i64 = __gnu_cxx::__stoa(&std::strtol, "stol", &*start, &idx, 10);
-                if (expectType == ValueType::TYPE_INT64)
-                {
-                    CALL(handler.Int64(i64));
-                }
-                else if (expectType == ValueType::TYPE_INT32)
-                {
-                    if (i64 > std::numeric_limits<int32_t>::max() ||
-                        i64 < std::numeric_limits<int32_t>::min()) {
-                        throw std::out_of_range("int32_t overflow");
+        //
+        // std::from_chars works on [first, last) directly: no '\0' terminator,
+        // no locale and no new string buffer are needed, and subnormal numbers
+        // are no longer reported as out of range like std::stod() does.
+        //
+        if (expectType == ValueType::TYPE_DOUBLE) {
+            CALL(handler.Double(toDouble(first, last)));
+        }
+        else {
+            int64_t i64 = 0;
+            auto [ptr, ec] = std::from_chars(first, last, i64);
+            if (ec == std::errc::result_out_of_range) {
+                // Handler接受uint64时，不带后缀的非负整数再按uint64转换
+                if constexpr (detail::HasUint64<Handler>::value) {
+                    uint64_t u64 = 0;
+                    if (expectType == ValueType::TYPE_NULL && std::from_chars(first, last, u64).ec == std::errc()) {
+                        CALL(handler.Uint64(u64));
+                        return;
                     }
-                    CALL(handler.Int32(static_cast<int32_t>(i64)));
                 }
-                else if (i64 <= std::numeric_limits<int32_t>::max() &&
-                         i64 >= std::numeric_limits<int32_t>::min()) {
-                    CALL(handler.Int32(static_cast<int32_t>(i64)));
-                }
-                else
-                {
-                    CALL(handler.Int64(i64));
+                throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
+            }
+            assert(ec == std::errc() && ptr == last);
+            (void)ptr;
+            if (expectType == ValueType::TYPE_INT64)
+            {
+                CALL(handler.Int64(i64));
+            }
+            else if (expectType == ValueType::TYPE_INT32)
+            {
+                if (i64 > std::numeric_limits<int32_t>::max() ||
+                    i64 < std::numeric_limits<int32_t>::min()) {
+                    throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
                 }
+                CALL(handler.Int32(static_cast<int32_t>(i64)));
+            }
+            else if (i64 <= std::numeric_limits<int32_t>::max() &&
+                     i64 >= std::numeric_limits<int32_t>::min()) {
+                CALL(handler.Int32(static_cast<int32_t>(i64)));
+            }
+            else
+            {
+                CALL(handler.Int64(i64));
             }
-        }
-        catch (std::out_of_range &e) {
-            throw Exception(ParseError::PARSE_NUMBER_TOO_BIG);
         }
     }
 
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
-    static void parseString(ReadStream& is, Handler& handler, bool isKey) {
+    template <typename ReadStream, typename Handler>
+    static void parseString(ReadStream& is, Handler& handler, bool isKey, std::string& buffer) {
         is.assertNext('"');
-        std::string buffer;
-        while (is.hasNext()) {
+        buffer.clear();
+        [[maybe_unused]] size_t capacity = buffer.capacity();
+        while (true) {
             char ch = is.next();
             switch (ch) {
                 case '"':
+                    // 解码中可能扩容多次，只按前后的容量变化计一次
+                    MUDONG_JSON_STATS(if (buffer.capacity() != capacity) detail::recordAllocation(buffer.capacity()));
                     if (isKey) {CALL(handler.Key(std::move(buffer)));}
                     else {CALL(handler.String(std::move(buffer)));}
                     return;
+                case '\0':
+                    if (!is.hasNext()) throw Exception(ParseError::PARSE_MISS_QUOTATION_MARK);
+                    throw Exception(ParseError::PARSE_BAD_STRING_CHAR);
                 case '\x01'...'\x1f':
                     throw Exception(ParseError::PARSE_BAD_STRING_CHAR);
                 case '\\':
+                    MUDONG_JSON_STATS(detail::activeStats().escapes++);
                     switch (is.next()) {
                         case '"':  buffer.push_back('"');  break;
                         case '\\': buffer.push_back('\\'); break;
@@ -258,102 +563,96 @@ private:
                 default: buffer.push_back(ch);
             }
         }
-        throw Exception(ParseError::PARSE_MISS_QUOTATION_MARK);
     }
 
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
-    static void parseArray(ReadStream& is, Handler& handler) {
-        CALL(handler.StartArray());
-
-        is.assertNext('[');
+    // 对象中的一个key与其后的':'，结束时位于value的第一个字符
+    template <typename ReadStream, typename Handler>
+    static void parseKey(ReadStream& is, Handler& handler, std::string& buffer) {
+        if (is.peek() != '"')
+            throw Exception(ParseError::PARSE_MISS_KEY);
+        parseString(is, handler, true, buffer);
         parseWhiteSpace(is);
+        if (is.next() != ':')
+            throw Exception(ParseError::PARSE_MISS_COLON);
+        parseWhiteSpace(is);
+    }
 
-        if (is.peek() == ']') {
-            is.next();
-            CALL(handler.EndArray());
-            return;
-        }
-
+    // 以显式栈代替递归，嵌套深度只受maxDepth限制，不消耗调用栈。
+    // 当前所在容器的类型与深度保存在局部变量中，levels只保存外层容器的类型。
+    template <typename ReadStream, typename Handler>
+    static void parseValue(ReadStream& is, Handler& handler, size_t maxDepth = kDefaultMaxDepth) {
+        detail::LevelStack levels;
+        detail::ScratchString scratch;
+        std::string& buffer = scratch.buffer;
+        size_t depth = 0;
+        bool inObject = false;
         while (true) {
-            parseValue(is, handler);
-            parseWhiteSpace(is);
-            switch (is.next()) {
-                case ',':
+            // 解析一个值；容器只消耗开头部分，随后回到循环开头解析其第一个元素
+            switch (is.peek()) {
+                case '\0':
+                    if (!is.hasNext()) throw Exception(ParseError::PARSE_EXPECT_VALUE);
+                    throw Exception(ParseError::PARSE_BAD_VALUE);
+                case 'n': parseLiteral(is, handler, "null", ValueType::TYPE_NULL); break;
+                case 't': parseLiteral(is, handler, "true", ValueType::TYPE_BOOL); break;
+                case 'f': parseLiteral(is, handler, "false", ValueType::TYPE_BOOL); break;
+                case '"': parseString(is, handler, false, buffer); break;
+                case '[':
+                    if (depth >= maxDepth) throw Exception(ParseError::PARSE_DEPTH_EXCEEDED);
+                    CALL(handler.StartArray());
+                    is.assertNext('[');
                     parseWhiteSpace(is);
-                    break;
-                case ']':
+                    if (is.peek() != ']') {
+                        if (depth++ > 0) levels.push(inObject);
+                        inObject = false;
+                        continue;
+                    }
+                    is.next();
                     CALL(handler.EndArray());
-                    return;
-                default:
-                    throw Exception(ParseError::PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+                    break;
+                case '{':
+                    if (depth >= maxDepth) throw Exception(ParseError::PARSE_DEPTH_EXCEEDED);
+                    CALL(handler.StartObject());
+                    is.assertNext('{');
+                    parseWhiteSpace(is);
+                    if (is.peek() != '}') {
+                        if (depth++ > 0) levels.push(inObject);
+                        inObject = true;
+                        parseKey(is, handler, buffer);
+                        continue;
+                    }
+                    is.next();
+                    CALL(handler.EndObject());
+                    break;
+                default: parseNumber(is, handler); break;
             }
-        }
-    }
-
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
-    static void parseObject(ReadStream& is, Handler& handler) {
-        CALL(handler.StartObject());
-
-        is.assertNext('{');
-        parseWhiteSpace(is);
-        if (is.peek() == '}') {
-            is.next();
-            CALL(handler.EndObject());
-            return;
-        }
-
-        while (true) {
-
-            if (is.peek() != '"')
-                throw Exception(ParseError::PARSE_MISS_KEY);
-
-            parseString(is, handler, true);
 
-            // parse ':'
-            parseWhiteSpace(is);
-            if (is.next() != ':')
-                throw Exception(ParseError::PARSE_MISS_COLON);
-            parseWhiteSpace(is);
-
-            // go on
-            parseValue(is, handler);
-            parseWhiteSpace(is);
-            switch (is.next()) {
-                case ',':
+            // 一个值已完整，处理其后的','或逐层关闭容器
+            while (depth > 0) {
+                parseWhiteSpace(is);
+                char ch = is.next();
+                if (ch == ',') {
                     parseWhiteSpace(is);
+                    if (inObject) parseKey(is, handler, buffer);
                     break;
-                case '}':
+                }
+                if (inObject) {
+                    if (ch != '}') throw Exception(ParseError::PARSE_MISS_COMMA_OR_CURLY_BRACKET);
                     CALL(handler.EndObject());
-                    return;
-                default:
-                    throw Exception(ParseError::PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+                }
+                else {
+                    if (ch != ']') throw Exception(ParseError::PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+                    CALL(handler.EndArray());
+                }
+                if (--depth > 0) {
+                    inObject = levels.top();
+                    levels.pop();
+                }
             }
+            if (depth == 0) return;
         }
     }
 #undef CALL
 
-    template <typename ReadStream, typename Handler,
-            typename = std::enable_if_t<(std::is_same<ReadStream, FileReadStream>::value ||
-                                        std::is_same<ReadStream, StringReadStream>::value)>>
-    static void parseValue(ReadStream& is, Handler& handler) {
-        if (!is.hasNext())
-            throw Exception(ParseError::PARSE_EXPECT_VALUE);
-
-        switch (is.peek()) {
-            case 'n': return parseLiteral(is, handler, "null", ValueType::TYPE_NULL);
-            case 't': return parseLiteral(is, handler, "true", ValueType::TYPE_BOOL);
-            case 'f': return parseLiteral(is, handler, "false", ValueType::TYPE_BOOL);
-            case '"': return parseString(is, handler, false);
-            case '[': return parseArray(is, handler);
-            case '{': return parseObject(is, handler);
-            default:  return parseNumber(is, handler);
-        }
-    }
-
 private:
     static bool isDigit(char ch)
     { return ch >= '0' && ch <= '9'; }
@@ -362,6 +661,23 @@ private:
     static inline void encodeUtf8(std::string& buffer, unsigned u);
 };
 
+namespace detail {
+
+// Value::writeTo()遇到原始片段而Handler不接受RawValue()时，解析片段并回调其中的值。
+// 片段在插入时已保证合法，不计入解析统计
+template <typename Handler>
+bool writeRawValue(std::string_view json, Handler& handler) {
+    StringReadStream is(json);
+    return Reader::parseRoot(is, handler, std::numeric_limits<size_t>::max()) == ParseError::PARSE_OK;
+}
+
+} // namespace detail
+
+inline Value Value::raw(std::string_view json, ParseError& err, size_t maxDepth) {
+    err = Reader::validate(json, maxDepth);
+    return err == ParseError::PARSE_OK ? raw(json) : Value();
+}
+
 } // namespace json
 
 } // namespace mudong
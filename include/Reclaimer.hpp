@@ -0,0 +1,144 @@
+//
+// Created by mudong on 24-03-16.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Value.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 后台释放Value。释放大的DOM需要逐个free其中的节点，在请求线程上可能耗时数毫秒；
+// 将其交给Reclaimer后，请求线程只需移动根节点，节点在后台线程中释放。
+//
+// 队列同时以个数与字节数为上限，满时retire()阻塞等待后台线程(背压)，tryRetire()则直接返回false，
+// 由调用方自行释放。字节数为调用方给出的估计值，只用于限流与监控。
+// 引用计数是原子的，移交的Value与其他线程共享子树时同样安全。
+class Reclaimer: noncopyable {
+public:
+    explicit Reclaimer(size_t maxPendingBytes = 64 << 20, size_t maxPending = 1024):
+            maxPendingBytes_(maxPendingBytes),
+            maxPending_(maxPending),
+            thread_([this]() { reclaimLoop(); })
+    {
+        assert(maxPending_ > 0);
+    }
+
+    // 等待队列中已有的Value全部释放后退出
+    ~Reclaimer() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        notEmpty_.notify_one();
+        thread_.join();
+    }
+
+    // 接管value，value变为null。bytes由调用方给出，通常取输入JSON的长度；
+    // 不在调用线程上遍历DOM求值，否则就失去了移交释放的意义
+    void retire(Value&& value, size_t bytes) {
+        std::unique_lock lock(mutex_);
+        if (!hasRoom(bytes)) {
+            stalls_++;
+            notFull_.wait(lock, [this, bytes]() { return hasRoom(bytes); });
+        }
+        push(std::move(value), bytes);
+    }
+
+    // 队列已满时不阻塞，返回false且value保持不变
+    bool tryRetire(Value&& value, size_t bytes) {
+        std::lock_guard lock(mutex_);
+        if (!hasRoom(bytes)) return false;
+        push(std::move(value), bytes);
+        return true;
+    }
+
+    // 阻塞直到此前移交的Value全部释放
+    void drain() {
+        std::unique_lock lock(mutex_);
+        drained_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+    size_t   pending     () const { std::lock_guard lock(mutex_); return pending_; }
+    size_t   pendingBytes() const { std::lock_guard lock(mutex_); return pendingBytes_; }
+    uint64_t reclaimed     () const { std::lock_guard lock(mutex_); return reclaimed_; }
+    uint64_t reclaimedBytes() const { std::lock_guard lock(mutex_); return reclaimedBytes_; }
+    uint64_t stalls        () const { std::lock_guard lock(mutex_); return stalls_; } // retire()因背压等待的次数
+
+private:
+    struct Entry {
+        Value  value;
+        size_t bytes;
+    };
+
+    // 队列为空时总能放入一个，即使其超过字节数上限
+    bool hasRoom(size_t bytes) const {
+        return pending_ == 0 || (pending_ < maxPending_ && pendingBytes_ + bytes <= maxPendingBytes_);
+    }
+
+    void push(Value&& value, size_t bytes) {
+        queue_.push_back({std::move(value), bytes});
+        pending_++;
+        pendingBytes_ += bytes;
+        notEmpty_.notify_one();
+    }
+
+    // 每次取走整个队列，在锁外释放；两个vector交替使用，稳定后不再分配
+    void reclaimLoop() {
+        std::vector<Entry> batch;
+        while (true) {
+            {
+                std::unique_lock lock(mutex_);
+                notEmpty_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return; // stop_ && 已全部释放
+                batch.swap(queue_);
+            }
+            size_t bytes = 0;
+            for (auto& entry: batch) bytes += entry.bytes;
+            size_t count = batch.size();
+            batch.clear();
+            {
+                std::lock_guard lock(mutex_);
+                pending_ -= count;
+                pendingBytes_ -= bytes;
+                reclaimed_ += count;
+                reclaimedBytes_ += bytes;
+                if (pending_ == 0) drained_.notify_all();
+            }
+            notFull_.notify_all();
+        }
+    }
+
+private:
+    const size_t            maxPendingBytes_;
+    const size_t            maxPending_;
+
+    mutable std::mutex      mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::condition_variable drained_;
+    std::vector<Entry>      queue_;
+    size_t                  pending_ = 0;      // 已移交但尚未释放完的个数，含后台线程正在释放的
+    size_t                  pendingBytes_ = 0;
+    uint64_t                reclaimed_ = 0;
+    uint64_t                reclaimedBytes_ = 0;
+    uint64_t                stalls_ = 0;
+    bool                    stop_ = false;
+
+    std::thread             thread_; // 最后初始化，线程启动时其他成员均已构造
+};
+
+} // namespace json
+
+} // namespace mudong
@@ -0,0 +1,499 @@
+//
+// Created by mudong on 24-03-16.
+//
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <tuple>
+#include <limits>
+#include <utility>
+#include <string>
+#include <vector>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include "Exception.hpp"
+#include "Reader.hpp"
+#include "StringReadStream.hpp"
+#include "StringWriteStream.hpp"
+#include "Writer.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 结构体与JSON对象之间的编译期映射。在全局命名空间中声明：
+//
+//     struct Point { int x; std::optional<double> y; std::vector<std::string> tags; };
+//     MUDONG_JSON_REFLECT(Point, x, y, tags)
+//
+// 之后StructHandler<Point>可由Reader驱动，直接将JSON填入Point，writeStruct()可将Point直接写入Writer，
+// 两个方向均不构建DOM。
+// 支持的成员类型：bool、整数、浮点数、std::string、std::vector<T>、std::optional<T>以及已声明映射的结构体。
+template <typename T>
+struct Reflect { };
+
+template <typename Class, typename T>
+struct Field {
+    std::string_view name;
+    std::string_view fragment; // 编译期拼好的 ,"name": 序列化时整体写出
+    T Class::*       member;
+};
+
+template <typename Class, typename T, size_t N, size_t M>
+constexpr Field<Class, T> makeField(const char (&name)[N], const char (&fragment)[M], T Class::* member) {
+    return Field<Class, T>{std::string_view(name, N - 1), std::string_view(fragment, M - 1), member};
+}
+
+template <typename T, typename = void>
+struct IsReflected: std::false_type { };
+
+template <typename T>
+struct IsReflected<T, std::void_t<decltype(Reflect<T>::fields)>>: std::true_type { };
+
+namespace detail {
+
+struct Sink;
+
+// 下一个事件的写入目标：对象地址及其类型对应的Sink
+struct Target {
+    void*       obj;
+    const Sink* sink;
+};
+
+// 按类型生成的事件处理函数表，返回false表示类型不匹配
+struct Sink {
+    bool   (*null)       (void*);
+    bool   (*boolean)    (void*, bool);
+    bool   (*integer)    (void*, int64_t);
+    bool   (*uinteger)   (void*, uint64_t);                 // 超出int64范围的非负整数
+    bool   (*number)     (void*, double);
+    bool   (*string)     (void*, std::string_view);
+    Target (*startObject)(void*);                   // 返回对象帧的目标，obj为nullptr表示不匹配
+    Target (*startArray) (void*);                   // 返回数组帧的目标
+    Target (*key)        (void*, std::string_view); // 对象帧：返回字段目标，obj为nullptr表示跳过该字段
+    Target (*element)    (void*);                   // 数组帧：追加一个元素并返回其目标
+};
+
+struct Reject {
+    static bool   null       (void*)                   { return false; }
+    static bool   boolean    (void*, bool)             { return false; }
+    static bool   integer    (void*, int64_t)          { return false; }
+    static bool   uinteger   (void*, uint64_t)         { return false; }
+    static bool   number     (void*, double)           { return false; }
+    static bool   string     (void*, std::string_view) { return false; }
+    static Target startObject(void*)                   { return Target{nullptr, nullptr}; }
+    static Target startArray (void*)                   { return Target{nullptr, nullptr}; }
+    static Target key        (void*, std::string_view) { return Target{nullptr, nullptr}; }
+    static Target element    (void*)                   { return Target{nullptr, nullptr}; }
+};
+
+template <typename T, typename = void>
+struct Binding;
+
+// 字段名按长度分桶的编译期表：长度为n的字段下标为order[begin[n], begin[n + 1])
+template <size_t N, size_t MaxLength>
+struct LengthBuckets {
+    std::array<size_t, MaxLength + 2> begin{};
+    std::array<size_t, N>             order{};
+
+    constexpr explicit LengthBuckets(const std::array<std::string_view, N>& names) {
+        for (auto& name: names) begin[name.size() + 1]++;
+        for (size_t n = 1; n < begin.size(); n++) begin[n] += begin[n - 1];
+        auto next = begin;
+        for (size_t i = 0; i < N; i++) order[next[names[i].size()]++] = i;
+    }
+};
+
+template <size_t N>
+constexpr size_t maxLength(const std::array<std::string_view, N>& names) {
+    size_t length = 0;
+    for (auto& name: names) length = std::max(length, name.size());
+    return length;
+}
+
+#define MUDONG_JSON_SINK(B) \
+    Sink{&B::null, &B::boolean, &B::integer, &B::uinteger, &B::number, &B::string, \
+         &B::startObject, &B::startArray, &B::key, &B::element}
+
+template <>
+struct Binding<bool>: Reject {
+    static bool boolean(void* p, bool b) { *static_cast<bool*>(p) = b; return true; }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+template <typename T>
+struct Binding<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>: Reject {
+    static bool integer(void* p, int64_t i64) {
+        if constexpr (std::is_unsigned_v<T>) {
+            if (i64 < 0 || static_cast<uint64_t>(i64) > std::numeric_limits<T>::max()) return false;
+        }
+        else {
+            if (i64 < std::numeric_limits<T>::min() || i64 > std::numeric_limits<T>::max()) return false;
+        }
+        *static_cast<T*>(p) = static_cast<T>(i64);
+        return true;
+    }
+    static bool uinteger(void* p, uint64_t u64) {
+        if constexpr (std::is_unsigned_v<T>) {
+            if (u64 > std::numeric_limits<T>::max()) return false;
+            *static_cast<T*>(p) = static_cast<T>(u64);
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+template <typename T>
+struct Binding<T, std::enable_if_t<std::is_floating_point_v<T>>>: Reject {
+    static bool integer (void* p, int64_t i64)  { *static_cast<T*>(p) = static_cast<T>(i64); return true; }
+    static bool uinteger(void* p, uint64_t u64) { *static_cast<T*>(p) = static_cast<T>(u64); return true; }
+    static bool number  (void* p, double d)     { *static_cast<T*>(p) = static_cast<T>(d);   return true; }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+template <>
+struct Binding<std::string>: Reject {
+    static bool string(void* p, std::string_view s) { static_cast<std::string*>(p)->assign(s); return true; }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+template <typename T>
+struct Binding<std::vector<T>>: Reject {
+    static_assert(!std::is_same_v<T, bool>, "std::vector<bool> is not supported");
+
+    static Target startArray(void* p) {
+        static_cast<std::vector<T>*>(p)->clear();
+        return Target{p, &sink};
+    }
+    static Target element(void* p) {
+        auto& vec = *static_cast<std::vector<T>*>(p);
+        vec.emplace_back();
+        return Target{&vec.back(), &Binding<T>::sink};
+    }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+// null置空，其余事件先emplace再转发给T
+template <typename T>
+struct Binding<std::optional<T>>: Reject {
+    static T* emplace(void* p) { return &static_cast<std::optional<T>*>(p)->emplace(); }
+
+    static bool   null       (void* p)                     { static_cast<std::optional<T>*>(p)->reset(); return true; }
+    static bool   boolean    (void* p, bool b)             { return Binding<T>::sink.boolean(emplace(p), b); }
+    static bool   integer    (void* p, int64_t i64)        { return Binding<T>::sink.integer(emplace(p), i64); }
+    static bool   uinteger   (void* p, uint64_t u64)       { return Binding<T>::sink.uinteger(emplace(p), u64); }
+    static bool   number     (void* p, double d)           { return Binding<T>::sink.number(emplace(p), d); }
+    static bool   string     (void* p, std::string_view s) { return Binding<T>::sink.string(emplace(p), s); }
+    static Target startObject(void* p)                     { return Binding<T>::sink.startObject(emplace(p)); }
+    static Target startArray (void* p)                     { return Binding<T>::sink.startArray(emplace(p)); }
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+template <typename T>
+struct Binding<T, std::enable_if_t<IsReflected<T>::value>>: Reject {
+    static Target startObject(void* p) { return Target{p, &sink}; }
+
+    // 字段名均为编译期常量，预先按长度分桶：以key的长度直接取得桶，只与长度相同的字段名比较
+    static Target key(void* p, std::string_view k) {
+        static constexpr auto names = std::apply([](const auto&... field) {
+            return std::array<std::string_view, sizeof...(field)>{field.name...};
+        }, Reflect<T>::fields);
+        static constexpr LengthBuckets<names.size(), maxLength(names)> buckets(names);
+        static constexpr auto targets = fieldTargets(std::make_index_sequence<names.size()>());
+
+        if (k.size() > maxLength(names)) return Target{nullptr, nullptr};
+        for (size_t i = buckets.begin[k.size()]; i < buckets.begin[k.size() + 1]; i++) {
+            size_t field = buckets.order[i];
+            if (k == names[field]) return targets[field](*static_cast<T*>(p));
+        }
+        return Target{nullptr, nullptr};
+    }
+
+    template <size_t I>
+    static Target fieldTarget(T& obj) {
+        auto& field = std::get<I>(Reflect<T>::fields);
+        using M = std::remove_reference_t<decltype(obj.*field.member)>;
+        return Target{&(obj.*field.member), &Binding<M>::sink};
+    }
+
+    template <size_t... I>
+    static constexpr auto fieldTargets(std::index_sequence<I...>) {
+        return std::array<Target (*)(T&), sizeof...(I)>{&fieldTarget<I>...};
+    }
+
+    static constexpr Sink sink = MUDONG_JSON_SINK(Binding);
+};
+
+#undef MUDONG_JSON_SINK
+
+// 序列化方向：按类型直接调用Writer的底层输出，容器的括号、逗号和键均由这里写出，
+// 不经过Writer::Level栈
+template <typename T, typename = void>
+struct Emitter;
+
+template <>
+struct Emitter<bool> {
+    static constexpr ValueType type = ValueType::TYPE_BOOL;
+    template <typename W>
+    static void write(W& w, bool b) { w.putBool(b); }
+};
+
+template <typename T>
+struct Emitter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+    static constexpr ValueType type = ValueType::TYPE_INT64;
+    template <typename W>
+    static void write(W& w, T v) {
+        // 无符号64位整数可能超出int64的范围，按无符号输出
+        if constexpr (std::is_unsigned_v<T> && sizeof(T) == sizeof(uint64_t))
+            w.putUint64(static_cast<uint64_t>(v));
+        else
+            w.putInt64(static_cast<int64_t>(v));
+    }
+};
+
+template <typename T>
+struct Emitter<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static constexpr ValueType type = ValueType::TYPE_DOUBLE;
+    template <typename W>
+    static void write(W& w, T v) { w.putDouble(static_cast<double>(v)); }
+};
+
+template <>
+struct Emitter<std::string> {
+    static constexpr ValueType type = ValueType::TYPE_STRING;
+    template <typename W>
+    static void write(W& w, const std::string& s) { w.putString(s); }
+};
+
+template <typename T>
+struct Emitter<std::vector<T>> {
+    static constexpr ValueType type = ValueType::TYPE_ARRAY;
+    template <typename W>
+    static void write(W& w, const std::vector<T>& vec) {
+        w.putFragment("[");
+        for (size_t i = 0; i < vec.size(); ++i) {
+            if (i > 0) w.putFragment(",");
+            Emitter<T>::write(w, vec[i]);
+        }
+        w.putFragment("]");
+    }
+};
+
+template <typename T>
+struct Emitter<std::optional<T>> {
+    static constexpr ValueType type = Emitter<T>::type;
+    template <typename W>
+    static void write(W& w, const std::optional<T>& opt) {
+        if (opt.has_value()) Emitter<T>::write(w, *opt);
+        else w.putNull();
+    }
+};
+
+template <typename T>
+struct Emitter<T, std::enable_if_t<IsReflected<T>::value>> {
+    static constexpr ValueType type = ValueType::TYPE_OBJECT;
+    template <typename W>
+    static void write(W& w, const T& obj) {
+        w.putFragment("{");
+        bool first = true;
+        std::apply([&](const auto&... field) {
+            ((w.putFragment(first ? field.fragment.substr(1) : field.fragment), // 首个字段去掉逗号
+              first = false,
+              writeField(w, obj.*field.member)), ...);
+        }, Reflect<T>::fields);
+        w.putFragment("}");
+    }
+
+    template <typename W, typename M>
+    static void writeField(W& w, const M& member) { Emitter<M>::write(w, member); }
+};
+
+} // namespace detail
+
+// 由Reader驱动、将JSON直接填入T的Handler。未声明的字段被跳过；类型不匹配时停止解析，
+// parse()返回PARSE_USER_STOPPED。提供Uint64()，uint64_t成员可取到超出int64的值，与writeStruct()的输出对称
+template <typename T>
+class StructHandler: noncopyable {
+public:
+    explicit StructHandler(T& obj): root_{&obj, &detail::Binding<T>::sink} { }
+
+    ParseError parse(std::string_view json) {
+        StringReadStream is(json);
+        return parseStream(is);
+    }
+
+    template <typename ReadStream>
+    ParseError parseStream(ReadStream& is) {
+        stack_.clear();
+        skipDepth_ = 0;
+        skipNext_ = false;
+        return Reader::parse(is, *this);
+    }
+
+public:
+    bool Null() {
+        detail::Target t;
+        return !acquire(t) || t.sink->null(t.obj);
+    }
+    bool Bool(bool b) {
+        detail::Target t;
+        return !acquire(t) || t.sink->boolean(t.obj, b);
+    }
+    bool Int32(int32_t i32) {
+        detail::Target t;
+        return !acquire(t) || t.sink->integer(t.obj, i32);
+    }
+    bool Int64(int64_t i64) {
+        detail::Target t;
+        return !acquire(t) || t.sink->integer(t.obj, i64);
+    }
+    bool Uint64(uint64_t u64) {
+        detail::Target t;
+        return !acquire(t) || t.sink->uinteger(t.obj, u64);
+    }
+    bool Double(double d) {
+        detail::Target t;
+        return !acquire(t) || t.sink->number(t.obj, d);
+    }
+    bool String(std::string_view s) {
+        detail::Target t;
+        return !acquire(t) || t.sink->string(t.obj, s);
+    }
+    bool StartObject() {
+        detail::Target t;
+        if (!acquire(t)) { skipDepth_++; return true; }
+        detail::Target frame = t.sink->startObject(t.obj);
+        if (frame.obj == nullptr) return false;
+        stack_.push_back(Frame{frame, false});
+        return true;
+    }
+    bool Key(std::string_view s) {
+        if (skipDepth_ > 0) return true;
+        auto& top = stack_.back();
+        pending_ = top.target.sink->key(top.target.obj, s);
+        skipNext_ = pending_.obj == nullptr;
+        return true;
+    }
+    bool EndObject() {
+        if (skipDepth_ > 0) { skipDepth_--; return true; }
+        stack_.pop_back();
+        return true;
+    }
+    bool StartArray() {
+        detail::Target t;
+        if (!acquire(t)) { skipDepth_++; return true; }
+        detail::Target frame = t.sink->startArray(t.obj);
+        if (frame.obj == nullptr) return false;
+        stack_.push_back(Frame{frame, true});
+        return true;
+    }
+    bool EndArray() {
+        if (skipDepth_ > 0) { skipDepth_--; return true; }
+        stack_.pop_back();
+        return true;
+    }
+
+private:
+    // 取得下一个值的目标，返回false表示该值应被跳过
+    bool acquire(detail::Target& t) {
+        if (skipDepth_ > 0) return false;
+        if (skipNext_) { skipNext_ = false; return false; }
+        if (stack_.empty()) { t = root_; return true; }
+
+        auto& top = stack_.back();
+        t = top.inArray ? top.target.sink->element(top.target.obj) : pending_;
+        return true;
+    }
+
+    struct Frame {
+        detail::Target target;
+        bool           inArray;
+    };
+
+private:
+    detail::Target     root_;
+    detail::Target     pending_{nullptr, nullptr}; // Key选中的字段
+    std::vector<Frame> stack_;
+    int                skipDepth_ = 0; // 正在跳过的未知字段的嵌套深度
+    bool               skipNext_  = false;
+};
+
+template <typename T>
+ParseError parseStruct(std::string_view json, T& obj) {
+    StructHandler<T> handler(obj);
+    return handler.parse(json);
+}
+
+// 将obj作为一个值写入writer，可用于根值，也可位于writer已打开的数组或对象(Key之后)中。
+// writer不接受该值时(多个根值而未设置分隔符)返回false，不输出任何内容
+template <typename W, typename T>
+bool writeStruct(W& writer, const T& obj) {
+    if (!writer.beginValue(detail::Emitter<T>::type)) return false;
+    detail::Emitter<T>::write(writer, obj);
+    return true;
+}
+
+template <typename T>
+std::string serializeStruct(const T& obj) {
+    StringWriteStream os;
+    Writer writer(os);
+    writeStruct(writer, obj);
+    return os.take();
+}
+
+} // namespace json
+
+} // namespace mudong
+
+#define MUDONG_JSON_NARG(...) MUDONG_JSON_NARG_(__VA_ARGS__, 32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1)
+#define MUDONG_JSON_NARG_(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32, N, ...) N
+#define MUDONG_JSON_FOR_EACH_1(M, T, x) M(T, x)
+#define MUDONG_JSON_FOR_EACH_2(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_1(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_3(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_2(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_4(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_3(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_5(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_4(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_6(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_5(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_7(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_6(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_8(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_7(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_9(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_8(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_10(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_9(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_11(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_10(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_12(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_11(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_13(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_12(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_14(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_13(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_15(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_14(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_16(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_15(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_17(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_16(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_18(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_17(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_19(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_18(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_20(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_19(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_21(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_20(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_22(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_21(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_23(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_22(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_24(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_23(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_25(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_24(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_26(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_25(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_27(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_26(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_28(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_27(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_29(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_28(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_30(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_29(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_31(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_30(M, T, __VA_ARGS__)
+#define MUDONG_JSON_FOR_EACH_32(M, T, x, ...) M(T, x), MUDONG_JSON_FOR_EACH_31(M, T, __VA_ARGS__)
+#define MUDONG_JSON_CONCAT_(a, b) a##b
+#define MUDONG_JSON_CONCAT(a, b) MUDONG_JSON_CONCAT_(a, b)
+#define MUDONG_JSON_FIELD(T, x) ::mudong::json::makeField(#x, ",\"" #x "\":", &T::x)
+
+#define MUDONG_JSON_REFLECT(Type, ...) \
+    template <> \
+    struct mudong::json::Reflect<Type> { \
+        static constexpr auto fields = std::make_tuple( \
+            MUDONG_JSON_CONCAT(MUDONG_JSON_FOR_EACH_, MUDONG_JSON_NARG(__VA_ARGS__))(MUDONG_JSON_FIELD, Type, __VA_ARGS__)); \
+    };
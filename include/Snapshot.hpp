@@ -0,0 +1,481 @@
+//
+// Created by mudong on 24-03-09.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Value.hpp"
+#include "noncopyable.hpp"
+
+namespace mudong {
+
+namespace json {
+
+// 二进制快照：将Value树一次性写成与位置无关的只读格式，之后可直接mmap并通过SnapshotValue查询，
+// 无需解析，也不分配内存。
+//
+// 布局(本机字节序，所有偏移均相对于快照起始地址)：
+//   SnapshotHeader | 节点区 | 字符串池
+// 每个值是一个16字节的SnapshotNode；数组的元素是连续的SnapshotNode；对象的成员是连续的
+// SnapshotMember，其后紧跟按key排序的uint32_t成员下标，用于二分查找。
+// 字符串在池中去重存储并以'\0'结尾。
+// 整数与浮点数按写入方的本机字节序直接存储，SnapshotHeader::byteOrder记录了写入方的字节序，
+// 字节序不同的机器读到的标记不等于kSnapshotByteOrder，Snapshot将其视为无效而不是读出错误的值。
+struct SnapshotNode {
+    uint8_t  type;    // ValueType
+    uint8_t  b;
+    uint16_t reserved;
+    uint32_t length;  // string的长度，array/object的元素个数
+    union {
+        int32_t  i32;
+        int64_t  i64;
+        double   d;
+        uint64_t offset; // string在池中的偏移，array/object子节点块的偏移
+    };
+};
+
+struct SnapshotMember {
+    uint64_t     keyOffset; // 池中偏移
+    uint32_t     keyLength;
+    uint32_t     reserved;
+    SnapshotNode value;
+};
+
+struct SnapshotHeader {
+    char         magic[8];
+    uint32_t     version;
+    uint32_t     byteOrder;  // kSnapshotByteOrder，以写入方的字节序存储
+    uint64_t     size;       // 快照总字节数
+    uint64_t     poolOffset; // 字符串池起始偏移
+    SnapshotNode root;
+};
+
+static_assert(sizeof(SnapshotNode) == 16, "snapshot node layout");
+static_assert(sizeof(SnapshotMember) == 32, "snapshot member layout");
+
+inline constexpr char     kSnapshotMagic[8] = {'M', 'D', 'J', 'S', 'N', 'A', 'P', '\0'};
+inline constexpr uint32_t kSnapshotVersion   = 2;
+inline constexpr uint32_t kSnapshotByteOrder = 0x01020304;
+
+class SnapshotWriter: noncopyable {
+public:
+    template <typename WriteStream>
+    static void write(const Value& root, WriteStream& os) {
+        SnapshotWriter writer;
+        os.put(writer.build(root));
+    }
+
+private:
+    SnapshotWriter() = default;
+
+    std::string build(const Value& root) {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+        header.version = kSnapshotVersion;
+        header.byteOrder = kSnapshotByteOrder;
+        nodes_.assign(sizeof(SnapshotHeader), '\0');
+
+        // 广度优先布局，子节点块总是在父节点之后分配
+        pending_.emplace_back(&root, offsetof(SnapshotHeader, root));
+        for (size_t i = 0; i < pending_.size(); ++i) {
+            auto [value, offset] = pending_[i];
+            SnapshotNode node = encode(*value);
+            std::memcpy(&nodes_[offset], &node, sizeof(node));
+        }
+
+        header.poolOffset = nodes_.size();
+        header.size = nodes_.size() + pool_.size();
+        std::memcpy(&header.root, &nodes_[offsetof(SnapshotHeader, root)], sizeof(SnapshotNode));
+        std::memcpy(&nodes_[0], &header, sizeof(header));
+        nodes_.append(pool_);
+        return std::move(nodes_);
+    }
+
+    // 紧凑数组的元素没有Value对象，直接写入元素节点
+    void encodePacked(const Value& value, SnapshotNode& node) {
+        size_t n = value.getSize();
+        node.length = length(n);
+        node.offset = allocate(n * sizeof(SnapshotNode));
+        for (size_t i = 0; i < n; ++i) {
+            SnapshotNode element{};
+            if (value.isPackedDouble()) {
+                element.type = static_cast<uint8_t>(ValueType::TYPE_DOUBLE);
+                element.d = value.getDoubles()[i];
+            }
+            else {
+                int64_t i64 = value.getInt64s()[i];
+                if (i64 >= std::numeric_limits<int32_t>::min() && i64 <= std::numeric_limits<int32_t>::max()) {
+                    element.type = static_cast<uint8_t>(ValueType::TYPE_INT32);
+                    element.i32 = static_cast<int32_t>(i64);
+                }
+                else {
+                    element.type = static_cast<uint8_t>(ValueType::TYPE_INT64);
+                    element.i64 = i64;
+                }
+            }
+            std::memcpy(&nodes_[node.offset + i * sizeof(SnapshotNode)], &element, sizeof(element));
+        }
+    }
+
+    SnapshotNode encode(const Value& value) {
+        SnapshotNode node{};
+        node.type = static_cast<uint8_t>(value.getType());
+        switch (value.getType()) {
+            case ValueType::TYPE_NULL:                                 break;
+            case ValueType::TYPE_BOOL:   node.b = value.getBool();     break;
+            case ValueType::TYPE_INT32:  node.i32 = value.getInt32();  break;
+            case ValueType::TYPE_INT64:  node.i64 = value.getInt64();  break;
+            case ValueType::TYPE_DOUBLE: node.d = value.getDouble();   break;
+            case ValueType::TYPE_STRING: {
+                auto s = value.getStringView();
+                node.length = length(s.size());
+                node.offset = intern(s);
+                break;
+            }
+            case ValueType::TYPE_RAW: { // 片段与字符串一样存放在池中
+                auto s = value.getRaw();
+                node.length = length(s.size());
+                node.offset = intern(s);
+                break;
+            }
+            case ValueType::TYPE_ARRAY: {
+                if (value.isPacked()) {
+                    encodePacked(value, node);
+                    break;
+                }
+                auto& array = value.getArray();
+                node.length = length(array.size());
+                node.offset = allocate(array.size() * sizeof(SnapshotNode));
+                for (size_t i = 0; i < array.size(); ++i)
+                    pending_.emplace_back(&array[i], node.offset + i * sizeof(SnapshotNode));
+                break;
+            }
+            case ValueType::TYPE_OBJECT: {
+                auto& object = value.getObject();
+                size_t n = object.size();
+                node.length = length(n);
+                node.offset = allocate(n * sizeof(SnapshotMember) + n * sizeof(uint32_t));
+
+                std::vector<uint32_t> index(n);
+                for (size_t i = 0; i < n; ++i) {
+                    auto key = object[i].key.getStringView();
+                    SnapshotMember member{};
+                    member.keyOffset = intern(key);
+                    member.keyLength = length(key.size());
+                    std::memcpy(&nodes_[node.offset + i * sizeof(SnapshotMember)], &member, sizeof(member));
+                    pending_.emplace_back(&object[i].value,
+                                          node.offset + i * sizeof(SnapshotMember) + offsetof(SnapshotMember, value));
+                    index[i] = static_cast<uint32_t>(i);
+                }
+                std::stable_sort(index.begin(), index.end(), [&object](uint32_t l, uint32_t r) {
+                    return object[l].key.getStringView() < object[r].key.getStringView();
+                });
+                std::memcpy(&nodes_[node.offset + n * sizeof(SnapshotMember)], index.data(), n * sizeof(uint32_t));
+                break;
+            }
+            default:
+                assert(false && "bad type when snapshot.");
+        }
+        return node;
+    }
+
+    // 8字节对齐分配节点区空间，返回偏移
+    uint64_t allocate(size_t n) {
+        size_t offset = (nodes_.size() + 7) & ~size_t(7);
+        nodes_.resize(offset + n, '\0');
+        return offset;
+    }
+
+    uint64_t intern(std::string_view s) {
+        auto iter = strings_.find(s);
+        if (iter != strings_.end()) return iter->second;
+        uint64_t offset = pool_.size();
+        pool_.append(s);
+        pool_.push_back('\0');
+        strings_.emplace(s, offset);
+        return offset;
+    }
+
+    static uint32_t length(size_t n) {
+        assert(n <= UINT32_MAX && "too large for snapshot");
+        return static_cast<uint32_t>(n);
+    }
+
+private:
+    std::string nodes_;
+    std::string pool_;
+    std::unordered_map<std::string_view, uint64_t> strings_; // 指向源Value中的字符串
+    std::vector<std::pair<const Value*, size_t>>  pending_;  // 待编码的值及其节点偏移
+};
+
+// 快照中某个值的只读视图，接口与Value的只读部分一致。仅包含两个指针，按值传递。
+class SnapshotValue {
+public:
+    struct Member;
+    class ConstMemberIterator;
+
+public:
+    SnapshotValue(const char* base, const SnapshotNode* node): base_(base), node_(node) { }
+
+    ValueType getType() const { return static_cast<ValueType>(node_->type); }
+    size_t    getSize() const { return isArray() || isObject() ? node_->length : 1; }
+
+    bool isNull  () const { return getType() == ValueType::TYPE_NULL; }
+    bool isBool  () const { return getType() == ValueType::TYPE_BOOL; }
+    bool isInt32 () const { return getType() == ValueType::TYPE_INT32; }
+    bool isInt64 () const { return getType() == ValueType::TYPE_INT64 || getType() == ValueType::TYPE_INT32; }
+    bool isDouble() const { return getType() == ValueType::TYPE_DOUBLE; }
+    bool isString() const { return getType() == ValueType::TYPE_STRING; }
+    bool isArray () const { return getType() == ValueType::TYPE_ARRAY; }
+    bool isObject() const { return getType() == ValueType::TYPE_OBJECT; }
+    bool isRaw   () const { return getType() == ValueType::TYPE_RAW; }
+
+    bool    getBool  () const { assert(isBool());   return node_->b != 0; }
+    int32_t getInt32 () const { assert(isInt32());  return node_->i32; }
+    double  getDouble() const { assert(isDouble()); return node_->d; }
+    int64_t getInt64 () const { assert(isInt64());  return isInt32() ? node_->i32 : node_->i64; }
+
+    std::string_view getStringView() const { assert(isString()); return string(node_->offset, node_->length); }
+    std::string      getString    () const { return std::string(getStringView()); }
+    const char*      getCString   () const { assert(isString()); return pool() + node_->offset; } // '\0'结尾
+    std::string_view getRaw       () const { assert(isRaw()); return string(node_->offset, node_->length); }
+
+    SnapshotValue operator[](size_t i) const {
+        assert(isArray() && i < node_->length);
+        return SnapshotValue(base_, nodes() + i);
+    }
+
+    inline SnapshotValue operator[](std::string_view key) const;
+
+    inline ConstMemberIterator beginMember() const;
+    inline ConstMemberIterator endMember  () const;
+    inline ConstMemberIterator findMember (std::string_view key) const;
+
+    template <typename Handler>
+    inline bool writeTo(Handler& handler) const;
+
+private:
+    const char* pool() const { return base_ + reinterpret_cast<const SnapshotHeader*>(base_)->poolOffset; }
+
+    std::string_view string(uint64_t offset, uint32_t length) const {
+        return std::string_view(pool() + offset, length);
+    }
+
+    const SnapshotNode*   nodes  () const { return reinterpret_cast<const SnapshotNode*>(base_ + node_->offset); }
+    const SnapshotMember* members() const { return reinterpret_cast<const SnapshotMember*>(base_ + node_->offset); }
+    const uint32_t*       index  () const { return reinterpret_cast<const uint32_t*>(members() + node_->length); }
+
+    std::string_view memberKey(uint32_t i) const {
+        return string(members()[i].keyOffset, members()[i].keyLength);
+    }
+
+private:
+    const char*         base_;
+    const SnapshotNode* node_;
+};
+
+struct SnapshotValue::Member {
+    std::string_view key;
+    SnapshotValue    value;
+};
+
+class SnapshotValue::ConstMemberIterator {
+public:
+    ConstMemberIterator(SnapshotValue object, uint32_t i): object_(object), i_(i) { }
+
+    Member operator*() const {
+        return Member{object_.memberKey(i_), SnapshotValue(object_.base_, &object_.members()[i_].value)};
+    }
+    ConstMemberIterator& operator++() { ++i_; return *this; }
+    bool operator==(const ConstMemberIterator& rhs) const { return i_ == rhs.i_; }
+    bool operator!=(const ConstMemberIterator& rhs) const { return i_ != rhs.i_; }
+
+private:
+    SnapshotValue object_;
+    uint32_t      i_;
+};
+
+inline SnapshotValue SnapshotValue::operator[](std::string_view key) const {
+    auto iter = findMember(key);
+    assert(iter != endMember());
+    return (*iter).value;
+}
+
+inline SnapshotValue::ConstMemberIterator SnapshotValue::beginMember() const {
+    assert(isObject());
+    return ConstMemberIterator(*this, 0);
+}
+
+inline SnapshotValue::ConstMemberIterator SnapshotValue::endMember() const {
+    assert(isObject());
+    return ConstMemberIterator(*this, node_->length);
+}
+
+// 在按key排序的成员下标上二分查找
+inline SnapshotValue::ConstMemberIterator SnapshotValue::findMember(std::string_view key) const {
+    assert(isObject());
+    const uint32_t* first = index();
+    const uint32_t* last = first + node_->length;
+    auto iter = std::lower_bound(first, last, key, [this](uint32_t i, std::string_view k) {
+        return memberKey(i) < k;
+    });
+    if (iter != last && memberKey(*iter) == key) return ConstMemberIterator(*this, *iter);
+    return endMember();
+}
+
+#define CALL(expr) do { if (!(expr)) return false; } while(false)
+
+// 与Value::writeTo()相同，以显式栈代替递归，调用栈深度与快照中树的深度无关
+template <typename Handler>
+inline bool SnapshotValue::writeTo(Handler& handler) const {
+    struct Frame {
+        const SnapshotNode* container;
+        uint32_t            index;
+    };
+    detail::SmallStack<Frame, 32> stack;
+
+    SnapshotValue value = *this;
+    while (true) {
+        switch (value.getType()) {
+            case ValueType::TYPE_NULL:
+                CALL(handler.Null());
+                break;
+            case ValueType::TYPE_BOOL:
+                CALL(handler.Bool(value.getBool()));
+                break;
+            case ValueType::TYPE_INT32:
+                CALL(handler.Int32(value.getInt32()));
+                break;
+            case ValueType::TYPE_INT64:
+                CALL(handler.Int64(value.getInt64()));
+                break;
+            case ValueType::TYPE_DOUBLE:
+                CALL(handler.Double(value.getDouble()));
+                break;
+            case ValueType::TYPE_STRING:
+                CALL(handler.String(value.getStringView()));
+                break;
+            case ValueType::TYPE_RAW:
+                if constexpr (detail::HasRawValue<Handler>::value) {
+                    CALL(handler.RawValue(value.getRaw()));
+                }
+                else {
+                    CALL(detail::writeRawValue(value.getRaw(), handler));
+                }
+                break;
+            case ValueType::TYPE_ARRAY:
+                CALL(handler.StartArray());
+                stack.push({value.node_, 0});
+                break;
+            case ValueType::TYPE_OBJECT:
+                CALL(handler.StartObject());
+                stack.push({value.node_, 0});
+                break;
+            default:
+                assert(false && "bad type when writeTo.");
+        }
+
+        // 找到下一个待输出的值，途中结束已输出完的容器
+        bool found = false;
+        while (!stack.empty()) {
+            Frame& top = stack.top();
+            SnapshotValue container(base_, top.container);
+            if (top.index < top.container->length) {
+                uint32_t i = top.index++;
+                if (container.isArray()) {
+                    value = SnapshotValue(base_, container.nodes() + i);
+                }
+                else {
+                    CALL(handler.Key(container.memberKey(i)));
+                    value = SnapshotValue(base_, &container.members()[i].value);
+                }
+                found = true;
+                break;
+            }
+            if (container.isArray()) {
+                CALL(handler.EndArray());
+            }
+            else {
+                CALL(handler.EndObject());
+            }
+            stack.pop();
+        }
+        if (!found) return true;
+    }
+}
+
+#undef CALL
+
+// 对一段快照内存的只读访问，不持有内存。仅校验头部，节点内容视为可信。
+class Snapshot {
+public:
+    Snapshot(const char* data, size_t size) :
+        data_(isValid(data, size) ? data : nullptr) { }
+
+    bool valid() const { return data_ != nullptr; }
+    SnapshotValue root() const {
+        assert(valid());
+        return SnapshotValue(data_, &reinterpret_cast<const SnapshotHeader*>(data_)->root);
+    }
+
+    static bool isValid(const char* data, size_t size) {
+        if (data == nullptr || size < sizeof(SnapshotHeader)) return false;
+        if (reinterpret_cast<uintptr_t>(data) % alignof(SnapshotHeader) != 0) return false;
+        auto header = reinterpret_cast<const SnapshotHeader*>(data);
+        return std::memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0 &&
+               header->version == kSnapshotVersion &&
+               header->byteOrder == kSnapshotByteOrder &&
+               header->size <= size &&
+               header->poolOffset <= header->size;
+    }
+
+private:
+    const char* data_;
+};
+
+// mmap只读映射快照文件，冷启动开销仅为缺页中断
+class SnapshotFile: noncopyable {
+public:
+    explicit SnapshotFile(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                data_ = static_cast<const char*>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~SnapshotFile() {
+        if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    Snapshot snapshot() const { return Snapshot(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t      size_ = 0;
+};
+
+} // namespace json
+
+} // namespace mudong
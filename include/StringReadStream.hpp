@@ -24,6 +24,7 @@ public:
     bool          hasNext     () const { return iter_ != json_.end(); }
     char          peek        () const { return hasNext() ? *iter_ : '\0'; }
     ConstIterator getConstIter() const { return iter_; }
+    size_t        tell        () const { return static_cast<size_t>(iter_ - json_.begin()); }
     char          next        ()       { return hasNext() ? *iter_++ : '\0'; }
     void          assertNext  (char c) { assert(peek() == c); next(); }
 
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #include "noncopyable.hpp"
 
@@ -15,16 +17,59 @@ namespace json {
 
 class StringWriteStream: noncopyable {
 public:
-    void put(char c)                      { buffer_.push_back(c); }
-    void put(const std::string_view& str) { buffer_.insert(buffer_.end(), str.begin(), str.end()); }
+    StringWriteStream() = default;
+    // 预先分配capacity字节，之后写入不超过capacity时不再扩容
+    explicit StringWriteStream(size_t capacity) { grow(capacity); }
 
-    std::string_view getStringView() const { return std::string_view(&*buffer_.begin(), buffer_.size()); }
-    std::string      getString    () const { return std::string(buffer_.begin(), buffer_.end()); }
+    void put(char c)                      { *reserve(1) = c; commit(1); }
+    void put(const std::string_view& str) {
+        std::memcpy(reserve(str.size()), str.data(), str.size());
+        commit(str.size());
+    }
+
+    // reserve()返回至少n字节的可写区域，写入后调用commit()提交实际写入的字节数，
+    // 两次调用之间不得再有其他写操作
+    char* reserve(size_t n) {
+        if (capacity_ - size_ < n)
+            grow(std::max(capacity_ * 2, size_ + n));
+        return data() + size_;
+    }
+    void commit(size_t n) { assert(size_ + n <= capacity_); size_ += n; }
+
+    size_t           size         () const { return size_; }
+    std::string_view getStringView() const { return std::string_view(data(), size_); }
+    std::string      getString    () const { return std::string(getStringView()); }
+
+    // 移交内部的string，无拷贝，之后stream为空，可继续写入
+    std::string take() {
+        buffer_.resize(size_); // 只缩小，不填充
+        std::string result = std::move(buffer_);
+        buffer_ = std::string();
+        capacity_ = 0;
+        size_ = 0;
+        return result;
+    }
 
 private:
-    std::vector<char> buffer_;
+    char*       data()       { return buffer_.data(); }
+    const char* data() const { return buffer_.data(); }
+
+    // 扩大string，新增部分在commit()之前由调用者写入。标准库提供resize_and_overwrite()时不初始化新增部分，
+    // 否则resize()将其清零，只在扩容时发生一次
+    void grow(size_t capacity) {
+#if defined(__cpp_lib_string_resize_and_overwrite)
+        buffer_.resize_and_overwrite(capacity, [](char*, size_t n) { return n; });
+#else
+        buffer_.resize(capacity);
+#endif
+        capacity_ = capacity;
+    }
+
+    std::string buffer_;   // [0, size_)为已提交数据，其后为reserve()预留的空间
+    size_t      capacity_ = 0;
+    size_t      size_ = 0;
 };
 
 } // namespace json
 
-} // namespace mudong
\ No newline at end of file
+} // namespace mudong
@@ -10,11 +10,19 @@
 #include <atomic>
 #include <cassert>
 #include <string>
+#include <memory>
 #include <type_traits>
 #include <algorithm>
+#include <charconv>
+#include <limits>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
+#include "Exception.hpp"
 #include "noncopyable.hpp"
+#include "ParseStats.hpp"
 
 namespace mudong {
 
@@ -28,14 +36,142 @@ enum class ValueType {
     TYPE_DOUBLE,
     TYPE_STRING,
     TYPE_ARRAY,
-    TYPE_OBJECT
+    TYPE_OBJECT,
+    TYPE_RAW     // 已序列化的JSON片段，原样输出，见Value::raw()
 };
 
+// 新增类型时须同时增大ParseStats::values，否则count()越界
+static_assert(ParseStats::kValueTypes == static_cast<size_t>(ValueType::TYPE_RAW) + 1,
+              "ParseStats::kValueTypes must match the number of ValueType enumerators");
+
 struct Member;
+class KeyHandle;
 class Document;
+class NodePool;
+class Patch;
+class ElementView;
+
+namespace detail {
+
+// 非递归遍历使用的栈，前N个元素存放在对象内部，更深时转移到堆上按倍数扩容。
+// T须为平凡类型。
+template <typename T, size_t N>
+class SmallStack: noncopyable {
+public:
+    SmallStack() = default;
+
+    bool   empty() const { return size_ == 0; }
+    size_t size () const { return size_; }
+    T&     top  ()       { assert(size_ > 0); return data_[size_ - 1]; }
+
+    void push(const T& value) {
+        if (size_ == capacity_) grow();
+        data_[size_++] = value;
+    }
+    void pop() { assert(size_ > 0); size_--; }
+
+private:
+    void grow() {
+        if (heap_.empty()) heap_.assign(inline_, inline_ + size_);
+        heap_.resize(capacity_ * 2);
+        data_ = heap_.data();
+        capacity_ = heap_.size();
+    }
+
+    T              inline_[N];
+    std::vector<T> heap_;
+    T*             data_ = inline_;
+    size_t         capacity_ = N;
+    size_t         size_ = 0;
+};
+
+// Handler可选接口：bool RawNumber(std::string_view); 若提供，Reader把数字的原文交给它而不做转换，
+// Value::writeTo()对保留原文的数字也调用它原样输出
+template <typename Handler, typename = void>
+struct HasRawNumber: std::false_type { };
+
+template <typename Handler>
+struct HasRawNumber<Handler, std::void_t<decltype(std::declval<Handler&>().RawNumber(std::string_view()))>>:
+        std::true_type { };
+
+// Handler可选接口：bool Uint64(uint64_t); 若提供，Reader把超出int64但在uint64范围内的非负整数交给它，
+// 而不报PARSE_NUMBER_TOO_BIG
+template <typename Handler, typename = void>
+struct HasUint64: std::false_type { };
+
+template <typename Handler>
+struct HasUint64<Handler, std::void_t<decltype(std::declval<Handler&>().Uint64(uint64_t()))>>:
+        std::true_type { };
+
+// Handler可选接口：bool RawValue(std::string_view); 若提供，Value::writeTo()把原始JSON片段交给它原样输出，
+// 否则重新解析片段，将其中的值逐个回调给Handler
+template <typename Handler, typename = void>
+struct HasRawValue: std::false_type { };
+
+template <typename Handler>
+struct HasRawValue<Handler, std::void_t<decltype(std::declval<Handler&>().RawValue(std::string_view()))>>:
+        std::true_type { };
+
+// 解析json并将其中的值回调给handler，定义在Reader.hpp中(本文件末尾包含)
+template <typename Handler>
+bool writeRawValue(std::string_view json, Handler& handler);
+
+// 数字原文按Reader的规则对应的类型：含小数点或指数为double，否则按取值范围为int32或int64，
+// 超出int64的整数为double
+inline ValueType rawNumberType(std::string_view text) {
+    if (text.find_first_of(".eE") != std::string_view::npos) return ValueType::TYPE_DOUBLE;
+    int64_t i64 = 0;
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), i64);
+    (void)ptr;
+    if (ec != std::errc()) return ValueType::TYPE_DOUBLE;
+    if (i64 > std::numeric_limits<int32_t>::max() || i64 < std::numeric_limits<int32_t>::min())
+        return ValueType::TYPE_INT64;
+    return ValueType::TYPE_INT32;
+}
+
+inline int64_t rawNumberToInt64(std::string_view text) {
+    int64_t i64 = 0;
+    std::from_chars(text.data(), text.data() + text.size(), i64);
+    return i64;
+}
+
+// 超出double范围时与strtod()相同，得到±HUGE_VAL或0
+inline double rawNumberToDouble(std::string_view text) {
+    double d = 0;
+#if defined(__cpp_lib_to_chars)
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), d);
+    (void)ptr;
+    if (ec == std::errc()) return d;
+#endif
+    std::string copy(text);
+    return std::strtod(copy.c_str(), nullptr);
+}
+
+} // namespace detail
+
+// 连续元素的只读视图，见Value::getInt64s()与Value::getDoubles()
+template <typename T>
+class ArrayView {
+public:
+    ArrayView(const T* data, size_t size): data_(data), size_(size) { }
+
+    const T* data () const { return data_; }
+    size_t   size () const { return size_; }
+    bool     empty() const { return size_ == 0; }
+    const T* begin() const { return data_; }
+    const T* end  () const { return data_ + size_; }
+    const T& operator[](size_t i) const { assert(i < size_); return data_[i]; }
+
+private:
+    const T* data_;
+    size_t   size_;
+};
 
 class Value {
     friend Document;
+    friend NodePool;
+    friend Patch;
+    friend ElementView;
 public:
     using MemberIterator      = std::vector<Member>::iterator;
     using ConstMemberIterator = std::vector<Member>::const_iterator;
@@ -46,45 +182,107 @@ public:
     explicit Value(int32_t i32)               : type_(ValueType::TYPE_INT32) , i32_(i32) { }
     explicit Value(int64_t i64)               : type_(ValueType::TYPE_INT64) , i64_(i64) { }
     explicit Value(double d)                  : type_(ValueType::TYPE_DOUBLE), d_(d)     { }
-    explicit Value(std::string_view s)        : type_(ValueType::TYPE_STRING), s_(new StringWithRefCount(s.begin(), s.end())) { }
-    explicit Value(const char* s)             : type_(ValueType::TYPE_STRING), s_(new StringWithRefCount(s, s + strlen(s))) { }
+    explicit Value(std::string_view s)        : type_(ValueType::TYPE_STRING), s_(newNode<StringWithRefCount>(s.begin(), s.end())) { }
+    explicit Value(const char* s)             : type_(ValueType::TYPE_STRING), s_(newNode<StringWithRefCount>(s, s + strlen(s))) { }
     Value(const char* s, size_t len)          : Value(std::string_view(s, len)) { }
+    // 保留原文的数字，text须为合法的JSON数字
+    static Value rawNumber(std::string_view text) { return Value(kRawNumber, text); }
+    // 原始JSON片段，序列化时原样输出，不再解析。json须为单个合法的JSON值，不可信的输入使用下面的重载
+    static Value raw(std::string_view json) { return Value(ValueType::TYPE_RAW, json); }
+    // 先以Reader::validate()校验再创建片段；json不合法时返回null，err为对应的错误码。定义在Reader.hpp中
+    static inline Value raw(std::string_view json, ParseError& err, size_t maxDepth = kDefaultMaxDepth);
+    // 同类数值数组的紧凑形式：元素以8字节连续存放，而非每个16字节的Value。getType()为TYPE_ARRAY，
+    // getSize()为元素个数，writeTo()、operator==与hash()的结果与同样内容的普通数组相同。
+    // 元素经由getInt64s()/getDoubles()连续访问，get()与getElements()按值给出元素而不转换存储；
+    // const的getArray()与operator[](size_t)首次调用时在节点上生成一份普通数组形式的元素并一直保留，
+    // 之后的调用直接引用它；非const的operator[](size_t)与addValue()会自动unpack()
+    static Value packed(const int64_t* data, size_t n) {
+        return Value(kPackedInt64, std::string_view(reinterpret_cast<const char*>(data), n * sizeof(int64_t)));
+    }
+    static Value packed(const double* data, size_t n) {
+        return Value(kPackedDouble, std::string_view(reinterpret_cast<const char*>(data), n * sizeof(double)));
+    }
     inline Value(const Value&);
-    inline Value(Value&&);
+    inline Value(Value&&) noexcept;
 
     inline Value& operator=(const Value&);
-    inline Value& operator=(Value&&);
+    inline Value& operator=(Value&&) noexcept;
 
     inline ~Value();
 
 public:
-    ValueType getType() const { return type_; }
+    // 保留原文的数字按其原文对应的类型报告，见detail::rawNumberType()，每次调用都扫描原文
+    // 紧凑数组报告为TYPE_ARRAY
+    ValueType getType() const {
+        if (type_ == kRawNumber) return detail::rawNumberType(getRawNumber());
+        return isPacked() ? ValueType::TYPE_ARRAY : type_;
+    }
     inline size_t    getSize() const;
 
     bool isNull  () const { return type_ == ValueType::TYPE_NULL; }
     bool isBool  () const { return type_ == ValueType::TYPE_BOOL; }
-    bool isInt32 () const { return type_ == ValueType::TYPE_INT32; }
-    bool isInt64 () const { return type_ == ValueType::TYPE_INT64 || type_ == ValueType::TYPE_INT32; }
-    bool isDouble() const { return type_ == ValueType::TYPE_DOUBLE; }
+    bool isInt32 () const { return getType() == ValueType::TYPE_INT32; }
+    bool isInt64 () const { auto type = getType(); return type == ValueType::TYPE_INT64 || type == ValueType::TYPE_INT32; }
+    bool isDouble() const { return getType() == ValueType::TYPE_DOUBLE; }
     bool isString() const { return type_ == ValueType::TYPE_STRING; }
-    bool isArray () const { return type_ == ValueType::TYPE_ARRAY; }
+    bool isArray () const { return type_ == ValueType::TYPE_ARRAY || isPacked(); }
     bool isObject() const { return type_ == ValueType::TYPE_OBJECT; }
+    bool isRaw   () const { return type_ == ValueType::TYPE_RAW; }
+
+    bool isRawNumber() const { return type_ == kRawNumber; }
+    bool isPacked   () const { return type_ == kPackedInt64 || type_ == kPackedDouble; }
+    bool isPackedInt64 () const { return type_ == kPackedInt64; }
+    bool isPackedDouble() const { return type_ == kPackedDouble; }
 
     bool        getBool  () const { assert(type_ == ValueType::TYPE_BOOL);   return b_; }
-    int32_t     getInt32 () const { assert(type_ == ValueType::TYPE_INT32);  return i32_; }
-    double      getDouble() const { assert(type_ == ValueType::TYPE_DOUBLE); return d_; }
-    const auto& getArray () const { assert(type_ == ValueType::TYPE_ARRAY);  return a_->data; }
+    // 紧凑数组返回节点上保留的普通数组形式，见packed()
+    const auto& getArray () const {
+        if (isPacked()) return unpackedElements();
+        assert(type_ == ValueType::TYPE_ARRAY);
+        return a_->data;
+    }
+    // 数组元素的只读视图，紧凑数组的元素在访问时按值构造，不生成普通数组形式，见ElementView
+    inline ElementView getElements() const;
     const auto& getObject() const { assert(type_ == ValueType::TYPE_OBJECT); return o_->data; }
     std::string getString() const { return std::string(getStringView()); }
 
+    // 保留原文的数字在此时转换，结果不缓存，每次调用都重新解析原文；需反复读取时可先以setInt64()等改存数值
+    int32_t getInt32() const {
+        assert(isInt32());
+        return type_ == kRawNumber ? static_cast<int32_t>(detail::rawNumberToInt64(getRawNumber())) : i32_;
+    }
     int64_t getInt64() const {
-        assert(type_ == ValueType::TYPE_INT64 || type_ == ValueType::TYPE_INT32);
+        assert(isInt64());
+        if (type_ == kRawNumber) return detail::rawNumberToInt64(getRawNumber());
         return type_ == ValueType::TYPE_INT64 ? i64_ : i32_;
     }
+    double getDouble() const {
+        assert(isDouble());
+        return type_ == kRawNumber ? detail::rawNumberToDouble(getRawNumber()) : d_;
+    }
+    std::string_view getRawNumber() const {
+        assert(type_ == kRawNumber);
+        return std::string_view(s_->data.data(), s_->data.size());
+    }
     std::string_view getStringView() const {
         assert(type_ == ValueType::TYPE_STRING);
         return std::string_view(&*s_->data.begin(), s_->data.size());
     }
+    std::string_view getRaw() const {
+        assert(type_ == ValueType::TYPE_RAW);
+        return std::string_view(s_->data.data(), s_->data.size());
+    }
+    // 节点的缓冲区来自operator new，满足int64_t与double的对齐
+    ArrayView<int64_t> getInt64s() const {
+        assert(type_ == kPackedInt64);
+        return {reinterpret_cast<const int64_t*>(s_->data.data()), s_->data.size() / sizeof(int64_t)};
+    }
+    ArrayView<double> getDoubles() const {
+        assert(type_ == kPackedDouble);
+        return {reinterpret_cast<const double*>(s_->data.data()), s_->data.size() / sizeof(double)};
+    }
+    // 紧凑数组转为普通数组，整数按取值范围为int32或int64；其他值不变
+    inline void unpack();
 
     Value& setNull  ()                   { this->~Value(); return *new (this) Value(ValueType::TYPE_NULL); } // placement new
     Value& setBool  (bool b)             { this->~Value(); return *new (this) Value(b); }
@@ -94,19 +292,28 @@ public:
     Value& setArray ()                   { this->~Value(); return *new (this) Value(ValueType::TYPE_ARRAY); }
     Value& setObject()                   { this->~Value(); return *new (this) Value(ValueType::TYPE_OBJECT); }
     Value& setString(std::string_view s) { this->~Value(); return *new (this) Value(s); }
+    Value& setRaw   (std::string_view json) { this->~Value(); return *new (this) Value(ValueType::TYPE_RAW, json); }
+    Value& setRawNumber(std::string_view text) { this->~Value(); return *new (this) Value(kRawNumber, text); }
 
     inline Value&       operator[](const std::string_view&);       // non-const obj invokes this.
     inline const Value& operator[](const std::string_view&) const; // const obj invokes this.
 
-    MemberIterator      beginMember ()       { assert(type_ == ValueType::TYPE_OBJECT); return o_->data.begin(); }
+    // 非const的访问可能修改容器，使其序列化缓存失效，见cacheSerialization()
+    MemberIterator      beginMember ()       { assert(type_ == ValueType::TYPE_OBJECT); touch(); return o_->data.begin(); }
     ConstMemberIterator cbeginMember() const { assert(type_ == ValueType::TYPE_OBJECT); return o_->data.cbegin(); }
-    MemberIterator      endMember   ()       { assert(type_ == ValueType::TYPE_OBJECT); return o_->data.end(); }
+    MemberIterator      endMember   ()       { assert(type_ == ValueType::TYPE_OBJECT); touch(); return o_->data.end(); }
     ConstMemberIterator cendMember  () const { assert(type_ == ValueType::TYPE_OBJECT); return o_->data.cend(); }
     ConstMemberIterator beginMember () const { return cbeginMember(); } // const obj invokes this.
     ConstMemberIterator endMember   () const { return cendMember(); }   // const obj invokes this.
     inline MemberIterator      findMember  (const std::string_view&);
     inline ConstMemberIterator findMember  (const std::string_view&) const; // const obj invokes this.
 
+    // 以预编译的key查找，见KeyHandle
+    inline Value&              operator[](const KeyHandle&);
+    inline const Value&        operator[](const KeyHandle&) const;
+    inline MemberIterator      findMember(const KeyHandle&);
+    inline ConstMemberIterator findMember(const KeyHandle&) const;
+
     template <typename V>
     Value& addMember(const char* k, V&& v) { return addMember(Value(k), Value(std::forward<V>(v))); }
 
@@ -114,25 +321,150 @@ public:
 
     template <typename T>
     Value& addValue(T&& value) {
+        if (isPacked()) unpack();
         assert(type_ == ValueType::TYPE_ARRAY);
-        a_->data.emplace_back(std::forward<T>(value));
-        return a_->data.back();
+        touch();
+        return emplaceBack(a_->data, std::forward<T>(value));
     }
 
-    Value&       operator[](size_t i)       { assert(type_ == ValueType::TYPE_ARRAY); return a_->data[i]; }
-    const Value& operator[](size_t i) const { assert(type_ == ValueType::TYPE_ARRAY); return a_->data[i]; }
+    // 为数组或对象预留n个元素的空间
+    inline void reserve(size_t n);
+
+    Value& operator[](size_t i) {
+        if (isPacked()) unpack();
+        assert(type_ == ValueType::TYPE_ARRAY);
+        touch();
+        return a_->data[i];
+    }
+    const Value& operator[](size_t i) const { return getArray()[i]; }
+    // 按值返回元素，紧凑数组不生成普通数组形式
+    Value get(size_t i) const {
+        assert(i < getSize());
+        if (isPacked()) return packedAt(i);
+        assert(type_ == ValueType::TYPE_ARRAY);
+        return a_->data[i];
+    }
 
     template <typename Handler>
     inline bool writeTo(Handler&) const;
 
+    // 序列化缓存：为子树中序列化结果不小于minBytes的数组与对象保存Writer的输出，之后writeTo()到Writer时，
+    // 未修改的容器直接拷贝缓存，只有被修改的路径重新序列化。经由非const的operator[]、findMember()、
+    // addMember()、addValue()等访问容器即视为修改，使该容器的缓存失效；从根逐层访问到被修改的值，
+    // 路径上的容器都会失效。若修改前保存了子值的引用、或子树被多个Value共享并经由其他路径修改，
+    // 上层容器无从得知，须重新调用cacheSerialization()。一次调用的输出只保存一份，各容器的缓存是其中的一段，
+    // 占用与序列化结果的大小相当而与嵌套深度无关；只要其中一段仍有效，整份输出就不会释放，
+    // 直到再次调用时子树中的缓存移到新的输出中。缓存按需分配，容器释放时一并释放
+    inline void cacheSerialization(size_t minBytes = 256);
+    // 释放子树中的全部序列化缓存，hash的缓存不受影响
+    inline void dropSerializationCache();
+    // 本容器是否有有效的序列化缓存
+    bool hasSerializationCache() const {
+        const NodeCache* cache = cacheOf();
+        return cache != nullptr && cache->buffer != nullptr;
+    }
+
+    // 深度比较。数字按数值比较，int32、int64与double之间也可相等；NaN与NaN相等；超出int64的整数原文按精确值比较；
+    // 原始片段(TYPE_RAW)只按字节比较。ignoreMemberOrder为true时对象的成员顺序不影响结果。
+    // 共享同一存储的子树直接视为相等。不使用缓存的hash：经由事先保存的子值引用修改后缓存可能已过期
+    inline bool equals(const Value& rhs, bool ignoreMemberOrder = false) const;
+    bool operator==(const Value& rhs) const { return equals(rhs); }
+    bool operator!=(const Value& rhs) const { return !equals(rhs); }
+
+    // 结构hash，与平台、运行无关，相等(含忽略成员顺序的相等)的Value的hash相同。
+    // 遍历整个子树，不读也不写hash缓存，std::hash<Value>使用它，因此与operator==始终一致
+    uint64_t hash() const { return computeHash(false, false); }
+    // 重新遍历整个子树计算hash，并缓存在每个数组与对象上，之后cachedHash()不再遍历未修改的子树。
+    // 线程安全：const成员函数可在多个线程中并发调用；cacheHash()与cacheSerialization()写入子树的各节点，
+    // 这些节点可能与其他Value共享，调用期间其他线程不得访问与之共享存储的任何Value
+    uint64_t cacheHash() { return computeHash(false, true); }
+    // 与hash()相同，但子树中有效的hash缓存直接使用：自上次cacheHash()以来未修改的子树为O(1)，
+    // 适合比较两个大文档的cachedHash()来检测变化。修改的判定与cacheSerialization()相同，
+    // 经由事先保存的子值引用修改后缓存已过期，结果不可信，须重新调用cacheHash()
+    uint64_t cachedHash() const { return computeHash(true, false); }
+    // 本容器是否有有效的hash缓存
+    bool hasHashCache() const {
+        const NodeCache* cache = cacheOf();
+        return cache != nullptr && cache->hashValid;
+    }
+
+    // Writer输出的紧凑JSON字节数的上界：数字取最大宽度，字符串按转义后的长度计算，
+    // 用于预先分配StringWriteStream的缓冲区，之后输出不再扩容
+    inline size_t estimateSerializedSize() const;
+
 private:
+    // 保留原文的数字，原文存放在字符串节点中。不属于ValueType的枚举值，getType()不会返回它，
+    // 内部的switch中由default分支处理
+    static constexpr ValueType kRawNumber = static_cast<ValueType>(16);
+    // 紧凑数组，元素存放在字符串节点中，见packed()
+    static constexpr ValueType kPackedInt64  = static_cast<ValueType>(17);
+    static constexpr ValueType kPackedDouble = static_cast<ValueType>(18);
+
+    // 内容存放在字符串节点中的类型，即union中的s_有效
+    bool hasStringNode() const {
+        return type_ == ValueType::TYPE_STRING || type_ == ValueType::TYPE_RAW || type_ == kRawNumber || isPacked();
+    }
+
+    // 紧凑数组的第i个元素，整数按取值范围为int32或int64
+    Value packedAt(size_t i) const {
+        if (type_ == kPackedDouble) return Value(getDoubles()[i]);
+        return packedInt64(getInt64s()[i]);
+    }
+    // const访问只读共享的节点，可能在多个线程中并发调用：各自生成后以CAS发布，未能发布的丢弃
+    const std::vector<Value>& unpackedElements() const {
+        std::vector<Value>* elements = s_->unpacked.load(std::memory_order_acquire);
+        if (elements != nullptr) return *elements;
+        auto* fresh = new std::vector<Value>;
+        size_t n = getSize();
+        fresh->reserve(n);
+        for (size_t i = 0; i < n; i++) fresh->push_back(packedAt(i));
+        if (s_->unpacked.compare_exchange_strong(elements, fresh, std::memory_order_acq_rel,
+                                                 std::memory_order_acquire))
+            return *fresh;
+        delete fresh;
+        return *elements;
+    }
+    static Value packedInt64(int64_t i64) {
+        if (i64 >= std::numeric_limits<int32_t>::min() && i64 <= std::numeric_limits<int32_t>::max())
+            return Value(static_cast<int32_t>(i64));
+        return Value(i64);
+    }
+
+    // 内容存放在字符串节点中的值：TYPE_RAW、kRawNumber与紧凑数组
+    Value(ValueType type, std::string_view text):
+            type_(type), s_(newNode<StringWithRefCount>(text.begin(), text.end())) { }
+
+    // 数组与对象节点上按需分配的缓存，容器被修改时失效。一次cacheSerialization()的输出只有一份，
+    // 子树中各容器的序列化结果是其中的一段，缓存占用的内存因此不随嵌套深度成倍增长
+    struct NodeCache {
+        std::shared_ptr<const std::string> buffer; // 序列化结果所在的输出，为空时无效
+        size_t      offset = 0;                    // 本容器的序列化结果在buffer中的区间
+        size_t      length = 0;
+        bool        hashValid = false;
+        uint64_t    hash = 0;                      // 见hash()
+
+        std::string_view bytes() const { return std::string_view(buffer->data() + offset, length); }
+    };
+    struct WithCache { NodeCache* cache = nullptr; };
+    // 紧凑数组经由const的getArray()访问时生成的普通数组形式，见unpackedElements()
+    struct WithUnpacked { std::atomic<std::vector<Value>*> unpacked{nullptr}; };
+
+    // 节点多出的指针不改变malloc的分配粒度
     template <typename T, typename = std::enable_if_t<std::is_same_v<T, std::vector<char>>  || 
                                                       std::is_same_v<T, std::vector<Value>> ||
                                                       std::is_same_v<T, std::vector<Member>>>>
-    struct AddRefCount {
+    struct AddRefCount: std::conditional_t<std::is_same_v<T, std::vector<char>>, WithUnpacked, WithCache> {
         template <typename... Args>
-        AddRefCount(Args&&... args) : refCount(1), data(std::forward<Args>(args)...) { }
-        ~AddRefCount() { assert(refCount == 0); }
+        AddRefCount(Args&&... args) : refCount(1), data(std::forward<Args>(args)...) {
+            MUDONG_JSON_STATS(detail::recordAllocation(sizeof(*this)));
+            MUDONG_JSON_STATS(if (data.capacity() > 0)
+                                  detail::recordAllocation(data.capacity() * sizeof(typename T::value_type)));
+        }
+        ~AddRefCount() {
+            assert(refCount == 0);
+            if constexpr (!std::is_same_v<T, std::vector<char>>) delete this->cache;
+            else delete this->unpacked.load(std::memory_order_relaxed);
+        }
 
         int incrAndGet() { assert(refCount > 0); return ++refCount; }
         int decrAndGet() { assert(refCount > 0); return --refCount; }
@@ -141,6 +473,56 @@ private:
         T data;
     };
 
+    // 数组或对象的引用计数减一
+    int decrRefCount() {
+        assert(type_ == ValueType::TYPE_ARRAY || type_ == ValueType::TYPE_OBJECT);
+        return type_ == ValueType::TYPE_ARRAY ? a_->decrAndGet() : o_->decrAndGet();
+    }
+    inline void destroyTree();
+    // 数组或对象的节点被其他Value共享时换成一份浅拷贝，子值只增加引用计数；
+    // 之后对本容器的修改不影响其他共享者，见Patch
+    inline void unshare();
+
+    const NodeCache* cacheOf() const {
+        if (type_ == ValueType::TYPE_ARRAY) return a_->cache;
+        if (type_ == ValueType::TYPE_OBJECT) return o_->cache;
+        return nullptr;
+    }
+    NodeCache*& cacheSlot() const {
+        assert(type_ == ValueType::TYPE_ARRAY || type_ == ValueType::TYPE_OBJECT);
+        return type_ == ValueType::TYPE_ARRAY ? a_->cache : o_->cache;
+    }
+    // 容器可能被修改，使其缓存失效
+    void touch() {
+        NodeCache* cache = type_ == ValueType::TYPE_ARRAY ? a_->cache : o_->cache;
+        if (cache != nullptr) {
+            cache->buffer.reset();
+            cache->hashValid = false;
+        }
+    }
+    // useCache为true时读取有效的hash缓存，store为true时写入子树中每个容器的hash缓存
+    inline uint64_t computeHash(bool useCache, bool store) const;
+    // cacheSerialization()中记录容器的序列化结果在buffer中的区间
+    inline void storeCache(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t length) const;
+    // 释放序列化缓存，保留缓存的hash
+    static inline void dropBytes(NodeCache*& cache);
+
+    // 节点的创建与释放，开启NodePool时经由本线程的缓存
+    template <typename Node, typename... Args>
+    static inline Node* newNode(Args&&... args);
+    template <typename Node>
+    static inline void deleteNode(Node* node);
+
+    // 追加一个元素，比较前后的容量，记录vector实际扩容的分配
+    template <typename Vector, typename... Args>
+    static auto& emplaceBack(Vector& v, Args&&... args) {
+        [[maybe_unused]] size_t capacity = v.capacity();
+        auto& back = v.emplace_back(std::forward<Args>(args)...);
+        MUDONG_JSON_STATS(if (v.capacity() != capacity)
+                              detail::recordAllocation(v.capacity() * sizeof(typename Vector::value_type)));
+        return back;
+    }
+
     using StringWithRefCount = AddRefCount<std::vector<char>>;
     using ArrayWithRefCount  = AddRefCount<std::vector<Value>>;
     using ObjectWithRefCount = AddRefCount<std::vector<Member>>;
@@ -167,6 +549,202 @@ struct Member {
     Value value;
 };
 
+// 数组元素的只读视图，由Value::getElements()返回，不持有数组，数组须在视图使用期间保持有效。
+// 普通数组的迭代器直接引用vector中的元素；紧凑数组的元素在解引用时构造并存放在迭代器中，
+// 引用在迭代器前进或析构后失效，因此迭代器只满足输入迭代器的要求，范围for与单遍算法可正常使用
+class ElementView {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = Value;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const Value*;
+        using reference         = const Value&;
+
+        const Value& operator*() const {
+            if (elements_ != nullptr) return elements_[index_];
+            element_ = ints_ != nullptr ? Value::packedInt64(ints_[index_]) : Value(doubles_[index_]);
+            return element_;
+        }
+        const Value* operator->() const { return &**this; }
+        Iterator& operator++() { ++index_; return *this; }
+        Iterator  operator++(int) { Iterator old = *this; ++index_; return old; }
+        bool operator==(const Iterator& rhs) const { return index_ == rhs.index_; }
+        bool operator!=(const Iterator& rhs) const { return index_ != rhs.index_; }
+
+    private:
+        friend ElementView;
+
+        Iterator(const Value& array, size_t index): index_(index) {
+            if (array.isPackedInt64()) ints_ = array.getInt64s().data();
+            else if (array.isPackedDouble()) doubles_ = array.getDoubles().data();
+            else elements_ = array.a_->data.data();
+        }
+
+        // 三者之一非空，指向数组节点中的存储
+        const Value*   elements_ = nullptr;
+        const int64_t* ints_     = nullptr;
+        const double*  doubles_  = nullptr;
+        size_t         index_;
+        mutable Value  element_;
+    };
+
+    explicit ElementView(const Value& array): array_(&array) { }
+
+    size_t size () const { return array_->getSize(); }
+    bool   empty() const { return size() == 0; }
+
+    Value operator[](size_t i) const { return array_->get(i); }
+    Value front() const { return array_->get(0); }
+    Value back () const { return array_->get(size() - 1); }
+
+    Iterator begin() const { return Iterator(*array_, 0); }
+    Iterator end  () const { return Iterator(*array_, size()); }
+
+private:
+    const Value* array_;
+};
+
+inline ElementView Value::getElements() const {
+    assert(isArray());
+    return ElementView(*this);
+}
+
+// 预编译的成员key。记住上次命中的成员下标与key节点，之后在key顺序相同的对象中查找时先检查该下标：
+// key节点相同(见Document::setSharedKeys())只需一次指针比较，否则一次字符串比较，都不再逐个扫描成员；
+// 未命中时退回线性查找并更新记录。句柄内的记录不加锁，每个线程使用各自的句柄
+class KeyHandle {
+public:
+    explicit KeyHandle(std::string_view key): key_(key) { }
+
+    std::string_view name() const { return key_; }
+
+private:
+    friend Value;
+
+    std::string    key_;
+    mutable size_t slot_ = 0;
+    mutable Value  node_; // 上次命中的key，持有引用使节点不被释放，指针比较才可靠
+};
+
+// 线程局部的节点缓存。开启后，本线程释放的字符串、数组与对象节点连同其缓冲区的容量一起保留，
+// 之后本线程创建Value时优先复用，重复解析结构相似的文档时几乎不再分配内存。
+// 默认关闭，setLimits()设置缓存的节点个数与字节数上限后开启，超出上限的节点照常释放。
+// 节点可以在任意线程释放，进入释放线程的缓存；线程退出时缓存随之释放。
+class NodePool: noncopyable {
+public:
+    static NodePool& local() {
+        thread_local NodePool pool;
+        return pool;
+    }
+
+    // maxNodes为0时关闭并清空缓存
+    void setLimits(size_t maxNodes, size_t maxBytes) {
+        maxNodes_ = maxNodes;
+        maxBytes_ = maxBytes;
+        if (maxNodes_ == 0) clear();
+        trim();
+        // 预留空闲链表的空间，释放节点时不再分配
+        strings_.reserve(maxNodes_);
+        arrays_.reserve(maxNodes_);
+        objects_.reserve(maxNodes_);
+        enabled() = maxNodes_ > 0;
+    }
+
+    // 释放缓存的全部节点，保持开启状态
+    void clear() {
+        for (auto* node: strings_) delete node;
+        for (auto* node: arrays_) delete node;
+        for (auto* node: objects_) delete node;
+        strings_.clear();
+        arrays_.clear();
+        objects_.clear();
+        bytes_ = 0;
+    }
+
+    size_t   nodes () const { return strings_.size() + arrays_.size() + objects_.size(); }
+    size_t   bytes () const { return bytes_; } // 缓存的节点及其缓冲区的字节数
+    uint64_t hits  () const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    friend Value;
+
+    NodePool() = default;
+    ~NodePool() {
+        // 线程退出时部分Value可能晚于缓存析构，此后直接释放
+        enabled() = false;
+        clear();
+    }
+
+    // 开启标志为平凡类型，缓存析构后仍可安全读取
+    static bool& enabled() {
+        thread_local bool enabled = false;
+        return enabled;
+    }
+
+    template <typename Node>
+    std::vector<Node*>& freeList() {
+        if constexpr (std::is_same_v<Node, Value::StringWithRefCount>) return strings_;
+        else if constexpr (std::is_same_v<Node, Value::ArrayWithRefCount>) return arrays_;
+        else return objects_;
+    }
+
+    template <typename Node>
+    static size_t nodeBytes(const Node* node) {
+        return sizeof(Node) + node->data.capacity() * sizeof(typename decltype(node->data)::value_type);
+    }
+
+    template <typename Node>
+    Node* acquire() {
+        auto& list = freeList<Node>();
+        if (list.empty()) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        Node* node = list.back();
+        list.pop_back();
+        bytes_ -= nodeBytes(node);
+        return node;
+    }
+
+    // 节点的引用计数已归零，内容已清空；返回false表示超出上限，由调用方释放
+    template <typename Node>
+    bool release(Node* node) {
+        size_t n = nodeBytes(node);
+        if (nodes() >= maxNodes_ || bytes_ + n > maxBytes_) return false;
+        freeList<Node>().push_back(node);
+        bytes_ += n;
+        return true;
+    }
+
+    void trim() {
+        while (nodes() > maxNodes_ || bytes_ > maxBytes_) {
+            if (!strings_.empty())     drop(strings_);
+            else if (!arrays_.empty()) drop(arrays_);
+            else                       drop(objects_);
+        }
+    }
+
+    template <typename Node>
+    void drop(std::vector<Node*>& list) {
+        bytes_ -= nodeBytes(list.back());
+        delete list.back();
+        list.pop_back();
+    }
+
+    std::vector<Value::StringWithRefCount*> strings_;
+    std::vector<Value::ArrayWithRefCount*>  arrays_;
+    std::vector<Value::ObjectWithRefCount*> objects_;
+    size_t   maxNodes_ = 0;
+    size_t   maxBytes_ = 0;
+    size_t   bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
 // definition of class Value's member func
 
 inline Value::Value(ValueType type) :
@@ -178,9 +756,10 @@ inline Value::Value(ValueType type) :
         case ValueType::TYPE_INT32:
         case ValueType::TYPE_INT64:
         case ValueType::TYPE_DOUBLE:                                break;
-        case ValueType::TYPE_STRING: s_ = new StringWithRefCount(); break;
-        case ValueType::TYPE_ARRAY:  a_ = new ArrayWithRefCount();  break;
-        case ValueType::TYPE_OBJECT: o_ = new ObjectWithRefCount(); break;
+        case ValueType::TYPE_STRING:
+        case ValueType::TYPE_RAW:    s_ = newNode<StringWithRefCount>(); break;
+        case ValueType::TYPE_ARRAY:  a_ = newNode<ArrayWithRefCount>();  break;
+        case ValueType::TYPE_OBJECT: o_ = newNode<ObjectWithRefCount>(); break;
         default: assert(false && "bad type when Value constuct.");
     }
 }
@@ -194,14 +773,18 @@ inline Value::Value(const Value& rhs) :
         case ValueType::TYPE_INT32:
         case ValueType::TYPE_INT64:
         case ValueType::TYPE_DOUBLE:                   break;
-        case ValueType::TYPE_STRING: s_->incrAndGet(); break;
+        case ValueType::TYPE_STRING:
+        case ValueType::TYPE_RAW:    s_->incrAndGet(); break;
         case ValueType::TYPE_ARRAY:  a_->incrAndGet(); break;
         case ValueType::TYPE_OBJECT: o_->incrAndGet(); break;
-        default: assert(false && "bad type when Value copy-constuct.");
+        default:
+            assert(hasStringNode() && "bad type when Value copy-constuct.");
+            s_->incrAndGet();
     }
 }
 
-inline Value::Value(Value&& rhs) :
+// noexcept使std::vector<Value>扩容时移动而非拷贝元素
+inline Value::Value(Value&& rhs) noexcept :
     type_(rhs.type_),
     s_(rhs.s_) {
     rhs.type_ = ValueType::TYPE_NULL;
@@ -220,15 +803,18 @@ inline Value& Value::operator=(const Value& rhs) {
         case ValueType::TYPE_INT32:
         case ValueType::TYPE_INT64:
         case ValueType::TYPE_DOUBLE:                   break;
-        case ValueType::TYPE_STRING: s_->incrAndGet(); break;
+        case ValueType::TYPE_STRING:
+        case ValueType::TYPE_RAW:    s_->incrAndGet(); break;
         case ValueType::TYPE_ARRAY:  a_->incrAndGet(); break;
         case ValueType::TYPE_OBJECT: o_->incrAndGet(); break;
-        default: assert(false && "bad type when Value copy.");
+        default:
+            assert(hasStringNode() && "bad type when Value copy.");
+            s_->incrAndGet();
     }
     return *this;
 }
 
-inline Value& Value::operator=(Value&& rhs) {
+inline Value& Value::operator=(Value&& rhs) noexcept {
     if (this == &rhs) return *this;
 
     this->~Value();
@@ -246,27 +832,187 @@ inline Value::~Value() {
         case ValueType::TYPE_INT32:
         case ValueType::TYPE_INT64:
         case ValueType::TYPE_DOUBLE: break;
-        case ValueType::TYPE_STRING:
-            if (s_->decrAndGet() == 0) delete s_;
-            break;
         case ValueType::TYPE_ARRAY:
-            if (a_->decrAndGet() == 0) delete a_;
-            break;
         case ValueType::TYPE_OBJECT:
-            if (o_->decrAndGet() == 0) delete o_;
+            if (decrRefCount() == 0) destroyTree();
+            break;
+        case ValueType::TYPE_STRING:
+        case ValueType::TYPE_RAW:
+        default: // kRawNumber与紧凑数组
+            assert(hasStringNode() && "bad type when Value destruct.");
+            if (s_->decrAndGet() == 0) {
+                s_->data.clear();
+                deleteNode(s_);
+            }
             break;
-        default: assert(false && "bad type when Value copy.");
+    }
+}
+
+// 释放引用计数已归零的数组或对象。直接delete会经vector析构逐层递归，深层文档可能栈溢出；
+// 这里从后向前逐个弹出子元素，独占的子容器压入显式栈稍后释放，调用栈深度与树的深度无关。
+// 前32层保存在栈对象内部，常见文档释放时不分配内存。
+inline void Value::destroyTree() {
+    struct Frame {
+        ArrayWithRefCount*  a;
+        ObjectWithRefCount* o;
+    };
+    detail::SmallStack<Frame, 32> stack;
+
+    // 放弃child持有的引用，独占的子容器入栈，字符串等随vector元素一起析构
+    auto take = [&stack](Value& child) {
+        if (child.type_ != ValueType::TYPE_ARRAY && child.type_ != ValueType::TYPE_OBJECT) return;
+        if (child.decrRefCount() == 0) {
+            stack.push(child.type_ == ValueType::TYPE_ARRAY ? Frame{child.a_, nullptr} : Frame{nullptr, child.o_});
+        }
+        child.type_ = ValueType::TYPE_NULL;
+        child.a_ = nullptr;
+    };
+
+    stack.push(type_ == ValueType::TYPE_ARRAY ? Frame{a_, nullptr} : Frame{nullptr, o_});
+    while (!stack.empty()) {
+        Frame frame = stack.top();
+        size_t depth = stack.size();
+        if (frame.a != nullptr) {
+            auto& data = frame.a->data;
+            while (!data.empty() && stack.size() == depth) {
+                take(data.back());
+                data.pop_back();
+            }
+        }
+        else {
+            auto& data = frame.o->data;
+            while (!data.empty() && stack.size() == depth) {
+                take(data.back().value);
+                data.pop_back();
+            }
+        }
+        // 没有新的子容器入栈，说明当前容器已清空
+        if (stack.size() == depth) {
+            stack.pop();
+            if (frame.a != nullptr) deleteNode(frame.a);
+            else deleteNode(frame.o);
+        }
+    }
+}
+
+inline void Value::unshare() {
+    if (type_ == ValueType::TYPE_ARRAY && a_->refCount > 1) {
+        Value shared(std::move(*this)); // 接管原节点的引用，离开作用域时释放
+        type_ = ValueType::TYPE_ARRAY;
+        a_ = newNode<ArrayWithRefCount>(shared.a_->data.begin(), shared.a_->data.end());
+    }
+    else if (type_ == ValueType::TYPE_OBJECT && o_->refCount > 1) {
+        Value shared(std::move(*this));
+        type_ = ValueType::TYPE_OBJECT;
+        o_ = newNode<ObjectWithRefCount>(shared.o_->data.begin(), shared.o_->data.end());
+    }
+}
+
+template <typename Node, typename... Args>
+inline Node* Value::newNode(Args&&... args) {
+    if (NodePool::enabled()) {
+        if (Node* node = NodePool::local().acquire<Node>()) {
+            node->refCount = 1;
+            if constexpr (sizeof...(Args) > 0) node->data.assign(std::forward<Args>(args)...);
+            return node;
+        }
+    }
+    return new Node(std::forward<Args>(args)...);
+}
+
+template <typename Node>
+inline void Value::deleteNode(Node* node) {
+    assert(node->data.empty());
+    if constexpr (!std::is_same_v<Node, StringWithRefCount>) {
+        delete node->cache;
+        node->cache = nullptr;
+    }
+    else {
+        delete node->unpacked.exchange(nullptr, std::memory_order_relaxed);
+    }
+    if (NodePool::enabled() && NodePool::local().release(node)) return;
+    delete node;
+}
+
+inline void Value::reserve(size_t n) {
+    assert(type_ == ValueType::TYPE_ARRAY || type_ == ValueType::TYPE_OBJECT);
+    if (type_ == ValueType::TYPE_ARRAY) {
+        [[maybe_unused]] size_t capacity = a_->data.capacity();
+        a_->data.reserve(n);
+        MUDONG_JSON_STATS(if (a_->data.capacity() != capacity)
+                              detail::recordAllocation(a_->data.capacity() * sizeof(Value)));
+    }
+    else {
+        [[maybe_unused]] size_t capacity = o_->data.capacity();
+        o_->data.reserve(n);
+        MUDONG_JSON_STATS(if (o_->data.capacity() != capacity)
+                              detail::recordAllocation(o_->data.capacity() * sizeof(Member)));
+    }
+}
+
+inline void Value::storeCache(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t length) const {
+    NodeCache*& cache = cacheSlot();
+    if (cache == nullptr) cache = new NodeCache;
+    cache->buffer = buffer;
+    cache->offset = offset;
+    cache->length = length;
+}
+
+inline void Value::dropBytes(NodeCache*& cache) {
+    if (cache == nullptr) return;
+    if (cache->hashValid) {
+        cache->buffer.reset();
+    }
+    else {
+        delete cache;
+        cache = nullptr;
+    }
+}
+
+inline void Value::dropSerializationCache() {
+    if (type_ != ValueType::TYPE_ARRAY && type_ != ValueType::TYPE_OBJECT) return;
+    detail::SmallStack<const Value*, 32> stack;
+    stack.push(this);
+    while (!stack.empty()) {
+        const Value* container = stack.top();
+        stack.pop();
+        dropBytes(container->cacheSlot());
+        auto visit = [&stack](const Value& child) {
+            if (child.type_ == ValueType::TYPE_ARRAY || child.type_ == ValueType::TYPE_OBJECT) stack.push(&child);
+        };
+        if (container->type_ == ValueType::TYPE_ARRAY) {
+            for (auto& child: container->a_->data) visit(child);
+        }
+        else {
+            for (auto& member: container->o_->data) visit(member.value);
+        }
     }
 }
 
 inline size_t Value::getSize() const {
     if (type_ == ValueType::TYPE_ARRAY) return a_->data.size();
     else if (type_ == ValueType::TYPE_OBJECT) return o_->data.size();
+    else if (isPacked()) return s_->data.size() / 8; // int64_t与double都是8字节
     return 1;
 }
 
+inline void Value::unpack() {
+    if (!isPacked()) return;
+    Value array(ValueType::TYPE_ARRAY);
+    size_t n = getSize();
+    array.reserve(n);
+    for (size_t i = 0; i < n; i++) array.a_->data.push_back(packedAt(i));
+    *this = std::move(array);
+}
+
 inline Value& Value::operator[](const std::string_view& key) {
     assert(type_ == ValueType::TYPE_OBJECT);
+    touch();
+    return const_cast<Value&>(static_cast<const Value&>(*this)[key]);
+}
+
+inline const Value& Value::operator[](const std::string_view& key) const {
+    assert(type_ == ValueType::TYPE_OBJECT);
 
     auto iter = findMember(key);
     if (iter != o_->data.end()) return iter->value;
@@ -276,74 +1022,566 @@ inline Value& Value::operator[](const std::string_view& key) {
     return fake;
 }
 
-inline const Value& Value::operator[](const std::string_view& key) const {
-    return const_cast<Value&>(*this)[key];
+inline Value::MemberIterator Value::findMember(const std::string_view& key) {
+    assert(type_ == ValueType::TYPE_OBJECT);
+    touch();
+    return o_->data.begin() + (static_cast<const Value&>(*this).findMember(key) - o_->data.cbegin());
 }
 
-inline Value::MemberIterator Value::findMember(const std::string_view& key) {
+inline Value& Value::operator[](const KeyHandle& key) {
     assert(type_ == ValueType::TYPE_OBJECT);
-    return std::find_if(o_->data.begin(), o_->data.end(), 
-                        [key](const Member& m) { return m.key.getStringView() == key; });
+    touch();
+    return const_cast<Value&>(static_cast<const Value&>(*this)[key]);
+}
+
+inline const Value& Value::operator[](const KeyHandle& key) const {
+    auto iter = findMember(key);
+    if (iter != o_->data.end()) return iter->value;
+
+    assert(false);
+    static Value fake(ValueType::TYPE_NULL);
+    return fake;
+}
+
+inline Value::MemberIterator Value::findMember(const KeyHandle& key) {
+    assert(type_ == ValueType::TYPE_OBJECT);
+    touch();
+    return o_->data.begin() + (static_cast<const Value&>(*this).findMember(key) - o_->data.cbegin());
+}
+
+inline Value::ConstMemberIterator Value::findMember(const KeyHandle& key) const {
+    assert(type_ == ValueType::TYPE_OBJECT);
+    auto& members = o_->data;
+    if (key.slot_ < members.size()) {
+        const Value& k = members[key.slot_].key;
+        if (k.s_ == key.node_.s_) return members.cbegin() + static_cast<ptrdiff_t>(key.slot_);
+        if (k.getStringView() == key.key_) {
+            // 只记住被共享的key节点，独占的节点不会在其他对象中再次出现，不必为其修改引用计数
+            if (k.s_->refCount > 1) key.node_ = k;
+            return members.cbegin() + static_cast<ptrdiff_t>(key.slot_);
+        }
+    }
+    auto iter = findMember(std::string_view(key.key_));
+    if (iter != members.cend()) {
+        key.slot_ = static_cast<size_t>(iter - members.cbegin());
+        if (iter->key.s_->refCount > 1) key.node_ = iter->key;
+    }
+    return iter;
 }
 
 inline Value::ConstMemberIterator Value::findMember(const std::string_view& key) const {
-    return const_cast<Value&>(*this).findMember(key);
+    assert(type_ == ValueType::TYPE_OBJECT);
+    return std::find_if(o_->data.cbegin(), o_->data.cend(),
+                        [key](const Member& m) { return m.key.getStringView() == key; });
 }
 
 inline Value& Value::addMember(Value&& key, Value&& value) {
     assert(type_ == ValueType::TYPE_OBJECT);
+    touch();
     assert(key.type_ == ValueType::TYPE_STRING);
     assert(findMember(key.getStringView()) == endMember());
-    o_->data.emplace_back(std::move(key), std::move(value));
-    return o_->data.back().value;
+    return emplaceBack(o_->data, std::move(key), std::move(value)).value;
+}
+
+namespace detail {
+
+// 字符串按Writer的规则转义后的字节数，不含引号：'"'、'\\'与\b\f\n\r\t为2字节，
+// 其余控制字符为\u00XX的6字节。写成无分支的累加，编译器可以向量化
+inline size_t escapedSize(std::string_view s) {
+    size_t n = s.size();
+    for (char c: s) {
+        unsigned u = static_cast<unsigned char>(c);
+        unsigned control = u < 0x20;
+        unsigned shortEscape = (0x3700u >> (u & 31)) & 1; // \b\t\n\f\r
+        n += control * (5 - 4 * shortEscape) + (u == '"') + (u == '\\');
+    }
+    return n;
+}
+
+// 作为writeTo()的Handler累计输出字节数的上界，与Value的深度无关
+class SizeEstimator {
+public:
+    bool Null  ()                   { return value(4); }
+    bool Bool  (bool b)             { return value(b ? 4 : 5); }
+    bool Int32 (int32_t)            { return value(11); }
+    bool Int64 (int64_t)            { return value(20); }
+    bool Double(double)             { return value(25); }
+    bool String(std::string_view s) { return value(escapedSize(s) + 2); }
+    bool RawNumber(std::string_view s) { return value(s.size()); }
+    bool RawValue (std::string_view s) { return value(s.size()); }
+    bool Key   (std::string_view s) {
+        value(escapedSize(s) + 3); // ':'
+        afterKey_ = true;
+        return true;
+    }
+    bool StartArray () { value(2); first_ = true; return true; } // "[]"
+    bool EndArray   () { first_ = false; return true; }
+    bool StartObject() { value(2); first_ = true; return true; } // "{}"
+    bool EndObject  () { first_ = false; return true; }
+
+    size_t size() const { return size_; }
+
+private:
+    // 除容器的第一个元素与key之后的值外，每个元素前有一个','
+    bool value(size_t n) {
+        if (afterKey_) afterKey_ = false;
+        else if (!first_) size_++;
+        first_ = false;
+        size_ += n;
+        return true;
+    }
+
+    size_t size_ = 0;
+    bool   first_ = true;
+    bool   afterKey_ = false;
+};
+
+} // namespace detail
+
+inline size_t Value::estimateSerializedSize() const {
+    detail::SizeEstimator estimator;
+    writeTo(estimator);
+    return estimator.size();
 }
 
 #define CALL(expr) do { if (!(expr)) return false; } while(false)
 // https://zhuanlan.zhihu.com/p/22460835
 
+// 以显式栈代替递归，每层记录所在容器与下一个待输出元素的下标，调用栈深度与树的深度无关
 template <typename Handler>
 inline bool Value::writeTo(Handler& handler) const {
-    switch (type_) {
-        case ValueType::TYPE_NULL:
-            CALL(handler.Null());
-            break;
-        case ValueType::TYPE_BOOL:
-            CALL(handler.Bool(b_));
-            break;
-        case ValueType::TYPE_INT32:
-            CALL(handler.Int32(i32_));
-            break;
-        case ValueType::TYPE_INT64:
-            CALL(handler.Int64(i64_));
-            break;
-        case ValueType::TYPE_DOUBLE:
-            CALL(handler.Double(d_));
-            break;
-        case ValueType::TYPE_STRING:
-            CALL(handler.String(getStringView()));
-            break;
-        case ValueType::TYPE_ARRAY:
-            CALL(handler.StartArray());
-            for (auto& val : getArray()) CALL(val.writeTo(handler));
-            CALL(handler.EndArray());
-            break;
-        case ValueType::TYPE_OBJECT:
-            CALL(handler.StartObject());
-            for (auto& member : getObject()) {
-                handler.Key(member.key.getStringView());
-                CALL(member.value.writeTo(handler));
+    struct Frame {
+        const Value* container;
+        size_t       index;
+    };
+    detail::SmallStack<Frame, 32> stack;
+
+    const Value* value = this;
+    while (true) {
+        switch (value->type_) {
+            case ValueType::TYPE_NULL:
+                CALL(handler.Null());
+                break;
+            case ValueType::TYPE_BOOL:
+                CALL(handler.Bool(value->b_));
+                break;
+            case ValueType::TYPE_INT32:
+                CALL(handler.Int32(value->i32_));
+                break;
+            case ValueType::TYPE_INT64:
+                CALL(handler.Int64(value->i64_));
+                break;
+            case ValueType::TYPE_DOUBLE:
+                CALL(handler.Double(value->d_));
+                break;
+            case ValueType::TYPE_STRING:
+                CALL(handler.String(value->getStringView()));
+                break;
+            case ValueType::TYPE_RAW:
+                if constexpr (detail::HasRawValue<Handler>::value) {
+                    CALL(handler.RawValue(value->getRaw()));
+                }
+                else {
+                    CALL(detail::writeRawValue(value->getRaw(), handler));
+                }
+                break;
+            default:
+                if (value->isPacked()) {
+                    // 元素类型已知，逐个输出，不经过显式栈
+                    CALL(handler.StartArray());
+                    if (value->type_ == kPackedDouble) {
+                        for (double d: value->getDoubles()) CALL(handler.Double(d));
+                    }
+                    else {
+                        for (int64_t i64: value->getInt64s()) {
+                            if (i64 >= std::numeric_limits<int32_t>::min() && i64 <= std::numeric_limits<int32_t>::max())
+                                CALL(handler.Int32(static_cast<int32_t>(i64)));
+                            else
+                                CALL(handler.Int64(i64));
+                        }
+                    }
+                    CALL(handler.EndArray());
+                    break;
+                }
+                assert(value->type_ == kRawNumber && "bad type when writeTo.");
+                if constexpr (detail::HasRawNumber<Handler>::value) {
+                    CALL(handler.RawNumber(value->getRawNumber()));
+                }
+                else if (value->isInt32()) {
+                    CALL(handler.Int32(value->getInt32()));
+                }
+                else if (value->isInt64()) {
+                    CALL(handler.Int64(value->getInt64()));
+                }
+                else {
+                    CALL(handler.Double(value->getDouble()));
+                }
+                break;
+            case ValueType::TYPE_ARRAY:
+            case ValueType::TYPE_OBJECT:
+                // 未修改的容器直接输出缓存的序列化结果
+                if constexpr (detail::HasRawValue<Handler>::value) {
+                    if (value->hasSerializationCache()) {
+                        CALL(handler.RawValue(value->cacheOf()->bytes()));
+                        break;
+                    }
+                }
+                if (value->type_ == ValueType::TYPE_ARRAY) {
+                    CALL(handler.StartArray());
+                }
+                else {
+                    CALL(handler.StartObject());
+                }
+                stack.push({value, 0});
+                break;
+        }
+
+        // 找到下一个待输出的值，途中结束已输出完的容器
+        value = nullptr;
+        while (!stack.empty()) {
+            Frame& top = stack.top();
+            if (top.container->type_ == ValueType::TYPE_ARRAY) {
+                auto& array = top.container->getArray();
+                if (top.index < array.size()) {
+                    value = &array[top.index++];
+                    break;
+                }
+                CALL(handler.EndArray());
             }
-            CALL(handler.EndObject());
-            break;
-        default:
-            assert(false && "bad type when writeTo.");
+            else {
+                auto& object = top.container->getObject();
+                if (top.index < object.size()) {
+                    auto& member = object[top.index++];
+                    CALL(handler.Key(member.key.getStringView()));
+                    value = &member.value;
+                    break;
+                }
+                CALL(handler.EndObject());
+            }
+            stack.pop();
+        }
+        if (value == nullptr) return true;
     }
-    return true;
 }
 
 #undef CALL
 
+namespace detail {
+
+// 64位混合函数(splitmix64的终结步骤)
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// 按小端组合至多8个字节，与主机字节序无关；编译器在小端平台上将其合并为一次读取
+inline uint64_t loadLittleEndian(const char* p, size_t n) {
+    uint64_t word = 0;
+    for (size_t k = 0; k < n; k++)
+        word |= static_cast<uint64_t>(static_cast<uint8_t>(p[k])) << (8 * k);
+    return word;
+}
+
+// 每次混入8字节，按小端读取
+inline uint64_t hashBytes(std::string_view s, uint64_t seed) {
+    uint64_t h = seed ^ (s.size() * 0x9e3779b97f4a7c15ULL);
+    size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8)
+        h = mix64(h ^ loadLittleEndian(s.data() + i, 8));
+    return mix64(h ^ loadLittleEndian(s.data() + i, s.size() - i));
+}
+
+// 各类型的种子，使不同类型的值不易碰撞
+inline constexpr uint64_t kHashNull   = 0x6e756c6cULL;
+inline constexpr uint64_t kHashBool   = 0x626f6f6cULL;
+inline constexpr uint64_t kHashNumber = 0x6e756d62ULL;
+inline constexpr uint64_t kHashString = 0x73747269ULL;
+inline constexpr uint64_t kHashRaw    = 0x72617776ULL;
+inline constexpr uint64_t kHashArray  = 0x61727261ULL;
+inline constexpr uint64_t kHashObject = 0x6f626a65ULL;
+inline constexpr uint64_t kHashKey    = 0x6b657973ULL;
+
+// 可精确表示为int64的double按整数比较与hash，与相同数值的整数一致
+inline bool doubleToInt64(double d, int64_t& i) {
+    if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0)) return false;
+    i = static_cast<int64_t>(d);
+    return static_cast<double>(i) == d;
+}
+
+inline uint64_t hashInt64(int64_t i) { return mix64(kHashNumber ^ static_cast<uint64_t>(i)); }
+
+inline uint64_t hashDouble(double d) {
+    int64_t i;
+    if (doubleToInt64(d, i)) return hashInt64(i);
+    if (d != d) d = std::numeric_limits<double>::quiet_NaN(); // 所有NaN的hash相同
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return mix64(kHashNumber ^ mix64(bits));
+}
+
+// 超出int64范围的整数原文：不含小数点与指数，rawNumberType()将其报告为TYPE_DOUBLE，
+// 但比较与hash按精确的整数值进行，不经过有损的double转换
+inline bool isBigInteger(std::string_view text) {
+    if (text.find_first_of(".eE") != std::string_view::npos) return false;
+    int64_t i64 = 0;
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), i64);
+    (void)ptr;
+    return ec != std::errc();
+}
+
+// 整数原文的规范形式：符号与去掉前导零的数字
+inline std::string_view integerDigits(std::string_view text, bool& negative) {
+    negative = !text.empty() && text.front() == '-';
+    if (negative) text.remove_prefix(1);
+    while (text.size() > 1 && text.front() == '0') text.remove_prefix(1);
+    return text;
+}
+
+inline bool bigIntegerEquals(std::string_view a, std::string_view b) {
+    bool aNegative, bNegative;
+    std::string_view x = integerDigits(a, aNegative);
+    std::string_view y = integerDigits(b, bNegative);
+    return aNegative == bNegative && x == y;
+}
+
+// 整数原文与d的数值是否精确相等：d须恰好是该整数，而不只是舍入到同一个double
+inline bool bigIntegerEquals(std::string_view text, double d) {
+    if (rawNumberToDouble(text) != d || d - d != 0) return false; // 排除inf与NaN
+    char buf[320]; // 最大的double有309位整数
+    int n = std::snprintf(buf, sizeof(buf), "%.0f", d);
+    return n > 0 && bigIntegerEquals(text, std::string_view(buf, static_cast<size_t>(n)));
+}
+
+// 恰好可表示为double的整数与该double的hash相同，其余按规范形式hash
+inline uint64_t hashBigInteger(std::string_view text) {
+    double d = rawNumberToDouble(text);
+    if (bigIntegerEquals(text, d)) return hashDouble(d);
+    bool negative;
+    std::string_view digits = integerDigits(text, negative);
+    return hashBytes(digits, negative ? ~kHashNumber : kHashNumber);
+}
+
+} // namespace detail
+
+// 后序遍历，容器的hash由其元素的hash合成：数组按顺序混合，对象将各成员的hash相加，与成员顺序无关
+inline uint64_t Value::computeHash(bool useCache, bool store) const {
+    struct Frame {
+        const Value* container;
+        size_t       index;
+        uint64_t     acc;
+    };
+    detail::SmallStack<Frame, 32> stack;
+
+    auto scalarHash = [](const Value& v) -> uint64_t {
+        if (v.isPacked()) {
+            // 与同样内容的普通数组相同：按顺序混合元素的hash
+            uint64_t acc = detail::kHashArray;
+            size_t size = v.getSize();
+            if (v.type_ == kPackedDouble)
+                for (double d: v.getDoubles()) acc = detail::mix64(acc ^ detail::hashDouble(d));
+            else
+                for (int64_t i64: v.getInt64s()) acc = detail::mix64(acc ^ detail::hashInt64(i64));
+            return detail::mix64(acc ^ detail::kHashArray ^ (size * 0x9e3779b97f4a7c15ULL));
+        }
+        switch (v.getType()) {
+            case ValueType::TYPE_NULL:   return detail::mix64(detail::kHashNull);
+            case ValueType::TYPE_BOOL:   return detail::mix64(detail::kHashBool + v.b_);
+            case ValueType::TYPE_INT32:
+            case ValueType::TYPE_INT64:  return detail::hashInt64(v.getInt64());
+            case ValueType::TYPE_DOUBLE:
+                if (v.isRawNumber() && detail::isBigInteger(v.getRawNumber()))
+                    return detail::hashBigInteger(v.getRawNumber());
+                return detail::hashDouble(v.getDouble());
+            case ValueType::TYPE_STRING: return detail::hashBytes(v.getStringView(), detail::kHashString);
+            case ValueType::TYPE_RAW:    return detail::hashBytes(v.getRaw(), detail::kHashRaw);
+            default: assert(false && "bad type when hash."); return 0;
+        }
+    };
+    // 把一个元素的hash并入所在的容器
+    auto feed = [](Frame& parent, uint64_t h) {
+        if (parent.container->type_ == ValueType::TYPE_ARRAY) {
+            parent.acc = detail::mix64(parent.acc ^ h);
+        }
+        else {
+            auto key = parent.container->o_->data[parent.index - 1].key.getStringView();
+            parent.acc += detail::mix64(detail::hashBytes(key, detail::kHashKey) ^ (h * 0x9e3779b97f4a7c15ULL));
+        }
+    };
+
+    const Value* value = this;
+    while (true) {
+        const NodeCache* cached = useCache ? value->cacheOf() : nullptr;
+        if ((value->type_ == ValueType::TYPE_ARRAY || value->type_ == ValueType::TYPE_OBJECT) &&
+            (cached == nullptr || !cached->hashValid)) {
+            stack.push({value, 0, value->type_ == ValueType::TYPE_ARRAY ? detail::kHashArray : 0});
+        }
+        else {
+            uint64_t h = cached != nullptr ? cached->hash : scalarHash(*value);
+            if (stack.empty()) return h;
+            feed(stack.top(), h);
+        }
+
+        // 找到下一个待计算的值，途中结束已处理完的容器
+        while (true) {
+            Frame& top = stack.top();
+            size_t size = top.container->getSize();
+            if (top.index < size) {
+                value = top.container->type_ == ValueType::TYPE_ARRAY ? &top.container->a_->data[top.index]
+                                                                       : &top.container->o_->data[top.index].value;
+                top.index++;
+                break;
+            }
+            uint64_t seed = top.container->type_ == ValueType::TYPE_ARRAY ? detail::kHashArray : detail::kHashObject;
+            uint64_t h = detail::mix64(top.acc ^ seed ^ (size * 0x9e3779b97f4a7c15ULL));
+            if (store) {
+                NodeCache*& slot = top.container->cacheSlot();
+                if (slot == nullptr) slot = new NodeCache;
+                slot->hash = h;
+                slot->hashValid = true;
+            }
+            stack.pop();
+            if (stack.empty()) return h;
+            feed(stack.top(), h);
+        }
+    }
+}
+
+inline bool Value::equals(const Value& rhs, bool ignoreMemberOrder) const {
+    // 待比较的值对，比较的先后不影响结果
+    struct Pair {
+        const Value* a;
+        const Value* b;
+    };
+    detail::SmallStack<Pair, 32> stack;
+    std::vector<const Member*> sorted; // 忽略成员顺序时，较大的对象按key排序后二分查找
+
+    auto isNumber = [](ValueType type) {
+        return type == ValueType::TYPE_INT32 || type == ValueType::TYPE_INT64 || type == ValueType::TYPE_DOUBLE;
+    };
+    auto numberEquals = [](const Value& a, const Value& b) {
+        if (a.isRawNumber() && b.isRawNumber() && a.getRawNumber() == b.getRawNumber()) return true;
+        // 超出int64的整数原文按精确值比较，只有小数与指数形式才按double比较
+        bool aBig = a.isRawNumber() && detail::isBigInteger(a.getRawNumber());
+        bool bBig = b.isRawNumber() && detail::isBigInteger(b.getRawNumber());
+        if (aBig && bBig) return detail::bigIntegerEquals(a.getRawNumber(), b.getRawNumber());
+        if (aBig || bBig) {
+            const Value& other = aBig ? b : a;
+            if (other.isInt64()) return false; // 在int64范围内，不可能相等
+            return detail::bigIntegerEquals(aBig ? a.getRawNumber() : b.getRawNumber(), other.getDouble());
+        }
+        bool aInt = a.isInt64(), bInt = b.isInt64();
+        if (aInt && bInt) return a.getInt64() == b.getInt64();
+        if (!aInt && !bInt) {
+            double x = a.getDouble(), y = b.getDouble();
+            return x == y || (x != x && y != y);
+        }
+        int64_t i;
+        return detail::doubleToInt64(aInt ? b.getDouble() : a.getDouble(), i) &&
+               i == (aInt ? a.getInt64() : b.getInt64());
+    };
+    auto keyLess = [](const Member* m, std::string_view key) { return m->key.getStringView() < key; };
+
+    stack.push({this, &rhs});
+    while (!stack.empty()) {
+        Pair pair = stack.top();
+        stack.pop();
+        const Value& a = *pair.a;
+        const Value& b = *pair.b;
+        if (&a == &b) continue;
+
+        ValueType ta = a.getType(), tb = b.getType();
+        if (isNumber(ta) && isNumber(tb)) {
+            if (!numberEquals(a, b)) return false;
+            continue;
+        }
+        if (ta != tb) return false;
+
+        // 紧凑数组的元素都是数字，逐个比较，无需入栈
+        if (a.isPacked() || b.isPacked()) {
+            size_t n = a.getSize();
+            if (b.getSize() != n) return false;
+            for (size_t i = 0; i < n; i++) {
+                Value x = a.isPacked() ? a.packedAt(i) : Value();
+                Value y = b.isPacked() ? b.packedAt(i) : Value();
+                const Value& ea = a.isPacked() ? x : a.a_->data[i];
+                const Value& eb = b.isPacked() ? y : b.a_->data[i];
+                if (!isNumber(ea.getType()) || !isNumber(eb.getType()) || !numberEquals(ea, eb)) return false;
+            }
+            continue;
+        }
+
+        switch (ta) {
+            case ValueType::TYPE_NULL:
+                break;
+            case ValueType::TYPE_BOOL:
+                if (a.b_ != b.b_) return false;
+                break;
+            case ValueType::TYPE_STRING:
+                if (a.s_ != b.s_ && a.getStringView() != b.getStringView()) return false;
+                break;
+            case ValueType::TYPE_RAW:
+                if (a.s_ != b.s_ && a.getRaw() != b.getRaw()) return false;
+                break;
+            case ValueType::TYPE_ARRAY:
+            case ValueType::TYPE_OBJECT: {
+                if (a.a_ == b.a_) break; // 共享同一存储
+                if (a.getSize() != b.getSize()) return false;
+
+                if (ta == ValueType::TYPE_ARRAY) {
+                    auto& x = a.a_->data;
+                    auto& y = b.a_->data;
+                    for (size_t i = 0; i < x.size(); i++) stack.push({&x[i], &y[i]});
+                    break;
+                }
+
+                auto& x = a.o_->data;
+                auto& y = b.o_->data;
+                // 先按位置比较key，成员顺序相同时无需查找
+                size_t i = 0;
+                for (; i < x.size() && x[i].key.getStringView() == y[i].key.getStringView(); i++)
+                    stack.push({&x[i].value, &y[i].value});
+                if (i == x.size()) break;
+                if (!ignoreMemberOrder) return false;
+
+                sorted.clear();
+                for (size_t j = i; j < y.size(); j++) sorted.push_back(&y[j]);
+                std::sort(sorted.begin(), sorted.end(), [](const Member* l, const Member* r) {
+                    return l->key.getStringView() < r->key.getStringView();
+                });
+                for (size_t j = i; j < x.size(); j++) {
+                    auto key = x[j].key.getStringView();
+                    auto iter = std::lower_bound(sorted.begin(), sorted.end(), key, keyLess);
+                    if (iter == sorted.end() || (*iter)->key.getStringView() != key) return false;
+                    stack.push({&x[j].value, &(*iter)->value});
+                }
+                break;
+            }
+            default:
+                assert(false && "bad type when equals.");
+        }
+    }
+    return true;
+}
 
 } // namespace json
 
-} // namespace mudong
\ No newline at end of file
+} // namespace mudong
+
+namespace std {
+
+template <>
+struct hash<mudong::json::Value> {
+    size_t operator()(const mudong::json::Value& value) const { return static_cast<size_t>(value.hash()); }
+};
+
+} // namespace std
+
+
+// detail::writeRawValue()的定义依赖Reader，Reader又依赖Value，故在Value定义完成后包含
+#include "Reader.hpp"
+// Value::cacheSerialization()的定义依赖Writer
+#include "Writer.hpp"
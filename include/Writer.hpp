@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cstring>
 #include "Value.hpp"
+#include "StringWriteStream.hpp"
 
 namespace mudong {
 
@@ -124,12 +125,13 @@ inline unsigned itoa(int64_t val, char* buf) {
 
 } // anonymous namespace
 
-// 编译器is_same类型检查只需声明，无需完整定义
-class StringWriteStream;
-class FileWriteStream;
-template <typename WriteStream,
-          typename = std::enable_if_t<std::is_same<StringWriteStream, WriteStream>::value ||
-                                      std::is_same<FileWriteStream, WriteStream>::value>>
+// WriteStream concept，Writer/MsgPackWriter/CborWriter只依赖以下接口：
+//     void  put(char c);
+//     void  put(std::string_view s);
+//     char* reserve(size_t n);   返回至少n字节的可写区域
+//     void  commit(size_t n);    确认reserve()区域中前n字节已写入，n不超过reserve()的参数
+// 目前实现有StringWriteStream、FileWriteStream以及CompressingWriteStream。
+template <typename WriteStream>
 class Writer: noncopyable {
 public:
     explicit Writer(WriteStream& os):
@@ -137,98 +139,65 @@ public:
     {}
 
     bool Null() {
-        prefix(ValueType::TYPE_NULL);
-        os_.put("null");
+        if (!prefix(ValueType::TYPE_NULL)) return false;
+        putNull();
         return true;
     }
 
     bool Bool(bool b) {
-        prefix(ValueType::TYPE_BOOL);
-        os_.put(b ? "true" : "false");
+        if (!prefix(ValueType::TYPE_BOOL)) return false;
+        putBool(b);
         return true;
     }
 
     bool Int32(int32_t i32) {
-        prefix(ValueType::TYPE_INT32);
-        char buf[11];
-        unsigned int cnt = itoa(i32, buf);
-        os_.put(std::string_view(buf, cnt));
+        if (!prefix(ValueType::TYPE_INT32)) return false;
+        putInt32(i32);
         return true;
     }
 
     bool Int64(int64_t i64) {
-        prefix(ValueType::TYPE_INT64);
-        char buf[20];
-        unsigned int cnt = itoa(i64, buf);
-        os_.put(std::string_view(buf, cnt));
+        if (!prefix(ValueType::TYPE_INT64)) return false;
+        putInt64(i64);
         return true;
     }
 
     bool Double(double d) {
-        prefix(ValueType::TYPE_DOUBLE);
-        char buf[32];
-
-        if (std::isinf(d)) {
-            std::strcpy(buf, "Infinity");
-        }
-        else if (std::isnan(d)) {
-            std::strcpy(buf, "NaN");
-        }
-        else {
-            int n = sprintf(buf, "%.17g", d);
-
-            // ".0" in "1.0" is important to represent double type.
-            assert(n > 0 && n < 32);
-            auto it = std::find_if(buf, buf + n, [](char c){return c == '.';}); // find '.'
-            if (it == buf + n) {
-                strcat(buf, ".0");
-            }
-        }
-
-        os_.put(buf);
+        if (!prefix(ValueType::TYPE_DOUBLE)) return false;
+        putDouble(d);
         return true;
     }
 
     bool String(std::string_view s) {
-        prefix(ValueType::TYPE_STRING);
-        os_.put('"');
-        for (auto c: s) {
-            auto u = static_cast<unsigned>(c);
-            switch (u) {
-                case '\"': os_.put("\\\""); break;
-                case '\b': os_.put("\\b");  break;
-                case '\f': os_.put("\\f");  break;
-                case '\n': os_.put("\\n");  break;
-                case '\r': os_.put("\\r");  break;
-                case '\t': os_.put("\\t");  break;
-                case '\\': os_.put("\\\\"); break;
-                default:
-                    if (u < 0x20) {
-                        char buf[7];
-                        snprintf(buf, 7, "\\u%04X", u);
-                        os_.put(buf);
-                    }
-                    else os_.put(c);
-                    break;
-            }
-        }
+        if (!prefix(ValueType::TYPE_STRING)) return false;
+        putString(s);
+        return true;
+    }
+
+    // 原样输出数字的原文，调用方保证其为合法的JSON数字
+    bool RawNumber(std::string_view s) {
+        if (!prefix(ValueType::TYPE_DOUBLE)) return false;
+        os_.put(s);
+        return true;
+    }
 
-        os_.put('"');
+    // 原样输出已序列化的JSON片段，只补上所需的','与':'。调用方保证其为单个合法的JSON值
+    bool RawValue(std::string_view json) {
+        if (!prefix(ValueType::TYPE_RAW)) return false;
+        os_.put(json);
         return true;
     }
 
     bool StartObject() {
-        prefix(ValueType::TYPE_OBJECT);
+        if (!prefix(ValueType::TYPE_OBJECT)) return false;
         stack_.emplace_back(false);
         os_.put('{');
         return true;
     }
 
     bool Key(std::string_view s) {
-        prefix(ValueType::TYPE_STRING);
-        os_.put('"');
-        os_.put(s);
-        os_.put('"');
+        if (!prefix(ValueType::TYPE_STRING)) return false;
+        putString(s);
         return true;
     }
 
@@ -241,7 +210,7 @@ public:
     }
 
     bool StartArray() {
-        prefix(ValueType::TYPE_ARRAY);
+        if (!prefix(ValueType::TYPE_ARRAY)) return false;
         stack_.emplace_back(true);
         os_.put('[');
         return true;
@@ -255,7 +224,96 @@ public:
         return true;
     }
 
+    // 允许输出多个根值并以separator分隔，如"\n"输出NDJSON，可把Reader::parseNext()的逐个结果写到同一个Writer；
+    // 未设置时只允许一个根值，之后的根值使对应的方法返回false且不输出任何内容
+    void setRootSeparator(std::string_view separator) { separator_ = separator; }
+
+public:
+    // 以下为不经过Level栈的底层输出，供Reflect.hpp生成的序列化代码使用：
+    // 调用方先以beginValue()登记一个值，其内部的括号、逗号与键由调用方自行写出。
+    // 返回false时该值不能写出(见setRootSeparator())
+    bool beginValue(ValueType type) { return prefix(type); }
+
+    void putFragment(std::string_view s) { os_.put(s); }
+
+    void putNull() { putLiteral("null"); }
+
+    void putBool(bool b) {
+        if (b) putLiteral("true");
+        else   putLiteral("false");
+    }
+
+    void putInt32(int32_t i32) { os_.commit(itoa(i32, os_.reserve(11))); }
+    void putInt64(int64_t i64) { os_.commit(itoa(i64, os_.reserve(20))); }
+    void putUint64(uint64_t u64) { os_.commit(itoa_(u64, os_.reserve(20))); }
+
+    void putDouble(double d) {
+        if (std::isinf(d)) {
+            putLiteral("Infinity");
+        }
+        else if (std::isnan(d)) {
+            putLiteral("NaN");
+        }
+        else {
+            // "%.17g"最多输出24个字符(如"-1.2345678901234567e-308"，带'e'时不再追加".0")，连同'\0'不超过32字节
+            char* buf = os_.reserve(32);
+            int n = snprintf(buf, 32, "%.17g", d);
+
+            // ".0" in "1.0" is important to represent double type.
+            assert(n > 0 && n < 30);
+            auto it = std::find_if(buf, buf + n, [](char c){return c == '.' || c == 'e';}); // find '.' or exponent
+            if (it == buf + n) {
+                buf[n++] = '.';
+                buf[n++] = '0';
+            }
+            os_.commit(static_cast<size_t>(n));
+        }
+    }
+
+    // 先求出转义后的长度，按实际大小reserve后直接写入；不含需转义的字符时整体拷贝
+    void putString(std::string_view s) {
+        static const char hexDigits[] = "0123456789ABCDEF";
+        size_t n = detail::escapedSize(s);
+        char* begin = os_.reserve(n + 2);
+        char* p = begin;
+        *p++ = '"';
+        if (n == s.size()) {
+            p = std::copy(s.begin(), s.end(), p);
+        }
+        else {
+            for (auto c: s) {
+                auto u = static_cast<unsigned char>(c);
+                switch (u) {
+                    case '\"': *p++ = '\\'; *p++ = '"';  break;
+                    case '\b': *p++ = '\\'; *p++ = 'b';  break;
+                    case '\f': *p++ = '\\'; *p++ = 'f';  break;
+                    case '\n': *p++ = '\\'; *p++ = 'n';  break;
+                    case '\r': *p++ = '\\'; *p++ = 'r';  break;
+                    case '\t': *p++ = '\\'; *p++ = 't';  break;
+                    case '\\': *p++ = '\\'; *p++ = '\\'; break;
+                    default:
+                        if (u < 0x20) {
+                            std::memcpy(p, "\\u00", 4);
+                            p[4] = hexDigits[u >> 4];
+                            p[5] = hexDigits[u & 0xF];
+                            p += 6;
+                        }
+                        else *p++ = c;
+                        break;
+                }
+            }
+        }
+        *p++ = '"';
+        os_.commit(static_cast<size_t>(p - begin));
+    }
+
 private:
+    template <size_t N>
+    void putLiteral(const char (&literal)[N]) {
+        std::memcpy(os_.reserve(N - 1), literal, N - 1);
+        os_.commit(N - 1);
+    }
+
     struct Level {
         explicit Level(bool inArray_):
                 inArray(inArray_), valueCount(0)
@@ -266,13 +324,17 @@ private:
 
     // 数组：每个元素之间添加“,”
     // 对象：k和v之间添加“:”，键值对之间添加“,”
-    void prefix(ValueType type) {
-        if (seeValue_)
-            assert(!stack_.empty() && "root not singular");
-        else
+    // 根值之后未设置分隔符又写入值时返回false：直接相连的两个根值(如"12")无法再解析
+    bool prefix(ValueType type) {
+        if (!seeValue_)
             seeValue_ = true;
-        
-        if (stack_.empty()) return;
+        else if (stack_.empty()) {
+            if (separator_.empty()) return false;
+            os_.put(separator_);
+            return true;
+        }
+
+        if (stack_.empty()) return true;
 
         Level& top = stack_.back();
         if (top.inArray) {
@@ -289,15 +351,121 @@ private:
             }
         }
         top.valueCount++;
+        return true;
     }
-    
+
 
 private:
     std::vector<Level> stack_;
     WriteStream& os_;
     bool seeValue_;
+    std::string separator_; // 根值之间的分隔符
 };
 
+// 将子树完整输出一遍，同时记录每个容器输出的字节区间，结束后各容器的缓存都指向这一份输出。
+// 仍有效的缓存直接拷贝，不再输出其内容，但要遍历其子树，把子树中的缓存也移到新的输出中，
+// 旧的输出因此不再被引用而释放。以显式栈代替递归，与writeTo()相同
+inline void Value::cacheSerialization(size_t minBytes) {
+    if (type_ != ValueType::TYPE_ARRAY && type_ != ValueType::TYPE_OBJECT) return;
+
+    struct Frame {
+        const Value* container;
+        size_t       index;
+        size_t       start; // 容器的'['或'{'在输出中的偏移
+    };
+    // 输出完成后才能创建共享的buffer，先记下各容器的区间
+    struct Slice {
+        const Value* container;
+        size_t       offset;
+        size_t       length;
+    };
+    detail::SmallStack<Frame, 32> stack;
+    std::vector<Slice> slices;
+    StringWriteStream os;
+    Writer<StringWriteStream> writer(os);
+
+    auto addSlice = [&slices, minBytes](const Value* container, size_t offset, size_t length) {
+        if (length >= minBytes) slices.push_back({container, offset, length});
+        else dropBytes(container->cacheSlot());
+    };
+    // cached的缓存已拷贝到输出的start处，子树中与其同属一份输出的缓存按相对位置移过来，其余的释放
+    auto rebase = [&addSlice](const Value* cached, size_t start) {
+        const NodeCache* root = cached->cacheOf();
+        auto buffer = root->buffer;
+        size_t offset = root->offset, length = root->length;
+        detail::SmallStack<const Value*, 32> pending;
+        pending.push(cached);
+        while (!pending.empty()) {
+            const Value* container = pending.top();
+            pending.pop();
+            const NodeCache* cache = container->cacheOf();
+            if (cache != nullptr && cache->buffer == buffer && cache->offset >= offset &&
+                cache->offset + cache->length <= offset + length) {
+                addSlice(container, start + (cache->offset - offset), cache->length);
+            }
+            else {
+                dropBytes(container->cacheSlot());
+            }
+            auto visit = [&pending](const Value& child) {
+                if (child.type_ == ValueType::TYPE_ARRAY || child.type_ == ValueType::TYPE_OBJECT) pending.push(&child);
+            };
+            if (container->type_ == ValueType::TYPE_ARRAY) {
+                for (auto& child: container->a_->data) visit(child);
+            }
+            else {
+                for (auto& member: container->o_->data) visit(member.value);
+            }
+        }
+    };
+
+    const Value* value = this;
+    while (true) {
+        if (value->type_ == ValueType::TYPE_ARRAY && !value->hasSerializationCache()) {
+            writer.StartArray();
+            stack.push({value, 0, os.size() - 1});
+        }
+        else if (value->type_ == ValueType::TYPE_OBJECT && !value->hasSerializationCache()) {
+            writer.StartObject();
+            stack.push({value, 0, os.size() - 1});
+        }
+        else {
+            value->writeTo(writer);
+            if (value->hasSerializationCache()) rebase(value, os.size() - value->cacheOf()->length);
+        }
+
+        // 找到下一个待输出的值，途中结束已输出完的容器并记录其区间
+        value = nullptr;
+        while (!stack.empty()) {
+            Frame& top = stack.top();
+            if (top.container->type_ == ValueType::TYPE_ARRAY) {
+                auto& array = top.container->a_->data;
+                if (top.index < array.size()) {
+                    value = &array[top.index++];
+                    break;
+                }
+                writer.EndArray();
+            }
+            else {
+                auto& object = top.container->o_->data;
+                if (top.index < object.size()) {
+                    auto& member = object[top.index++];
+                    writer.Key(member.key.getStringView());
+                    value = &member.value;
+                    break;
+                }
+                writer.EndObject();
+            }
+            addSlice(top.container, top.start, os.size() - top.start);
+            stack.pop();
+        }
+        if (value == nullptr) break;
+    }
+
+    if (slices.empty()) return;
+    auto buffer = std::make_shared<const std::string>(os.take());
+    for (auto& slice: slices) slice.container->storeCache(buffer, slice.offset, slice.length);
+}
+
 } // namespace json
 
 } // namespace mudong
\ No newline at end of file
@@ -0,0 +1,83 @@
+//
+// Created by mudong on 24-03-14.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// 替换全局operator new/delete，统计分配次数、字节数与峰值占用，供测试断言分配预算、
+// 基准测试报告每次操作的分配。每个可执行文件只能有一个编译单元包含本文件。
+// 计数器不加锁，只在单线程中使用。
+namespace alloc_counter {
+
+struct Counters {
+    size_t allocations = 0;
+    size_t frees = 0;
+    size_t bytes = 0;
+    size_t live = 0;  // 当前未释放的字节数
+    size_t peak = 0;  // live的峰值
+};
+
+inline Counters counters;
+
+// 记录区间内的分配，peak相对区间开始时的live计算；区间不能嵌套
+class Scope {
+public:
+    Scope(): start_(counters) { counters.peak = counters.live; }
+
+    size_t allocations() const { return counters.allocations - start_.allocations; }
+    size_t frees      () const { return counters.frees - start_.frees; }
+    size_t bytes      () const { return counters.bytes - start_.bytes; }
+    size_t peak       () const { return counters.peak - start_.live; }
+    // 区间内净增的字节数，可能为负
+    long   growth     () const { return static_cast<long>(counters.live) - static_cast<long>(start_.live); }
+
+private:
+    Counters start_;
+};
+
+// 在Google Benchmark的State中报告每次迭代的分配次数与字节数
+template <typename State>
+void report(State& s, const Scope& scope) {
+    auto iterations = static_cast<double>(s.iterations());
+    s.counters["allocs/op"] = static_cast<double>(scope.allocations()) / iterations;
+    s.counters["bytes/op"] = static_cast<double>(scope.bytes()) / iterations;
+}
+
+} // namespace alloc_counter
+
+// 在分配的内存前保存大小，释放时据此更新live
+namespace alloc_counter::detail {
+
+constexpr size_t kHeader = alignof(std::max_align_t);
+
+inline void* allocate(size_t n) {
+    void* p = std::malloc(n + kHeader);
+    if (p == nullptr) throw std::bad_alloc();
+    *static_cast<size_t*>(p) = n;
+    counters.allocations++;
+    counters.bytes += n;
+    counters.live += n;
+    if (counters.live > counters.peak) counters.peak = counters.live;
+    return static_cast<char*>(p) + kHeader;
+}
+
+inline void deallocate(void* p) noexcept {
+    if (p == nullptr) return;
+    void* base = static_cast<char*>(p) - kHeader;
+    counters.frees++;
+    counters.live -= *static_cast<size_t*>(base);
+    std::free(base);
+}
+
+} // namespace alloc_counter::detail
+
+void* operator new  (size_t n)                   { return alloc_counter::detail::allocate(n); }
+void* operator new[](size_t n)                   { return alloc_counter::detail::allocate(n); }
+void  operator delete  (void* p) noexcept         { alloc_counter::detail::deallocate(p); }
+void  operator delete[](void* p) noexcept         { alloc_counter::detail::deallocate(p); }
+void  operator delete  (void* p, size_t) noexcept { alloc_counter::detail::deallocate(p); }
+void  operator delete[](void* p, size_t) noexcept { alloc_counter::detail::deallocate(p); }
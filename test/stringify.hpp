@@ -0,0 +1,19 @@
+//
+// Created by mudong on 24-04-05.
+//
+
+#pragma once
+
+#include <string>
+
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+// 以Writer的紧凑格式输出，供测试比较结果。T为Value、Document、SnapshotValue等提供writeTo()的类型
+template <typename T>
+std::string stringify(const T& value) {
+    mudong::json::StringWriteStream os;
+    mudong::json::Writer writer(os);
+    value.writeTo(writer);
+    return std::string(os.getStringView());
+}
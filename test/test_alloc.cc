@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <CborReader.hpp>
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "alloc_counter.hpp"
+
+using namespace mudong::json;
+
+// 参考文档上各操作的分配预算。预算为当前实现的实测值，分配增多即测试失败；
+// 优化减少分配后应同步下调预算。
+
+namespace {
+
+// README中的示例：7个成员，4个标量，2个字符串，1个含4个元素的数组
+const std::string kSmall = R"({"hello":"world","t":true,"f":false,"n":null,"i":123,"pi":1.5,"a":[1,2,3,4]})";
+
+// 100个含4个成员的对象组成的数组
+std::string makeArrayOfObjects() {
+    std::string json = "[";
+    for (int i = 0; i < 100; i++) {
+        if (i > 0) json += ",";
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\",\"price\":1.5,\"ok\":true}";
+    }
+    return json + "]";
+}
+const std::string kArray = makeArrayOfObjects();
+
+size_t parseAllocations(const std::string& json, bool exactReserve = false) {
+    alloc_counter::Scope scope;
+    {
+        Document doc;
+        doc.setExactReserve(exactReserve);
+        EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    }
+    return scope.allocations();
+}
+
+} // anonymous namespace
+
+// Document::parse()：每个字符串与容器各一次节点分配加一次缓冲区分配，另有容器扩容与解析栈的分配
+TEST(alloc_budget, parse) {
+    EXPECT_LE(parseAllocations(kSmall), 27u);
+    EXPECT_LE(parseAllocations(kArray), 1411u);
+}
+
+// CBOR的不定长字符串拼接到整次解析共用的缓冲区中，预热之后再解析不再分配内存
+TEST(alloc_budget, cbor_chunked_strings) {
+    struct Counter {
+        size_t strings = 0;
+        bool Null  ()                   { return true; }
+        bool Bool  (bool)               { return true; }
+        bool Int32 (int32_t)            { return true; }
+        bool Int64 (int64_t)            { return true; }
+        bool Double(double)             { return true; }
+        bool String(std::string_view s) { strings += s.size() == 80; return true; }
+        bool Key   (std::string_view s) { strings += s.size() == 80; return true; }
+        bool StartObject()              { return true; }
+        bool EndObject  ()              { return true; }
+        bool StartArray ()              { return true; }
+        bool EndArray   ()              { return true; }
+    };
+    // {_ (_ "x"*40, "x"*40): (_ "x"*40, "x"*40), ...}，100对
+    std::string chunk = "\x78\x28" + std::string(40, 'x');
+    std::string text = "\x7f" + chunk + chunk + "\xff";
+    std::string cbor = "\xbf";
+    for (int i = 0; i < 100; i++) cbor += text + text;
+    cbor += "\xff";
+
+    Counter warmup;
+    ASSERT_EQ(ParseError::PARSE_OK, CborReader::parse(cbor, warmup));
+    Counter counter;
+    alloc_counter::Scope scope;
+    ASSERT_EQ(ParseError::PARSE_OK, CborReader::parse(cbor, counter));
+    EXPECT_EQ(200u, counter.strings);
+    EXPECT_EQ(0u, scope.allocations());
+}
+
+// 预扫描得到各容器的元素个数后，每个容器的缓冲区只分配一次，另有预扫描结果本身的分配
+TEST(alloc_budget, parse_exact_reserve) {
+    EXPECT_LE(parseAllocations(kSmall, true), 24u);
+    EXPECT_LE(parseAllocations(kArray, true), 1212u);
+
+    Document doc;
+    doc.setExactReserve(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kArray));
+    EXPECT_EQ(100u, doc.getArray().capacity());
+    for (auto& obj: doc.getArray()) EXPECT_EQ(4u, obj.getObject().capacity());
+
+    // 字符串中的括号与逗号不计入，空容器不预留
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(R"([[],{},"[,]\"{,}",{"a,":[1,"]"],"b":{}},[[1,2],[3]]])"));
+    EXPECT_EQ(5u, doc.getArray().capacity());
+    EXPECT_EQ(0u, doc[0].getArray().capacity());
+    EXPECT_EQ(2u, doc[3].getObject().capacity());
+    EXPECT_EQ(2u, doc[3]["a,"].getArray().capacity());
+    EXPECT_EQ(2u, doc[4].getArray().capacity());
+    EXPECT_EQ(1u, doc[4][1].getArray().capacity());
+}
+
+// 只有逗号而没有值的非法输入不按逗号个数预留，出错前的内存峰值与输入长度无关
+TEST(alloc_budget, parse_exact_reserve_malformed) {
+    std::string commas = "[" + std::string(100000, ',') + "]";
+    std::string nested = "[[" + std::string(100000, ',') + "]]";
+    for (auto& json: {commas, nested}) {
+        alloc_counter::Scope scope;
+        {
+            Document doc;
+            doc.setExactReserve(true);
+            EXPECT_NE(ParseError::PARSE_OK, doc.parse(json));
+        }
+        EXPECT_LE(scope.peak(), 4096u);
+    }
+}
+
+// 预先按估计大小分配缓冲区后，输出只剩StringWriteStream与Writer内部栈的分配
+TEST(alloc_budget, serialize) {
+    const std::string escaped = R"({"k\n":["a\u0001\"","\\\t",")" + std::string(1000, 'x') + R"("]})";
+    for (auto* json: {&kSmall, &kArray, &escaped}) {
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(*json));
+        alloc_counter::Scope scope;
+        StringWriteStream os(doc.estimateSerializedSize());
+        Writer writer(os);
+        doc.writeTo(writer);
+        EXPECT_LE(scope.allocations(), 3u);
+        EXPECT_EQ(*json, os.getStringView());
+    }
+}
+
+// 拷贝只增加引用计数
+TEST(alloc_budget, copy) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kArray));
+    alloc_counter::Scope scope;
+    Value copy(doc);
+    Value assigned;
+    assigned = copy;
+    EXPECT_EQ(0u, scope.allocations());
+}
+
+// 析构释放全部分配，且析构本身不分配
+TEST(alloc_budget, destroy) {
+    auto* doc = new Document;
+    alloc_counter::Scope total;
+    ASSERT_EQ(ParseError::PARSE_OK, doc->parse(kArray));
+    size_t allocations = total.allocations();
+    {
+        alloc_counter::Scope scope;
+        delete doc;
+        EXPECT_EQ(0u, scope.allocations());
+    }
+    EXPECT_EQ(allocations + 1, total.frees()); // 另加Document对象本身
+    EXPECT_LE(total.growth(), -static_cast<long>(sizeof(Document)));
+}
+
+// 复用Document并开启节点缓存后，稳定状态下重复解析结构相同的消息不再分配
+TEST(alloc_budget, pooled_reparse) {
+    NodePool::local().setLimits(4096, 1 << 20);
+    for (auto* json: {&kSmall, &kArray}) {
+        for (int i = 0; i < 3; i++) { // 预热
+            auto doc = DocumentPool::local().acquire();
+            ASSERT_EQ(ParseError::PARSE_OK, doc->parse(*json));
+        }
+        alloc_counter::Scope scope;
+        for (int i = 0; i < 100; i++) {
+            auto doc = DocumentPool::local().acquire();
+            ASSERT_EQ(ParseError::PARSE_OK, doc->parse(*json));
+        }
+        EXPECT_EQ(0u, scope.allocations());
+    }
+    NodePool::local().setLimits(0, 0);
+    EXPECT_EQ(0u, NodePool::local().nodes());
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+#include <MsgPackWriter.hpp>
+#include <MsgPackReader.hpp>
+#include <CborWriter.hpp>
+#include <CborReader.hpp>
+
+using namespace mudong::json;
+
+template <template <typename...> class BinaryWriter, typename BinaryReader>
+void TEST_BINARY_ROUNDTRIP(const std::string& json) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+
+    StringWriteStream bin;
+    BinaryWriter<StringWriteStream> binWriter(bin);
+    doc.writeTo(binWriter);
+
+    Document decoded;
+    ASSERT_EQ(ParseError::PARSE_OK, BinaryReader::parse(bin.getStringView(), decoded));
+    StringWriteStream os;
+    Writer writer(os);
+    decoded.writeTo(writer);
+    EXPECT_EQ(json, os.getStringView());
+}
+
+inline void TEST_ROUNDTRIP(const std::string& json) {
+    TEST_BINARY_ROUNDTRIP<MsgPackWriter, MsgPackReader>(json);
+    TEST_BINARY_ROUNDTRIP<CborWriter, CborReader>(json);
+}
+
+template <typename Value>
+std::string encodeMsgPack(const Value& value) {
+    StringWriteStream os;
+    MsgPackWriter writer(os);
+    value.writeTo(writer);
+    return os.take();
+}
+
+TEST(binary, roundtrip) {
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("true");
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-1");
+    TEST_ROUNDTRIP("-33");
+    TEST_ROUNDTRIP("255");
+    TEST_ROUNDTRIP("-2147483648");
+    TEST_ROUNDTRIP("12345678901234");
+    TEST_ROUNDTRIP("-12345678901234");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("1.0000000000000002");
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("[[],[[]],{}]");
+    TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+
+    std::string big = "[";
+    for (int i = 0; i < 70000; ++i) big += std::to_string(i) + ",";
+    big.back() = ']';
+    TEST_ROUNDTRIP(big);
+
+    std::string longString(70000, 'x');
+    TEST_ROUNDTRIP("{\"" + longString + "\":\"" + longString + "\"}");
+}
+
+TEST(binary, msgpack_encoding) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"a\":[1,-1,300],\"b\":null}"));
+    EXPECT_EQ(std::string("\x82\xa1" "a" "\x93\x01\xff\xcd\x01\x2c\xa1" "b" "\xc0"), encodeMsgPack(doc));
+}
+
+TEST(binary, cbor_encoding) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[1,-1,500,1.5]"));
+    StringWriteStream os;
+    CborWriter writer(os);
+    doc.writeTo(writer);
+    EXPECT_EQ(std::string("\x9f\x01\x20\x19\x01\xf4\xfa\x3f\xc0\x00\x00\xff", 12), os.getStringView());
+}
+
+TEST(binary, cbor_definite_and_chunked) {
+    // {"a": [1, 2], "bc": (_ "x", "y")} with definite-length containers and a chunked text string
+    std::string cbor("\xa2\x61" "a" "\x82\x01\x02\x62" "bc" "\x7f\x61" "x" "\x61" "y" "\xff", 15);
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, CborReader::parse(cbor, doc));
+    StringWriteStream os;
+    Writer writer(os);
+    doc.writeTo(writer);
+    EXPECT_EQ("{\"a\":[1,2],\"bc\":\"xy\"}", os.getStringView());
+}
+
+TEST(binary, second_root_rejected) {
+    // 与Writer相同，第二个根值使事件返回false且不输出任何内容
+    StringWriteStream msgpack;
+    MsgPackWriter mw(msgpack);
+    EXPECT_TRUE(mw.Int32(1));
+    EXPECT_FALSE(mw.Int32(2));
+    EXPECT_FALSE(mw.StartArray());
+    EXPECT_EQ(std::string("\x01"), msgpack.getStringView());
+
+    StringWriteStream cbor;
+    CborWriter cw(cbor);
+    EXPECT_TRUE(cw.StartArray());
+    EXPECT_TRUE(cw.Null());
+    EXPECT_TRUE(cw.EndArray());
+    EXPECT_FALSE(cw.String("x"));
+    EXPECT_FALSE(cw.StartObject());
+    EXPECT_EQ(std::string("\x9f\xf6\xff"), cbor.getStringView());
+
+    std::string json = "1 2";
+    StringReadStream is(json);
+    StringWriteStream os;
+    MsgPackWriter single(os);
+    EXPECT_EQ(ParseError::PARSE_OK, Reader::parseNext(is, single));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, Reader::parseNext(is, single));
+}
+
+TEST(binary, errors) {
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, MsgPackReader::parse(std::string_view("\x92\x01", 2), doc));
+    Document doc2;
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, MsgPackReader::parse(std::string_view("\x01\x02", 2), doc2));
+    Document doc3;
+    EXPECT_EQ(ParseError::PARSE_MISS_KEY, MsgPackReader::parse(std::string_view("\x81\x01\x01", 3), doc3));
+    Document doc4;
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG,
+              MsgPackReader::parse(std::string_view("\xcf\xff\xff\xff\xff\xff\xff\xff\xff", 9), doc4));
+    Document doc5;
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, CborReader::parse(std::string_view("\x41\x00", 2), doc5));
+}
+
+TEST(binary, uint64) {
+    // 提供Uint64()的Handler可以取到超出int64的无符号整数，与Reader一致
+    struct Handler {
+        uint64_t u64 = 0;
+        bool Null  ()                   { return false; }
+        bool Bool  (bool)               { return false; }
+        bool Int32 (int32_t)            { return false; }
+        bool Int64 (int64_t)            { return false; }
+        bool Uint64(uint64_t u)         { u64 = u; return true; }
+        bool Double(double)             { return false; }
+        bool String(std::string_view)   { return false; }
+        bool Key   (std::string_view)   { return false; }
+        bool StartObject()              { return false; }
+        bool EndObject  ()              { return false; }
+        bool StartArray ()              { return false; }
+        bool EndArray   ()              { return false; }
+    };
+    Handler msgpack;
+    ASSERT_EQ(ParseError::PARSE_OK,
+              MsgPackReader::parse(std::string_view("\xcf\xff\xff\xff\xff\xff\xff\xff\xff", 9), msgpack));
+    EXPECT_EQ(UINT64_MAX, msgpack.u64);
+    Handler cbor;
+    ASSERT_EQ(ParseError::PARSE_OK,
+              CborReader::parse(std::string_view("\x1b\x80\x00\x00\x00\x00\x00\x00\x00", 9), cbor));
+    EXPECT_EQ(uint64_t(INT64_MAX) + 1, cbor.u64);
+
+    // 负整数仍然超出范围
+    Handler negative;
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG,
+              CborReader::parse(std::string_view("\x3b\x80\x00\x00\x00\x00\x00\x00\x00", 9), negative));
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG,
+              CborReader::parse(std::string_view("\x1b\x80\x00\x00\x00\x00\x00\x00\x00", 9), doc));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <Columnar.hpp>
+#include <Document.hpp>
+
+using namespace mudong::json;
+
+namespace {
+
+std::vector<ColumnSpec> specs() {
+    return {
+        {"/id", ColumnType::COLUMN_INT64},
+        {"/price", ColumnType::COLUMN_DOUBLE},
+        {"/ok", ColumnType::COLUMN_BOOL},
+        {"/user/name", ColumnType::COLUMN_STRING},
+        {"/a~1b", ColumnType::COLUMN_INT64},
+    };
+}
+
+std::string records(int count) {
+    std::string text;
+    for (int i = 0; i < count; i++) {
+        text += "{\"id\":" + std::to_string(i) + ",\"price\":" + std::to_string(i) + ".5,\"ok\":" +
+                (i % 2 ? "true" : "false") + ",\"user\":{\"name\":\"u" + std::to_string(i) + "\"}}\n";
+    }
+    return text;
+}
+
+} // anonymous namespace
+
+TEST(columnar, array_of_records) {
+    ColumnarBuilder builder(specs());
+    ASSERT_EQ(ParseError::PARSE_OK, builder.parse(
+            "[{\"id\":1,\"price\":2,\"ok\":true,\"user\":{\"name\":\"x\\n\",\"id\":9},\"a/b\":7},"
+            " {\"price\":1.5,\"user\":null,\"extra\":[{\"id\":5}]},"
+            " {\"id\":\"3\",\"price\":[1],\"ok\":1,\"user\":{\"name\":2}},"
+            " 42,"
+            " {\"id\":4,\"id\":5,\"user\":{\"name\":\"\"}}]"));
+    ASSERT_EQ(5u, builder.getRows());
+
+    const Column& id = builder.getColumn(0);
+    EXPECT_EQ(5u, id.getSize());
+    EXPECT_EQ(3u, id.getNullCount());
+    EXPECT_EQ(1, id.getInt64s()[0]);
+    EXPECT_TRUE(id.isNull(1));
+    EXPECT_TRUE(id.isNull(2)); // 类型不符
+    EXPECT_TRUE(id.isNull(3)); // 不是对象的记录
+    EXPECT_EQ(4, id.getInt64s()[4]); // 重复的key取第一个
+
+    const Column& price = *builder.findColumn("/price");
+    EXPECT_EQ(2.0, price.getDoubles()[0]); // 整数转为double
+    EXPECT_EQ(1.5, price.getDoubles()[1]);
+    EXPECT_TRUE(price.isNull(2));
+
+    const Column& ok = builder.getColumn(2);
+    EXPECT_EQ(1, ok.getBools()[0]);
+    EXPECT_TRUE(ok.isNull(1));
+    EXPECT_TRUE(ok.isNull(2));
+
+    const Column& name = builder.getColumn(3);
+    EXPECT_EQ("x\n", name.getString(0));
+    EXPECT_TRUE(name.isNull(1));
+    EXPECT_TRUE(name.isNull(2));
+    EXPECT_FALSE(name.isNull(4));
+    EXPECT_EQ("", name.getString(4));
+
+    EXPECT_EQ(7, builder.getColumn(4).getInt64s()[0]);
+    EXPECT_EQ(nullptr, builder.findColumn("/missing"));
+}
+
+TEST(columnar, whole_record) {
+    ColumnarBuilder builder({{"", ColumnType::COLUMN_STRING}, {"/x", ColumnType::COLUMN_INT64}});
+    ASSERT_EQ(ParseError::PARSE_OK, builder.parseLines("\"a\"\n\n{\"x\":1}\r\n  \n\"b\""));
+    ASSERT_EQ(3u, builder.getRows());
+    EXPECT_EQ("a", builder.getColumn(0).getString(0));
+    EXPECT_TRUE(builder.getColumn(0).isNull(1));
+    EXPECT_EQ(1, builder.getColumn(1).getInt64s()[1]);
+    EXPECT_EQ("b", builder.getColumn(0).getString(2));
+}
+
+TEST(columnar, error_keeps_previous_records) {
+    ColumnarBuilder builder(specs());
+    ASSERT_EQ(ParseError::PARSE_OK, builder.parseLines(records(3)));
+    EXPECT_NE(ParseError::PARSE_OK, builder.parseLines("{\"id\":10}\n{\"id\":11,\"user\":{\"name\":\"x\"},\n{\"id\":12}"));
+    ASSERT_EQ(4u, builder.getRows());
+    for (auto& column: builder.getColumns()) EXPECT_EQ(4u, column.getSize());
+    EXPECT_EQ(10, builder.getColumn(0).getInt64s()[3]);
+    EXPECT_EQ("u2", builder.getColumn(3).getString(2));
+    EXPECT_EQ(size_t(3 * 2), builder.getColumn(3).getChars().size());
+
+    builder.clear();
+    EXPECT_EQ(0u, builder.getRows());
+    ASSERT_EQ(ParseError::PARSE_OK, builder.parse("{\"id\":1}"));
+    EXPECT_EQ(1u, builder.getColumn(0).getSize());
+}
+
+TEST(columnar, parallel) {
+    std::string text = records(20000);
+    ColumnarBuilder serial(specs());
+    ASSERT_EQ(ParseError::PARSE_OK, serial.parseLines(text));
+    ColumnarBuilder parallel(specs());
+    ASSERT_EQ(ParseError::PARSE_OK, parallel.parseLines(text, 4));
+    ASSERT_EQ(20000u, parallel.getRows());
+
+    for (size_t c = 0; c < serial.getColumns().size(); c++) {
+        const Column& a = serial.getColumn(c);
+        const Column& b = parallel.getColumn(c);
+        ASSERT_EQ(a.getSize(), b.getSize());
+        EXPECT_EQ(a.getNullCount(), b.getNullCount());
+        auto va = a.getValidity(), vb = b.getValidity();
+        ASSERT_EQ(va.size(), vb.size());
+        for (size_t i = 0; i < va.size(); i++) EXPECT_EQ(va[i], vb[i]);
+    }
+    for (size_t i = 0; i < 20000; i++) {
+        ASSERT_EQ(static_cast<int64_t>(i), parallel.getColumn(0).getInt64s()[i]);
+        ASSERT_EQ("u" + std::to_string(i), parallel.getColumn(3).getString(i));
+    }
+    EXPECT_EQ(20000u, parallel.getColumn(4).getNullCount());
+
+    // 出错的块之后的块不再拼接
+    std::string bad = records(5000) + "{]\n" + records(5000);
+    ColumnarBuilder partial(specs());
+    EXPECT_NE(ParseError::PARSE_OK, partial.parseLines(bad, 4));
+    EXPECT_EQ(5000u, partial.getRows());
+}
+
+TEST(columnar, bitmap_append) {
+    // 行数不是64的倍数时拼接位图
+    ColumnarBuilder a({{"", ColumnType::COLUMN_INT64}}), b({{"", ColumnType::COLUMN_INT64}});
+    std::string text;
+    for (int i = 0; i < 70; i++) text += i % 3 ? "1\n" : "null\n";
+    ASSERT_EQ(ParseError::PARSE_OK, a.parseLines(text));
+    ASSERT_EQ(ParseError::PARSE_OK, b.parseLines(text));
+    a.append(b);
+    ASSERT_EQ(140u, a.getRows());
+    for (size_t i = 0; i < 140; i++) EXPECT_EQ(i % 70 % 3 == 0, a.getColumn(0).isNull(i)) << i;
+}
+
+TEST(columnar, same_as_document) {
+    std::string text = records(100);
+    ColumnarBuilder builder(specs());
+    ASSERT_EQ(ParseError::PARSE_OK, builder.parseLines(text));
+    size_t row = 0, begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(std::string_view(text).substr(begin, end - begin)));
+        EXPECT_EQ(doc["id"].getInt64(), builder.getColumn(0).getInt64s()[row]);
+        EXPECT_EQ(doc["price"].getDouble(), builder.getColumn(1).getDoubles()[row]);
+        EXPECT_EQ(doc["ok"].getBool(), builder.getColumn(2).getBools()[row] != 0);
+        EXPECT_EQ(doc["user"]["name"].getStringView(), builder.getColumn(3).getString(row));
+        begin = end + 1;
+        row++;
+    }
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <CompressedReadStream.hpp>
+#include <CompressedWriteStream.hpp>
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+using namespace mudong::json;
+
+namespace {
+
+// 足够大的文档，使压缩数据跨越多个窗口
+std::string makeSample() {
+    std::string json = "[";
+    for (int i = 0; i < 5000; i++) {
+        if (i > 0) json += ",";
+        json += "{\"id\":" + std::to_string(i) +
+                ",\"name\":\"item" + std::to_string(i) + "\"" +
+                ",\"price\":" + std::to_string(i) + ".25" +
+                ",\"tags\":[true,false,null]}";
+    }
+    json += "]";
+    return json;
+}
+
+template <typename WriteStream>
+void writeCompressed(FILE* file, std::string_view json) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    WriteStream os(file);
+    Writer writer(os);
+    doc.writeTo(writer);
+    os.finish();
+    EXPECT_TRUE(os.good());
+}
+
+template <typename WriteStream, typename ReadStream>
+void roundtrip() {
+    std::string sample = makeSample();
+    for (bool background: {false, true}) {
+        for (size_t window: {7, 4096, 65536}) {
+            FILE* file = tmpfile();
+            ASSERT_NE(nullptr, file);
+            writeCompressed<WriteStream>(file, sample);
+            rewind(file);
+
+            ReadStream is(file, background, window);
+            Document doc;
+            ASSERT_EQ(ParseError::PARSE_OK, doc.parseStream(is));
+            EXPECT_TRUE(is.good());
+            ASSERT_EQ(5000u, doc.getSize());
+            EXPECT_EQ(4999, doc[4999]["id"].getInt32());
+            EXPECT_EQ("item123", doc[123]["name"].getStringView());
+            EXPECT_EQ(77.25, doc[77]["price"].getDouble());
+
+            StringWriteStream os;
+            Writer writer(os);
+            doc.writeTo(writer);
+            EXPECT_EQ(sample, os.getStringView());
+            fclose(file);
+        }
+    }
+}
+
+// 截断一半的压缩数据：解析失败且good()为false
+template <typename WriteStream, typename ReadStream>
+void truncated() {
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    writeCompressed<WriteStream>(file, makeSample());
+    long size = ftell(file);
+    std::vector<char> bytes(static_cast<size_t>(size));
+    rewind(file);
+    ASSERT_EQ(bytes.size(), fread(bytes.data(), 1, bytes.size(), file));
+    fclose(file);
+
+    file = tmpfile();
+    fwrite(bytes.data(), 1, bytes.size() / 2, file);
+    rewind(file);
+    ReadStream is(file, true, 1024);
+    Document doc;
+    EXPECT_NE(ParseError::PARSE_OK, doc.parseStream(is));
+    EXPECT_FALSE(is.good());
+    fclose(file);
+}
+
+// 空文件不含完整的压缩数据，good()为false；压缩了空内容的流是完整的
+template <typename WriteStream, typename ReadStream>
+void emptyInput() {
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    {
+        ReadStream is(file);
+        EXPECT_FALSE(is.hasNext());
+        EXPECT_FALSE(is.good());
+    }
+    rewind(file);
+    {
+        WriteStream os(file);
+    }
+    rewind(file);
+    ReadStream is(file);
+    EXPECT_FALSE(is.hasNext());
+    EXPECT_TRUE(is.good());
+    fclose(file);
+}
+
+} // anonymous namespace
+
+TEST(compressed_stream, gzip_roundtrip) {
+    roundtrip<GzipWriteStream, GzipReadStream>();
+}
+
+TEST(compressed_stream, concatenated_members) {
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    {
+        GzipWriteStream os(file);
+        os.put("[1,");
+    }
+    {
+        GzipWriteStream os(file);
+        os.put("2]");
+    }
+    rewind(file);
+    GzipReadStream is(file);
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parseStream(is));
+    EXPECT_EQ(2, doc[1].getInt32());
+    fclose(file);
+}
+
+TEST(compressed_stream, truncated) {
+    truncated<GzipWriteStream, GzipReadStream>();
+}
+
+TEST(compressed_stream, empty_input) {
+    emptyInput<GzipWriteStream, GzipReadStream>();
+#ifdef MUDONG_JSON_HAS_ZSTD
+    emptyInput<ZstdWriteStream, ZstdReadStream>();
+#endif
+}
+
+#ifdef MUDONG_JSON_HAS_ZSTD
+TEST(compressed_stream, zstd_roundtrip) {
+    roundtrip<ZstdWriteStream, ZstdReadStream>();
+}
+
+TEST(compressed_stream, zstd_truncated) {
+    truncated<ZstdWriteStream, ZstdReadStream>();
+}
+#endif
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <PaddedReadStream.hpp>
+#include <MsgPackReader.hpp>
+#include <CborReader.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+using namespace mudong::json;
+
+namespace {
+
+// 只记录最大嵌套深度，不构建DOM
+struct DepthHandler {
+    bool Null()                    { return true; }
+    bool Bool(bool)                { return true; }
+    bool Int32(int32_t)            { return true; }
+    bool Int64(int64_t)            { return true; }
+    bool Double(double)            { return true; }
+    bool String(std::string_view)  { return true; }
+    bool Key(std::string_view)     { return true; }
+    bool StartObject()             { return enter(); }
+    bool EndObject()               { depth--; return true; }
+    bool StartArray()              { return enter(); }
+    bool EndArray()                { depth--; return true; }
+
+    bool enter() {
+        if (++depth > maxDepth) maxDepth = depth;
+        return true;
+    }
+
+    size_t depth = 0;
+    size_t maxDepth = 0;
+};
+
+// 数组与对象交替嵌套depth层
+std::string nested(size_t depth) {
+    std::string json;
+    for (size_t i = 0; i < depth; i++) json += i % 2 == 0 ? "[" : "{\"k\":";
+    json += "0";
+    for (size_t i = depth; i > 0; i--) json += (i - 1) % 2 == 0 ? "]" : "}";
+    return json;
+}
+
+ParseError parseNested(const std::string& json, size_t maxDepth, DepthHandler& handler) {
+    PaddedReadStream is(json);
+    return Reader::parse(is, handler, maxDepth);
+}
+
+} // anonymous namespace
+
+TEST(depth, limit) {
+    DepthHandler handler;
+    EXPECT_EQ(ParseError::PARSE_OK, parseNested(nested(64), 64, handler));
+    EXPECT_EQ(64u, handler.maxDepth);
+    DepthHandler handler2;
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, parseNested(nested(65), 64, handler2));
+    DepthHandler handler3;
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, parseNested("[[[]]]", 2, handler3));
+    DepthHandler handler4;
+    EXPECT_EQ(ParseError::PARSE_OK, parseNested("[[],{},[]]", 2, handler4));
+}
+
+TEST(depth, default_limit) {
+    Document doc1;
+    EXPECT_EQ(ParseError::PARSE_OK, doc1.parse(nested(kDefaultMaxDepth)));
+    Document doc2;
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, doc2.parse(nested(kDefaultMaxDepth + 1)));
+    // 恶意输入在超限时立即返回，不会耗尽调用栈
+    Document doc3;
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, doc3.parse(std::string(10000000, '[')));
+
+    Document doc4;
+    doc4.setMaxDepth(3);
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, doc4.parse("[[[[1]]]]"));
+}
+
+TEST(depth, million_levels) {
+    const size_t depth = 1000000;
+    std::string json = nested(depth);
+    DepthHandler handler;
+    EXPECT_EQ(ParseError::PARSE_OK, parseNested(json, depth, handler));
+    EXPECT_EQ(depth, handler.maxDepth);
+    EXPECT_EQ(0u, handler.depth);
+
+    // 错误在最深处时同样能正确报告
+    json[json.find('0')] = '!'; // 最内层的值
+    DepthHandler handler2;
+    EXPECT_NE(ParseError::PARSE_OK, parseNested(json, depth, handler2));
+}
+
+TEST(depth, errors_unchanged) {
+    EXPECT_EQ(ParseError::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, Document().parse("[1 2]"));
+    EXPECT_EQ(ParseError::PARSE_MISS_COMMA_OR_CURLY_BRACKET, Document().parse("{\"a\":1 \"b\":2}"));
+    EXPECT_EQ(ParseError::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, Document().parse("[[1}"));
+    EXPECT_EQ(ParseError::PARSE_MISS_COMMA_OR_CURLY_BRACKET, Document().parse("{\"a\":[1]]"));
+    EXPECT_EQ(ParseError::PARSE_MISS_KEY, Document().parse("{\"a\":1,}"));
+    EXPECT_EQ(ParseError::PARSE_MISS_COLON, Document().parse("{\"a\" 1}"));
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, Document().parse("[1,]"));
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, Document().parse("[[["));
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, Document().parse("[] []"));
+
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(" { \"a\" : [ 1 , { } , [ ] ] , \"b\" : { \"c\" : null } } "));
+    EXPECT_EQ(2u, doc.getSize());
+    EXPECT_EQ(3u, doc["a"].getSize());
+    EXPECT_TRUE(doc["b"]["c"].isNull());
+}
+
+TEST(depth, binary) {
+    // msgpack: fixarray(1)嵌套，最内层为nil
+    std::string msgpack(100, '\x91');
+    msgpack += '\xc0';
+    DepthHandler handler;
+    EXPECT_EQ(ParseError::PARSE_OK, MsgPackReader::parse(msgpack, handler, 100));
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, MsgPackReader::parse(msgpack, handler, 99));
+    std::string hostileMsgpack(10000000, '\x91');
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, MsgPackReader::parse(hostileMsgpack, handler));
+
+    // cbor: array(1)嵌套，最内层为null
+    std::string cbor(100, '\x81');
+    cbor += '\xf6';
+    EXPECT_EQ(ParseError::PARSE_OK, CborReader::parse(cbor, handler, 100));
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, CborReader::parse(cbor, handler, 99));
+    std::string hostileCbor(10000000, '\x9f'); // 不定长array
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, CborReader::parse(hostileCbor, handler));
+
+    // 连续的tag不计入深度
+    std::string tags(10000000, '\xc6');
+    tags += '\xf6';
+    EXPECT_EQ(ParseError::PARSE_OK, CborReader::parse(tags, handler));
+}
+
+TEST(depth, deep_dom) {
+    const size_t depth = 1000000;
+    std::string json = nested(depth);
+    auto* doc = new Document;
+    doc->setMaxDepth(depth);
+    ASSERT_EQ(ParseError::PARSE_OK, doc->parse(json));
+
+    // 序列化与估计大小均不递归
+    size_t estimate = doc->estimateSerializedSize();
+    StringWriteStream os;
+    Writer writer(os);
+    ASSERT_TRUE(doc->writeTo(writer));
+    EXPECT_EQ(json, os.getStringView());
+    EXPECT_GE(estimate, json.size());
+
+    // 共享子树：先释放外层，子树仍由copy持有
+    Value copy = (*doc)[0];
+    delete doc;
+    EXPECT_TRUE(copy.isObject());
+    EXPECT_EQ(1u, copy.getSize());
+}
+
+TEST(depth, deep_value) {
+    Value value(ValueType::TYPE_ARRAY);
+    for (size_t i = 0; i < 1000000; i++) {
+        Value outer(ValueType::TYPE_OBJECT);
+        outer.addMember(Value("k"), std::move(value));
+        value.setArray().addValue(std::move(outer));
+    }
+    EXPECT_EQ(1u, value.getSize());
+    value.setNull();
+    EXPECT_TRUE(value.isNull());
+}
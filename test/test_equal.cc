@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <unordered_set>
+
+#include <Document.hpp>
+
+using namespace mudong::json;
+
+namespace {
+
+Value parse(const char* json, bool rawNumbers = false) {
+    Document doc;
+    doc.setRawNumbers(rawNumbers);
+    EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json)) << json;
+    return Value(std::move(doc));
+}
+
+} // anonymous namespace
+
+TEST(equal, scalars) {
+    EXPECT_EQ(Value(), Value());
+    EXPECT_EQ(Value(true), Value(true));
+    EXPECT_NE(Value(true), Value(false));
+    EXPECT_EQ(Value("abc"), Value("abc"));
+    EXPECT_NE(Value("abc"), Value("abd"));
+    EXPECT_NE(Value(), Value(false));
+    EXPECT_NE(Value("1"), Value(1));
+    EXPECT_EQ(Value::raw("[1, 2]"), Value::raw("[1, 2]"));
+    EXPECT_NE(Value::raw("[1, 2]"), Value::raw("[1,2]"));
+}
+
+TEST(equal, numbers) {
+    EXPECT_EQ(Value(1), Value(int64_t(1)));
+    EXPECT_EQ(Value(1), Value(1.0));
+    EXPECT_EQ(Value(int64_t(1) << 40), Value(std::ldexp(1.0, 40)));
+    EXPECT_NE(Value(1), Value(1.5));
+    EXPECT_NE(Value(INT64_MAX), Value(9223372036854775807.0)); // 2^63超出int64
+    EXPECT_EQ(Value(0.0), Value(-0.0));
+    EXPECT_EQ(Value(std::nan("")), Value(std::nan("")));
+
+    // 保留原文的数字按数值比较
+    EXPECT_EQ(Value::rawNumber("1.0"), Value(1));
+    EXPECT_EQ(Value::rawNumber("1e2"), Value::rawNumber("100"));
+    EXPECT_EQ(parse("[1,2.5,-3]", true), parse("[1.0,2.5,-3]"));
+}
+
+TEST(equal, big_integers) {
+    // 超出int64的整数原文按精确值比较，不因转换为double而相等
+    Value max = Value::rawNumber("18446744073709551615");
+    EXPECT_NE(max, Value::rawNumber("18446744073709551614"));
+    EXPECT_NE(max.hash(), Value::rawNumber("18446744073709551614").hash());
+    EXPECT_EQ(max, Value::rawNumber("18446744073709551615"));
+    EXPECT_NE(Value::rawNumber("-9223372036854775809"), Value::rawNumber("-9223372036854775810"));
+    EXPECT_NE(Value::rawNumber("-18446744073709551615"), max);
+
+    Value doc = parse("[18446744073709551615,18446744073709551614]", true);
+    EXPECT_NE(doc[0], doc[1]);
+    EXPECT_NE(doc[0].hash(), doc[1].hash());
+
+    // 恰好可表示为double的整数与该double相等，hash也相同；小数与指数形式按double比较
+    Value pow64 = Value::rawNumber("18446744073709551616");
+    EXPECT_EQ(pow64, Value(18446744073709551616.0));
+    EXPECT_EQ(pow64.hash(), Value(18446744073709551616.0).hash());
+    EXPECT_NE(max, Value(18446744073709551616.0));
+    EXPECT_EQ(Value::rawNumber("1.8446744073709551616e19"), pow64);
+    EXPECT_EQ(Value::rawNumber("1.8446744073709551616e19").hash(), pow64.hash());
+    EXPECT_NE(max, Value(INT64_MAX));
+}
+
+TEST(equal, containers) {
+    EXPECT_EQ(parse("{\"a\":[1,{\"b\":null}],\"c\":\"x\"}"), parse("{\"a\":[1,{\"b\":null}],\"c\":\"x\"}"));
+    EXPECT_NE(parse("[1,2]"), parse("[2,1]"));
+    EXPECT_NE(parse("[1,2]"), parse("[1,2,3]"));
+    EXPECT_NE(parse("[]"), parse("{}"));
+    EXPECT_NE(parse("{\"a\":1}"), parse("{\"b\":1}"));
+    EXPECT_NE(parse("{\"a\":{\"b\":1}}"), parse("{\"a\":{\"b\":2}}"));
+}
+
+TEST(equal, member_order) {
+    Value a = parse("{\"a\":1,\"b\":{\"x\":1,\"y\":2},\"c\":[1,2]}");
+    Value b = parse("{\"c\":[1,2],\"b\":{\"y\":2,\"x\":1},\"a\":1}");
+    EXPECT_NE(a, b);
+    EXPECT_TRUE(a.equals(b, true));
+    EXPECT_FALSE(a.equals(parse("{\"c\":[2,1],\"b\":{\"y\":2,\"x\":1},\"a\":1}"), true));
+    EXPECT_FALSE(a.equals(parse("{\"c\":[1,2],\"b\":{\"y\":2,\"z\":1},\"a\":1}"), true));
+
+    // 超过线性查找阈值的大对象
+    Value big(ValueType::TYPE_OBJECT), reversed(ValueType::TYPE_OBJECT);
+    for (int i = 0; i < 100; i++) big.addMember(Value("k" + std::to_string(i)), Value(i));
+    for (int i = 99; i >= 0; i--) reversed.addMember(Value("k" + std::to_string(i)), Value(i));
+    EXPECT_TRUE(big.equals(reversed, true));
+    reversed["k50"].setInt32(-1);
+    EXPECT_FALSE(big.equals(reversed, true));
+}
+
+TEST(equal, shared) {
+    Value a = parse("{\"a\":[1,2,3]}");
+    Value b = a; // 共享存储
+    EXPECT_EQ(a, b);
+    Value c(ValueType::TYPE_ARRAY);
+    c.addValue(a);
+    c.addValue(b);
+    EXPECT_EQ(c[0], c[1]);
+}
+
+TEST(hash, consistent) {
+    EXPECT_EQ(Value(1).hash(), Value(1.0).hash());
+    EXPECT_EQ(Value(1).hash(), Value::rawNumber("1").hash());
+    EXPECT_EQ(Value(std::nan("")).hash(), Value(-std::nan("")).hash());
+    EXPECT_NE(Value(1).hash(), Value(2).hash());
+    EXPECT_NE(Value("1").hash(), Value(1).hash());
+    EXPECT_NE(parse("[]").hash(), parse("{}").hash());
+    EXPECT_NE(parse("[1,2]").hash(), parse("[2,1]").hash());
+    EXPECT_NE(parse("[[1],2]").hash(), parse("[1,[2]]").hash());
+    EXPECT_NE(parse("{\"a\":1,\"b\":2}").hash(), parse("{\"a\":2,\"b\":1}").hash());
+
+    // 成员顺序不影响hash
+    Value a = parse("{\"a\":1,\"b\":{\"x\":[1,2],\"y\":null}}");
+    Value b = parse("{\"b\":{\"y\":null,\"x\":[1,2]},\"a\":1}");
+    EXPECT_EQ(a.hash(), b.hash());
+
+    // 与平台无关的固定值
+    EXPECT_EQ(Value("abc").hash(), Value("abc").hash());
+    EXPECT_EQ(parse("[true,null]").hash(), parse(" [ true , null ] ").hash());
+}
+
+TEST(hash, stable) {
+    // hash可持久化或跨机器比较，固定文档的结果不得随平台或版本变化；
+    // 字符串覆盖整8字节与不足8字节的尾部
+    EXPECT_EQ(0x690956c7f3026ea0ULL, Value("abc").hash());
+    EXPECT_EQ(0xc9a4d1ed9bee1421ULL,
+              parse("{\"name\":\"mudong-json structural hash\",\"id\":42,\"ratio\":0.25,"
+                    "\"tags\":[\"a\",\"bc\",true,null],\"nested\":{\"big\":-9007199254740993}}").hash());
+}
+
+TEST(hash, deep) {
+    std::string json;
+    for (int i = 0; i < 10000; i++) json += "[";
+    for (int i = 0; i < 10000; i++) json += "]";
+    Document doc;
+    doc.setMaxDepth(20000);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    EXPECT_EQ(doc.hash(), doc.cacheHash());
+    EXPECT_TRUE(doc.equals(Value(doc)));
+}
+
+TEST(hash, cache) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"meta\":{\"id\":1},\"items\":[{\"n\":2},{\"n\":4}]}"));
+    uint64_t h = doc.hash();
+    EXPECT_FALSE(doc.hasHashCache());
+
+    EXPECT_EQ(h, doc.cacheHash());
+    const Value& root = doc;
+    EXPECT_TRUE(root.hasHashCache());
+    EXPECT_TRUE(root["items"][1].hasHashCache());
+    EXPECT_EQ(h, doc.hash());
+    EXPECT_EQ(h, doc.cachedHash());
+
+    // 修改使路径上的缓存失效
+    doc["items"][1]["n"].setInt32(5);
+    EXPECT_FALSE(root.hasHashCache());
+    EXPECT_FALSE(root["items"].hasHashCache());
+    EXPECT_TRUE(root["items"][0].hasHashCache());
+    EXPECT_TRUE(root["meta"].hasHashCache());
+    uint64_t changed = doc.cachedHash();
+    EXPECT_NE(h, changed);
+    EXPECT_EQ(changed, doc.cacheHash());
+    EXPECT_EQ(changed, parse("{\"meta\":{\"id\":1},\"items\":[{\"n\":2},{\"n\":5}]}").hash());
+
+    // 序列化缓存与hash缓存互不影响
+    doc.cacheSerialization(0);
+    doc.dropSerializationCache();
+    EXPECT_TRUE(root.hasHashCache());
+    EXPECT_FALSE(root.hasSerializationCache());
+}
+
+TEST(hash, cache_ignored_by_equals) {
+    Value a = parse("[{\"x\":1},{\"x\":2}]");
+    Value b = parse("[{\"x\":1},{\"x\":3}]");
+    a.cacheHash();
+    b.cacheHash();
+    EXPECT_NE(a, b);
+    EXPECT_EQ(a, parse("[{\"x\":1},{\"x\":2.0}]"));
+
+    // 经由事先保存的引用修改，上层的hash缓存已过期，比较仍按内容进行
+    Value& x = a[1]["x"];
+    a.cacheHash();
+    x.setInt32(3);
+    EXPECT_TRUE(a.hasHashCache());
+    EXPECT_EQ(a, b);
+}
+
+TEST(hash, cache_ignored_by_hash) {
+    // hash()与operator==一致，不受过期的缓存影响；cachedHash()须经cacheHash()重新同步
+    Value a = parse("{\"x\":{\"y\":[1,2]}}");
+    Value b = parse("{\"x\":{\"y\":[1,3]}}");
+    Value& y = a["x"]["y"];
+    uint64_t before = a.cacheHash();
+    y[1] = Value(3);
+    EXPECT_TRUE(a.hasHashCache());
+    EXPECT_TRUE(a.equals(b));
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_EQ(before, a.cachedHash());
+    EXPECT_EQ(b.hash(), a.cacheHash());
+    EXPECT_EQ(b.hash(), a.cachedHash());
+
+    std::unordered_set<Value> set;
+    set.insert(b);
+    EXPECT_EQ(1u, set.count(a));
+}
+
+TEST(hash, unordered_set) {
+    std::unordered_set<Value> set;
+    set.insert(parse("{\"a\":1}"));
+    set.insert(parse("{\"a\":1.0}"));
+    set.insert(parse("[1,2]"));
+    set.insert(Value("s"));
+    EXPECT_EQ(3u, set.size());
+    EXPECT_EQ(1u, set.count(Value(parse("[1.0,2]"))));
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "alloc_counter.hpp"
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+std::string records(int count) {
+    std::string json = "[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"n" + std::to_string(i) + "\",\"price\":" +
+                std::to_string(i * 2) + "}";
+    }
+    return json + "]";
+}
+
+} // anonymous namespace
+
+TEST(shared_keys, share_nodes) {
+    std::string json = records(100);
+    Document doc;
+    doc.setSharedKeys(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    const Value& root = doc;
+    auto& first = root[0].getObject();
+    auto& last = root[99].getObject();
+    for (size_t i = 0; i < first.size(); i++)
+        EXPECT_EQ(first[i].key.getStringView().data(), last[i].key.getStringView().data());
+    EXPECT_EQ(json, stringify(doc));
+
+    // 关闭时各自分配
+    Document plain;
+    ASSERT_EQ(ParseError::PARSE_OK, plain.parse(json));
+    EXPECT_NE(plain[0].getObject()[0].key.getStringView().data(),
+              plain[1].getObject()[0].key.getStringView().data());
+    EXPECT_EQ(plain, doc);
+}
+
+TEST(shared_keys, fewer_allocations) {
+    std::string json = records(1000);
+    Document doc;
+    doc.setSharedKeys(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+
+    size_t shared, plain;
+    {
+        alloc_counter::Scope scope;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json)); // 共享表在两次parse()之间保留
+        shared = scope.allocations();
+    }
+    Document other;
+    ASSERT_EQ(ParseError::PARSE_OK, other.parse(json));
+    {
+        alloc_counter::Scope scope;
+        ASSERT_EQ(ParseError::PARSE_OK, other.parse(json));
+        plain = scope.allocations();
+    }
+    // 每条记录少分配3个key
+    EXPECT_LE(shared + 3000, plain);
+}
+
+TEST(shared_keys, limits) {
+    std::string longKey(detail::KeyTable::kMaxKeyLength + 1, 'k');
+    detail::KeyTable table;
+    Value a = table.intern("a");
+    EXPECT_EQ(a.getStringView().data(), table.intern("a").getStringView().data());
+    EXPECT_NE(table.intern(longKey).getStringView().data(), table.intern(longKey).getStringView().data());
+    for (size_t i = 0; i < detail::KeyTable::kMaxKeys + 10; i++) table.intern("k" + std::to_string(i));
+    EXPECT_EQ(detail::KeyTable::kMaxKeys, table.size());
+    EXPECT_EQ("k5000", table.intern("k5000").getStringView());
+    EXPECT_EQ(a.getStringView().data(), table.intern("a").getStringView().data());
+}
+
+TEST(key_handle, lookup) {
+    Document doc;
+    doc.setSharedKeys(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(records(50)));
+    const Value& root = doc;
+
+    KeyHandle price("price"), missing("missing");
+    EXPECT_EQ("price", price.name());
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(i * 2, root[static_cast<size_t>(i)][price].getInt32());
+        EXPECT_EQ(root[static_cast<size_t>(i)].cendMember(), root[static_cast<size_t>(i)].findMember(missing));
+    }
+}
+
+TEST(key_handle, different_shapes) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK,
+              doc.parse("[{\"a\":1,\"b\":2},{\"b\":3,\"a\":4},{\"c\":5},{\"x\":0,\"y\":0,\"b\":6},{}]"));
+    const Value& root = doc;
+    KeyHandle b("b");
+    EXPECT_EQ(2, root[0][b].getInt32());
+    EXPECT_EQ(3, root[1][b].getInt32());
+    EXPECT_EQ(root[2].cendMember(), root[2].findMember(b));
+    EXPECT_EQ(6, root[3][b].getInt32());
+    EXPECT_EQ(root[4].cendMember(), root[4].findMember(b));
+    EXPECT_EQ(2, root[0][b].getInt32());
+}
+
+TEST(key_handle, modified_object) {
+    Value obj(ValueType::TYPE_OBJECT);
+    obj.addMember("a", 1);
+    obj.addMember("b", 2);
+    KeyHandle b("b");
+    EXPECT_EQ(2, obj[b].getInt32());
+
+    // 修改经由句柄访问的值，容器的缓存失效
+    obj.cacheSerialization(0);
+    obj[b].setInt32(3);
+    EXPECT_FALSE(obj.hasSerializationCache());
+    EXPECT_EQ("{\"a\":1,\"b\":3}", stringify(obj));
+
+    // 成员位置变化后重新查找
+    Value other(ValueType::TYPE_OBJECT);
+    other.addMember("b", 7);
+    EXPECT_EQ(7, other[b].getInt32());
+    EXPECT_EQ(3, obj[b].getInt32());
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+// 记录收到的回调，跨多次parseNext()保留
+struct TraceHandler {
+    std::string trace;
+
+    bool Null()                     { trace += "n"; return true; }
+    bool Bool(bool b)               { trace += b ? "t" : "f"; return true; }
+    bool Int32(int32_t i32)         { trace += std::to_string(i32); return true; }
+    bool Int64(int64_t i64)         { trace += std::to_string(i64); return true; }
+    bool Double(double d)           { trace += std::to_string(d); return true; }
+    bool String(std::string_view s) { trace += "'" + std::string(s) + "'"; return true; }
+    bool Key(std::string_view s)    { trace += std::string(s) + ":"; return true; }
+    bool StartObject()              { trace += "{"; return true; }
+    bool EndObject()                { trace += "}"; return true; }
+    bool StartArray()               { trace += "["; return true; }
+    bool EndArray()                 { trace += "]"; return true; }
+};
+
+} // anonymous namespace
+
+TEST(parse_next, reader) {
+    std::string json = "{\"a\":1}{\"b\":[2]} 3\n\"s\"\t[]  ";
+    StringReadStream is(json);
+    TraceHandler handler;
+
+    size_t offsets[] = {7, 16, 18, 22, 25};
+    for (size_t offset: offsets) {
+        ASSERT_TRUE(Reader::hasNextValue(is));
+        ASSERT_EQ(ParseError::PARSE_OK, Reader::parseNext(is, handler));
+        EXPECT_EQ(offset, is.tell());
+    }
+    EXPECT_FALSE(Reader::hasNextValue(is));
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, Reader::parseNext(is, handler));
+
+    // 同一个Handler接收了所有值
+    EXPECT_EQ("{a:1}{b:[2]}3's'[]", handler.trace);
+
+    // parse()仍要求单个值
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, doc.parse(json));
+}
+
+TEST(parse_next, writer) {
+    // 逐个解析并写到同一个Writer，输出NDJSON
+    std::string json = "{\"a\":1}{\"b\":[2, 3]}\n  4 \"s\"[]";
+    StringReadStream is(json);
+    StringWriteStream os;
+    Writer writer(os);
+    writer.setRootSeparator("\n");
+    while (Reader::hasNextValue(is))
+        ASSERT_EQ(ParseError::PARSE_OK, Reader::parseNext(is, writer));
+    EXPECT_EQ("{\"a\":1}\n{\"b\":[2,3]}\n4\n\"s\"\n[]", os.getStringView());
+}
+
+TEST(parse_next, writer_without_separator) {
+    // 未设置分隔符时第二个根值被拒绝，不会输出"12"这样无法解析的内容
+    StringWriteStream os;
+    Writer writer(os);
+    EXPECT_TRUE(writer.Int32(1));
+    EXPECT_FALSE(writer.Int32(2));
+    EXPECT_FALSE(writer.StartArray());
+    EXPECT_FALSE(Value::raw("{}").writeTo(writer));
+    EXPECT_EQ("1", os.getStringView());
+
+    std::string json = "1 2";
+    StringReadStream is(json);
+    StringWriteStream out;
+    Writer single(out);
+    EXPECT_EQ(ParseError::PARSE_OK, Reader::parseNext(is, single));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, Reader::parseNext(is, single));
+    EXPECT_EQ("1", out.getStringView());
+}
+
+TEST(parse_next, document) {
+    std::string json = "  [1,2] {\"k\":true}";
+    StringReadStream is(json);
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parseNext(is));
+    EXPECT_EQ("[1,2]", stringify(doc));
+    EXPECT_EQ(7u, is.tell());
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parseNext(is));
+    EXPECT_EQ("{\"k\":true}", stringify(doc));
+    EXPECT_FALSE(Reader::hasNextValue(is));
+}
+
+TEST(document_stream, iterate) {
+    DocumentStream stream("{\"id\":1}\n{\"id\":2}{\"id\":3}\r\n\n[4] 5 ");
+    std::vector<std::string> docs;
+    std::vector<size_t> offsets;
+    for (Document& doc: stream) {
+        docs.push_back(stringify(doc));
+        offsets.push_back(stream.offset());
+    }
+    EXPECT_EQ((std::vector<std::string>{"{\"id\":1}", "{\"id\":2}", "{\"id\":3}", "[4]", "5"}), docs);
+    EXPECT_EQ((std::vector<size_t>{0, 9, 17, 28, 32}), offsets);
+    EXPECT_EQ(ParseError::PARSE_OK, stream.error());
+    EXPECT_EQ(5u, stream.count());
+
+    DocumentStream empty("  \n ");
+    EXPECT_TRUE(empty.begin() == empty.end());
+    EXPECT_EQ(ParseError::PARSE_OK, empty.error());
+}
+
+TEST(document_stream, error) {
+    DocumentStream stream("{\"a\":1} {\"a\":} {\"a\":3}");
+    size_t count = 0;
+    for (auto iter = stream.begin(); iter != stream.end(); ++iter) {
+        EXPECT_EQ(1, (*iter)["a"].getInt32());
+        count++;
+    }
+    EXPECT_EQ(1u, count);
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, stream.error());
+    EXPECT_EQ(8u, stream.offset());
+    EXPECT_FALSE(stream.next());
+}
+
+TEST(document_stream, options_and_keep) {
+    DocumentStream stream("{\"k\":[1,2,3,4]} {\"k\":[5,6,7,8]}");
+    stream.document().setPackedArrays(true);
+    stream.document().setSharedKeys(true);
+    std::vector<Value> kept;
+    for (Document& doc: stream) {
+        EXPECT_TRUE(static_cast<const Value&>(doc)["k"].isPacked());
+        kept.emplace_back(std::move(doc));
+    }
+    ASSERT_EQ(2u, kept.size());
+    EXPECT_EQ("{\"k\":[1,2,3,4]}", stringify(kept[0]));
+    EXPECT_EQ("{\"k\":[5,6,7,8]}", stringify(kept[1]));
+}
@@ -0,0 +1,253 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <Document.hpp>
+#include <MsgPackReader.hpp>
+#include <Patch.hpp>
+#include <Snapshot.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+Value parse(const std::string& json, bool packed) {
+    Document doc;
+    doc.setPackedArrays(packed);
+    EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json)) << json;
+    return Value(std::move(doc));
+}
+
+} // anonymous namespace
+
+TEST(packed, parse) {
+    Value ints = parse("[1,-2,3,12345678901]", true);
+    ASSERT_TRUE(ints.isPackedInt64());
+    EXPECT_TRUE(ints.isArray());
+    EXPECT_EQ(ValueType::TYPE_ARRAY, ints.getType());
+    EXPECT_EQ(4u, ints.getSize());
+    auto view = ints.getInt64s();
+    EXPECT_EQ(-2, view[1]);
+    EXPECT_EQ(12345678901LL, view[3]);
+    EXPECT_EQ("[1,-2,3,12345678901]", stringify(ints));
+
+    Value doubles = parse("[0.5,1.5,2.5,-1e300]", true);
+    ASSERT_TRUE(doubles.isPackedDouble());
+    double sum = 0;
+    for (double d: doubles.getDoubles()) sum += d;
+    EXPECT_EQ(0.5 + 1.5 + 2.5 - 1e300, sum);
+    EXPECT_EQ(stringify(parse("[0.5,1.5,2.5,-1e300]", false)), stringify(doubles));
+}
+
+TEST(packed, fallback) {
+    // 混合类型、非数字元素与过短的数组按普通数组存放
+    const char* cases[] = {
+        "[1,2,3,4.5]", "[1.5,2,3,4]", "[1,2,null,4]", "[1,2,3,[4]]", "[[1,2,3,4],5]",
+        "[1,2,3]", "[]", "{\"a\":[1,2,3,\"x\"]}",
+    };
+    for (const char* json: cases) {
+        Value value = parse(json, true);
+        EXPECT_EQ(json, stringify(value));
+        EXPECT_EQ(parse(json, false), value) << json;
+    }
+    Value nested = parse("{\"a\":[[1,2,3,4],[0.5,1,2,3],[1.5,2.5,3.5,4.5,5.5]],\"b\":[1,2,3]}", true);
+    const Value& a = nested["a"];
+    EXPECT_FALSE(a.isPacked());
+    EXPECT_TRUE(a[0].isPackedInt64());
+    EXPECT_FALSE(a[1].isPacked());
+    EXPECT_TRUE(a[2].isPackedDouble());
+    EXPECT_FALSE(nested["b"].isPacked());
+    EXPECT_EQ("{\"a\":[[1,2,3,4],[0.5,1,2,3],[1.5,2.5,3.5,4.5,5.5]],\"b\":[1,2,3]}", stringify(nested));
+
+    // 保留原文的数字不紧凑存储
+    Document doc;
+    doc.setPackedArrays(true);
+    doc.setRawNumbers(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[1,2,3,4]"));
+    EXPECT_FALSE(doc.isPacked());
+    EXPECT_EQ("[1,2,3,4]", stringify(doc));
+}
+
+TEST(packed, exact_reserve) {
+    Document doc;
+    doc.setPackedArrays(true);
+    doc.setExactReserve(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[[1,2,3,4,5],[1,\"a\",3,4,5,6],{\"x\":[7,8,9,10]}]"));
+    const Value& root = doc;
+    EXPECT_TRUE(root[0].isPacked());
+    EXPECT_EQ(6u, root[1].getArray().capacity());
+    EXPECT_TRUE(root[2]["x"].isPacked());
+    EXPECT_EQ("[[1,2,3,4,5],[1,\"a\",3,4,5,6],{\"x\":[7,8,9,10]}]", stringify(doc));
+}
+
+TEST(packed, equal_and_hash) {
+    Value packed = parse("[1,2,3,4]", true);
+    Value plain = parse("[1,2,3,4]", false);
+    Value doubles = parse("[1.0,2.0,3.0,4.0]", true);
+    EXPECT_EQ(packed, plain);
+    EXPECT_EQ(plain, packed);
+    EXPECT_EQ(packed, doubles);
+    EXPECT_EQ(plain.hash(), packed.hash());
+    EXPECT_EQ(plain.hash(), doubles.hash());
+    EXPECT_NE(packed, parse("[1,2,3,5]", true));
+    EXPECT_NE(packed, parse("[1,2,3,4,5]", true));
+    EXPECT_NE(packed, parse("[1,2,3,\"4\"]", false));
+
+    Value outer = parse("{\"a\":[1,2,3,4]}", true);
+    EXPECT_EQ(parse("{\"a\":[1,2,3,4]}", false).hash(), outer.cacheHash());
+}
+
+TEST(packed, build_and_unpack) {
+    int64_t ints[] = {1, 2, INT64_MAX};
+    Value value = Value::packed(ints, 3);
+    EXPECT_EQ("[1,2,9223372036854775807]", stringify(value));
+
+    Value copy = value;
+    copy.unpack();
+    EXPECT_FALSE(copy.isPacked());
+    EXPECT_TRUE(copy.getArray()[0].isInt32());
+    EXPECT_TRUE(copy.getArray()[2].isInt64());
+    EXPECT_TRUE(value.isPacked());
+    EXPECT_EQ(value, copy);
+
+    // 修改时自动转为普通数组
+    value[0].setString("x");
+    EXPECT_FALSE(value.isPacked());
+    value.addValue(Value(true));
+    EXPECT_EQ("[\"x\",2,9223372036854775807,true]", stringify(value));
+
+    double doubles[] = {0.5};
+    EXPECT_EQ("[0.5]", stringify(Value::packed(doubles, 1)));
+    EXPECT_EQ("[]", stringify(Value::packed(doubles, 0)));
+}
+
+TEST(packed, const_access) {
+    // get()与getElements()按值给出元素，不转换存储
+    const Value packed = parse("[1,2,9223372036854775807,4]", true);
+    ASSERT_TRUE(packed.isPacked());
+    ASSERT_TRUE(packed.isArray());
+    EXPECT_TRUE(packed.get(0).isInt32());
+    EXPECT_EQ(INT64_MAX, packed.get(2).getInt64());
+
+    auto elements = packed.getElements();
+    EXPECT_EQ(4u, elements.size());
+    EXPECT_EQ(4, elements.back().getInt32());
+    uint64_t sum = 0;
+    for (auto& e: packed.getElements()) sum += static_cast<uint64_t>(e.getInt64());
+    EXPECT_EQ(static_cast<uint64_t>(INT64_MAX) + 7, sum);
+
+    const Value doubles = parse("[0.5,1.5,2.5,3.5]", true);
+    ASSERT_TRUE(doubles.isPacked());
+    double total = 0;
+    auto view = doubles.getElements();
+    for (auto it = view.begin(); it != view.end(); ++it) total += it->getDouble();
+    EXPECT_EQ(8.0, total);
+
+    // const的getArray()与operator[](size_t)引用节点上保留的普通数组形式，存储仍为紧凑形式
+    const std::vector<Value>& array = packed.getArray();
+    ASSERT_EQ(4u, array.size());
+    EXPECT_EQ(&array, &packed.getArray());
+    EXPECT_EQ(&array[2], &packed[2]);
+    EXPECT_EQ(INT64_MAX, packed[2].getInt64());
+    EXPECT_EQ(0.5, doubles.getArray().at(0).getDouble());
+    EXPECT_TRUE(packed.isPacked());
+
+    // 共享节点的拷贝引用同一份元素，与unpack()的结果相同
+    Value copy = packed;
+    EXPECT_EQ(&array, &static_cast<const Value&>(copy).getArray());
+    copy.unpack();
+    const Value& plain = copy;
+    ASSERT_EQ(plain.getSize(), packed.getSize());
+    for (size_t i = 0; i < plain.getSize(); i++) EXPECT_EQ(plain[i], packed[i]);
+    EXPECT_EQ(&plain[1], &*std::next(plain.getElements().begin(), 1));
+}
+
+TEST(packed, const_access_threads) {
+    // 多个线程并发的const访问得到同一份元素
+    const Value packed = parse("[1,2,3,4,5,6,7,8]", true);
+    const std::vector<Value>* seen[4] = {};
+    std::vector<std::thread> threads;
+    for (auto& p: seen) threads.emplace_back([&packed, &p]() { p = &packed.getArray(); });
+    for (auto& t: threads) t.join();
+    for (auto* p: seen) EXPECT_EQ(&packed.getArray(), p);
+    EXPECT_EQ(8, packed[7].getInt32());
+}
+
+TEST(packed, snapshot) {
+    Value value = parse("{\"i\":[1,2,3,12345678901],\"d\":[0.5,1.5,2.5,3.5]}", true);
+    StringWriteStream os;
+    SnapshotWriter::write(value, os);
+    std::string buffer = os.take();
+    Snapshot snapshot(buffer.data(), buffer.size());
+    ASSERT_TRUE(snapshot.valid());
+    SnapshotValue root = snapshot.root();
+    EXPECT_EQ(4u, root["i"].getSize());
+    EXPECT_EQ(2, root["i"][1].getInt32());
+    EXPECT_EQ(12345678901LL, root["i"][3].getInt64());
+    EXPECT_EQ(3.5, root["d"][3].getDouble());
+}
+
+TEST(packed, patch) {
+    Value doc = parse("{\"a\":[1,2,3,4],\"b\":[1,2,3,4]}", true);
+    EXPECT_EQ(nullptr, Patch::find(doc, "/a/0"));
+    ASSERT_NE(nullptr, Patch::find(doc, "/a"));
+
+    Value ops = parse("[{\"op\":\"test\",\"path\":\"/a/1\",\"value\":2},"
+                      "{\"op\":\"replace\",\"path\":\"/a/0\",\"value\":\"x\"},"
+                      "{\"op\":\"copy\",\"from\":\"/b/3\",\"path\":\"/c\"}]", false);
+    ASSERT_EQ(PatchError::PATCH_OK, Patch::apply(doc, ops));
+    EXPECT_TRUE(parse("{\"a\":[\"x\",2,3,4],\"b\":[1,2,3,4],\"c\":4}", false).equals(doc, true));
+
+    Value from = parse("[[1,2,3,4],[5,6,7,8]]", true);
+    Value to = parse("[[1,2,3,4],[5,6,7,9]]", true);
+    Value diff = Patch::diff(from, to);
+    EXPECT_EQ(1u, diff.getSize());
+    ASSERT_EQ(PatchError::PATCH_OK, Patch::apply(from, diff));
+    EXPECT_EQ(to, from);
+
+    EXPECT_EQ(PatchError::PATCH_BAD_OPERATION, Patch::apply(doc, parse("[1,2,3,4]", true)));
+
+    // test与copy只读取紧凑数组的元素，与文档共享存储的副本保持不变
+    Value packed = parse("{\"a\":[1,2,3,4]}", true);
+    Value snap = packed;
+    ASSERT_EQ(PatchError::PATCH_OK, Patch::apply(packed, parse("[{\"op\":\"test\",\"path\":\"/a/1\",\"value\":2},"
+                                                              "{\"op\":\"copy\",\"from\":\"/a/3\",\"path\":\"/b\"}]", false)));
+    EXPECT_TRUE(static_cast<const Value&>(snap)["a"].isPacked());
+    EXPECT_TRUE(static_cast<const Value&>(packed)["a"].isPacked());
+    EXPECT_EQ("{\"a\":[1,2,3,4]}", stringify(snap));
+    EXPECT_EQ("{\"a\":[1,2,3,4],\"b\":4}", stringify(packed));
+    EXPECT_EQ(PatchError::PATCH_TEST_FAILED,
+              Patch::apply(packed, parse("[{\"op\":\"test\",\"path\":\"/a/1\",\"value\":3}]", false)));
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND,
+              Patch::apply(packed, parse("[{\"op\":\"test\",\"path\":\"/a/1/0\",\"value\":3}]", false)));
+}
+
+TEST(packed, clear_after_failed_parse) {
+    // 数组解析到一半失败，暂存的数字与打开的层级不能带入clear()之后的解析
+    Document doc;
+    doc.setPackedArrays(true);
+    EXPECT_NE(ParseError::PARSE_OK, MsgPackReader::parse(std::string_view("\x94\x01\x02", 3), doc));
+    doc.clear();
+    ASSERT_EQ(ParseError::PARSE_OK, MsgPackReader::parse(std::string_view("\x81\xa1" "a\x01", 4), doc));
+    EXPECT_EQ("{\"a\":1}", stringify(doc));
+
+    doc.clear();
+    doc.StartArray();
+    doc.Int32(1);
+    doc.Int32(2);
+    doc.clear();
+    doc.StartArray();
+    for (int i = 0; i < 4; i++) doc.Int32(i);
+    doc.EndArray();
+    EXPECT_TRUE(doc.isPacked());
+    EXPECT_EQ("[0,1,2,3]", stringify(doc));
+
+    // 解析失败后直接再次parse()同样不受影响
+    EXPECT_NE(ParseError::PARSE_OK, doc.parse("[[1,2,3"));
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"b\":[5,6]}"));
+    EXPECT_EQ("{\"b\":[5,6]}", stringify(doc));
+}
@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <Patch.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+Value parse(const char* json) {
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json)) << json;
+    return Value(std::move(doc));
+}
+
+// 执行patch并与期望的结果比较(忽略成员顺序)，expected为nullptr时期望失败且target不变
+void expectPatch(const char* target, const char* patch, const char* expected) {
+    Value value = parse(target);
+    PatchError err = Patch::apply(value, parse(patch));
+    if (expected == nullptr) {
+        EXPECT_NE(PatchError::PATCH_OK, err) << patch;
+        EXPECT_EQ(parse(target), value) << patch;
+    }
+    else {
+        EXPECT_EQ(PatchError::PATCH_OK, err) << patch << ": " << patchErrorStr(err);
+        EXPECT_TRUE(parse(expected).equals(value, true)) << patch << " => " << stringify(value);
+    }
+}
+
+} // anonymous namespace
+
+TEST(pointer, find) {
+    Value doc = parse("{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"m~n\":8,\" \":7}");
+    EXPECT_EQ(&doc, Patch::find(doc, ""));
+    EXPECT_EQ(Value("baz"), *Patch::find(doc, "/foo/1"));
+    EXPECT_EQ(Value(0), *Patch::find(doc, "/"));
+    EXPECT_EQ(Value(1), *Patch::find(doc, "/a~1b"));
+    EXPECT_EQ(Value(8), *Patch::find(doc, "/m~0n"));
+    EXPECT_EQ(Value(7), *Patch::find(doc, "/ "));
+    EXPECT_EQ(nullptr, Patch::find(doc, "/foo/2"));
+    EXPECT_EQ(nullptr, Patch::find(doc, "/foo/01"));
+    EXPECT_EQ(nullptr, Patch::find(doc, "/foo/-"));
+    EXPECT_EQ(nullptr, Patch::find(doc, "foo"));
+    EXPECT_EQ(nullptr, Patch::find(doc, "/m~2n"));
+}
+
+// RFC 6902附录A中的示例
+TEST(patch, rfc6902) {
+    expectPatch("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]",
+                "{\"baz\":\"qux\",\"foo\":\"bar\"}");
+    expectPatch("{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]",
+                "{\"foo\":[\"bar\",\"qux\",\"baz\"]}");
+    expectPatch("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]",
+                "{\"foo\":\"bar\"}");
+    expectPatch("{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]",
+                "{\"foo\":[\"bar\",\"baz\"]}");
+    expectPatch("{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]",
+                "{\"baz\":\"boo\",\"foo\":\"bar\"}");
+    expectPatch("{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+                "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+                "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}");
+    expectPatch("{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+                "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+                "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}");
+    expectPatch("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+                "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},"
+                "{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]",
+                "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}");
+    expectPatch("{\"baz\":\"qux\"}", "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]", nullptr);
+    expectPatch("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]",
+                "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}");
+    expectPatch("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\",\"xyz\":123}]",
+                "{\"foo\":\"bar\",\"baz\":\"qux\"}");
+    expectPatch("{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]", nullptr);
+    expectPatch("{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]", "{\"/\":9,\"~1\":10}");
+    expectPatch("{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":\"10\"}]", nullptr);
+    expectPatch("{\"foo\":[\"bar\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]",
+                "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}");
+}
+
+TEST(patch, operations) {
+    // 根的替换
+    expectPatch("{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "[1]");
+    expectPatch("{\"a\":1}", "[{\"op\":\"add\",\"path\":\"\",\"value\":2}]", "2");
+    // copy的目标与源共享存储，之后修改其中一处不影响另一处
+    expectPatch("{\"a\":{\"x\":1}}",
+                "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/b\"},"
+                "{\"op\":\"add\",\"path\":\"/b/y\",\"value\":2}]",
+                "{\"a\":{\"x\":1},\"b\":{\"x\":1,\"y\":2}}");
+    // 复制到自身的子节点
+    expectPatch("{\"a\":{\"x\":1}}", "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/a/self\"}]",
+                "{\"a\":{\"x\":1,\"self\":{\"x\":1}}}");
+    expectPatch("{\"a\":[1,2]}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a\"}]", "{\"a\":[1,2]}");
+    // test的对象比较与成员顺序无关
+    expectPatch("{\"a\":{\"x\":1,\"y\":2}}", "[{\"op\":\"test\",\"path\":\"/a\",\"value\":{\"y\":2,\"x\":1.0}}]",
+                "{\"a\":{\"x\":1,\"y\":2}}");
+}
+
+TEST(patch, errors) {
+    Value doc = parse("{\"a\":{\"b\":[1,2]}}");
+    EXPECT_EQ(PatchError::PATCH_NOT_ARRAY, Patch::apply(doc, parse("{}")));
+    EXPECT_EQ(PatchError::PATCH_BAD_OPERATION, Patch::apply(doc, parse("[{\"op\":\"nop\",\"path\":\"\"}]")));
+    EXPECT_EQ(PatchError::PATCH_BAD_OPERATION, Patch::apply(doc, parse("[{\"op\":\"add\",\"path\":\"/c\"}]")));
+    EXPECT_EQ(PatchError::PATCH_BAD_OPERATION, Patch::apply(doc, parse("[{\"path\":\"/c\"}]")));
+    EXPECT_EQ(PatchError::PATCH_BAD_POINTER, Patch::apply(doc, parse("[{\"op\":\"remove\",\"path\":\"a\"}]")));
+    EXPECT_EQ(PatchError::PATCH_BAD_POINTER, Patch::apply(doc, parse("[{\"op\":\"remove\",\"path\":\"\"}]")));
+    EXPECT_EQ(PatchError::PATCH_BAD_POINTER,
+              Patch::apply(doc, parse("[{\"op\":\"add\",\"path\":\"/a/b/01\",\"value\":0}]")));
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND, Patch::apply(doc, parse("[{\"op\":\"remove\",\"path\":\"/a/c\"}]")));
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND,
+              Patch::apply(doc, parse("[{\"op\":\"remove\",\"path\":\"/a/b/2\"}]")));
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND,
+              Patch::apply(doc, parse("[{\"op\":\"add\",\"path\":\"/a/b/3\",\"value\":0}]")));
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND,
+              Patch::apply(doc, parse("[{\"op\":\"replace\",\"path\":\"/a/x\",\"value\":0}]")));
+    EXPECT_EQ(PatchError::PATCH_MOVE_INTO_CHILD,
+              Patch::apply(doc, parse("[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b/0\"}]")));
+    EXPECT_EQ(parse("{\"a\":{\"b\":[1,2]}}"), doc);
+    EXPECT_STREQ("test failed", patchErrorStr(PatchError::PATCH_TEST_FAILED));
+}
+
+TEST(patch, atomic) {
+    const char* ops = "[{\"op\":\"add\",\"path\":\"/a/b/-\",\"value\":3},"
+                      "{\"op\":\"remove\",\"path\":\"/missing\"}]";
+    Value doc = parse("{\"a\":{\"b\":[1,2]},\"c\":true}");
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND, Patch::apply(doc, parse(ops)));
+    EXPECT_EQ(parse("{\"a\":{\"b\":[1,2]},\"c\":true}"), doc);
+
+    // 撤销后成员与元素的顺序不变
+    const char* original = "{\"x\":1,\"a\":{\"b\":[1,2]},\"c\":true}";
+    Value value = parse(original);
+    EXPECT_EQ(PatchError::PATCH_TEST_FAILED,
+              Patch::apply(value, parse("[{\"op\":\"remove\",\"path\":\"/x\"},"
+                                        "{\"op\":\"move\",\"from\":\"/a/b/0\",\"path\":\"/a/b/-\"},"
+                                        "{\"op\":\"add\",\"path\":\"/c\",\"value\":false},"
+                                        "{\"op\":\"replace\",\"path\":\"\",\"value\":[]},"
+                                        "{\"op\":\"test\",\"path\":\"\",\"value\":{}}]")));
+    EXPECT_EQ(original, stringify(value));
+
+    // 非原子的执行保留失败前的修改
+    EXPECT_EQ(PatchError::PATCH_PATH_NOT_FOUND, Patch::apply(doc, parse(ops), false));
+    EXPECT_EQ(parse("{\"a\":{\"b\":[1,2,3]},\"c\":true}"), doc);
+}
+
+TEST(patch, structural_sharing) {
+    Value before = parse("{\"users\":[{\"name\":\"a\",\"tags\":[1,2]},{\"name\":\"b\",\"tags\":[3]}],"
+                         "\"meta\":{\"version\":1}}");
+    Value after = before;
+    ASSERT_EQ(PatchError::PATCH_OK,
+              Patch::apply(after, parse("[{\"op\":\"replace\",\"path\":\"/users/1/name\",\"value\":\"c\"}]"), false));
+
+    const Value& x = before;
+    const Value& y = after;
+    // 原值不变，只有路径上的容器被复制
+    EXPECT_EQ("{\"users\":[{\"name\":\"a\",\"tags\":[1,2]},{\"name\":\"b\",\"tags\":[3]}],\"meta\":{\"version\":1}}",
+              stringify(before));
+    EXPECT_EQ("c", y["users"][1]["name"].getStringView());
+    EXPECT_NE(&x.getObject(), &y.getObject());
+    EXPECT_NE(&x["users"].getArray(), &y["users"].getArray());
+    EXPECT_NE(&x["users"][1].getObject(), &y["users"][1].getObject());
+    EXPECT_EQ(&x["meta"].getObject(), &y["meta"].getObject());
+    EXPECT_EQ(&x["users"][0].getObject(), &y["users"][0].getObject());
+    EXPECT_EQ(&x["users"][1]["tags"].getArray(), &y["users"][1]["tags"].getArray());
+
+    // 独占的容器原地修改
+    const void* root = &y.getObject();
+    ASSERT_EQ(PatchError::PATCH_OK,
+              Patch::apply(after, parse("[{\"op\":\"add\",\"path\":\"/meta/x\",\"value\":0}]"), false));
+    EXPECT_EQ(root, &y.getObject());
+    EXPECT_NE(&x["meta"].getObject(), &y["meta"].getObject());
+    EXPECT_FALSE(x["meta"].getObject().size() == y["meta"].getObject().size());
+}
+
+TEST(patch, invalidates_cache) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"a\":{\"b\":[1,2]},\"c\":{\"d\":1}}"));
+    doc.cacheSerialization(0);
+    ASSERT_EQ(PatchError::PATCH_OK, Patch::apply(doc, parse("[{\"op\":\"replace\",\"path\":\"/a/b/0\",\"value\":5}]")));
+    const Value& root = doc;
+    EXPECT_FALSE(root.hasSerializationCache());
+    EXPECT_FALSE(root["a"]["b"].hasSerializationCache());
+    EXPECT_TRUE(root["c"].hasSerializationCache());
+    EXPECT_EQ("{\"a\":{\"b\":[5,2]},\"c\":{\"d\":1}}", stringify(doc));
+}
+
+// RFC 7396附录A中的示例
+TEST(merge_patch, rfc7396) {
+    const char* cases[][3] = {
+            {"{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+            {"{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"},
+            {"{\"a\":\"b\"}", "{\"a\":null}", "{}"},
+            {"{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"},
+            {"{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+            {"{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"},
+            {"{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"},
+            {"{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"},
+            {"[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]"},
+            {"{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]"},
+            {"{\"a\":\"foo\"}", "null", "null"},
+            {"{\"a\":\"foo\"}", "\"bar\"", "\"bar\""},
+            {"{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"},
+            {"[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}"},
+            {"{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"},
+    };
+    for (auto& c: cases) {
+        Value target = parse(c[0]);
+        Patch::merge(target, parse(c[1]));
+        EXPECT_EQ(parse(c[2]), target) << c[0] << " + " << c[1] << " => " << stringify(target);
+    }
+}
+
+TEST(merge_patch, sharing) {
+    Value before = parse("{\"a\":{\"x\":1},\"b\":{\"y\":[1,2]}}");
+    Value after = before;
+    Patch::merge(after, parse("{\"a\":{\"x\":2}}"));
+    const Value& x = before;
+    const Value& y = after;
+    EXPECT_EQ(parse("{\"a\":{\"x\":1},\"b\":{\"y\":[1,2]}}"), before);
+    EXPECT_EQ(parse("{\"a\":{\"x\":2},\"b\":{\"y\":[1,2]}}"), after);
+    EXPECT_EQ(&x["b"].getObject(), &y["b"].getObject());
+}
+
+TEST(diff, roundtrip) {
+    const char* pairs[][2] = {
+            {"{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":true}}", "{\"a\":1,\"b\":[1,5],\"c\":{\"d\":true,\"e\":null}}"},
+            {"{\"a\":1,\"b\":2}", "{\"c\":3,\"b\":2}"},
+            {"[1,[2,[3]]]", "[1,[2,[4]],5,6]"},
+            {"{\"a/b\":{\"~\":1}}", "{\"a/b\":{\"~\":2}}"},
+            {"[1,2]", "{\"0\":1}"},
+            {"1", "\"x\""},
+            {"{\"x\":[{\"k\":1},{\"k\":2}]}", "{\"x\":[{\"k\":1}]}"},
+    };
+    for (auto& p: pairs) {
+        Value from = parse(p[0]);
+        Value to = parse(p[1]);
+        Value ops = Patch::diff(from, to);
+        Value patched = from;
+        ASSERT_EQ(PatchError::PATCH_OK, Patch::apply(patched, ops)) << stringify(ops);
+        EXPECT_TRUE(to.equals(patched, true)) << stringify(ops) << " => " << stringify(patched);
+        EXPECT_EQ(parse(p[0]), from);
+    }
+
+    EXPECT_EQ(parse("[{\"op\":\"replace\",\"path\":\"/b/1\",\"value\":5},"
+                    "{\"op\":\"remove\",\"path\":\"/b/2\"}]").getSize(),
+              Patch::diff(parse("{\"a\":1,\"b\":[1,2,3]}"), parse("{\"a\":1.0,\"b\":[1,5]}")).getSize());
+    EXPECT_EQ(0u, Patch::diff(parse("{\"a\":1,\"b\":2}"), parse("{\"b\":2,\"a\":1}")).getSize());
+}
+
+TEST(diff, big_integers) {
+    // 超出int64的ID只差最后一位，转换为double后相同，仍须生成replace
+    auto parseRaw = [](const char* json) {
+        Document doc;
+        doc.setRawNumbers(true);
+        EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json)) << json;
+        return Value(std::move(doc));
+    };
+    Value from = parseRaw("{\"id\":18446744073709551615}");
+    Value to = parseRaw("{\"id\":18446744073709551614}");
+    EXPECT_EQ("[{\"op\":\"replace\",\"path\":\"/id\",\"value\":18446744073709551614}]",
+              stringify(Patch::diff(from, to)));
+    EXPECT_EQ(0u, Patch::diff(from, parseRaw("{\"id\":18446744073709551615}")).getSize());
+}
+
+TEST(diff, shared_subtrees) {
+    Value from = parse("{\"big\":[1,2,3,4,5,6,7,8],\"small\":{\"v\":1}}");
+    Value to = from;
+    ASSERT_EQ(PatchError::PATCH_OK,
+              Patch::apply(to, parse("[{\"op\":\"replace\",\"path\":\"/small/v\",\"value\":2}]")));
+    Value ops = Patch::diff(from, to);
+    EXPECT_EQ("[{\"op\":\"replace\",\"path\":\"/small/v\",\"value\":2}]", stringify(ops));
+    EXPECT_EQ(0u, Patch::diff(from, from).getSize());
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <Document.hpp>
+
+using namespace mudong::json;
+
+TEST(document_reuse, reparse) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"a\":[1,2,3]}"));
+    Value kept = doc["a"];
+
+    // 再次解析前自动清空，已取出的Value不受影响
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[true,\"x\"]"));
+    EXPECT_TRUE(doc.isArray());
+    EXPECT_EQ(2u, doc.getSize());
+    EXPECT_EQ(3u, kept.getSize());
+
+    // 解析失败后同样可以复用
+    EXPECT_NE(ParseError::PARSE_OK, doc.parse("{\"a\":[1,"));
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("null"));
+    EXPECT_TRUE(doc.isNull());
+
+    doc.clear();
+    EXPECT_TRUE(doc.isNull());
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("{\"b\":{}}"));
+    EXPECT_TRUE(doc["b"].isObject());
+}
+
+TEST(document_reuse, document_pool) {
+    DocumentPool pool(2);
+    Document* first;
+    {
+        auto doc = pool.acquire();
+        first = doc.get();
+        ASSERT_EQ(ParseError::PARSE_OK, doc->parse("[1,2]"));
+    }
+    EXPECT_EQ(1u, pool.available());
+    {
+        auto doc = pool.acquire();
+        EXPECT_EQ(first, doc.get());
+        EXPECT_TRUE(doc->isNull()); // 归还时已清空
+        auto doc2 = pool.acquire();
+        auto doc3 = pool.acquire();
+        EXPECT_EQ(0u, pool.available());
+    }
+    EXPECT_EQ(2u, pool.available()); // 超出上限的直接释放
+}
+
+TEST(document_reuse, node_pool) {
+    auto& pool = NodePool::local();
+    pool.setLimits(100, 1 << 20);
+    {
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[\"abcdefghijklmnopqrstuvwxyz\",{\"k\":[1]}]"));
+    }
+    EXPECT_EQ(5u, pool.nodes()); // 2个数组、1个对象、2个字符串
+    EXPECT_GT(pool.bytes(), 0u);
+
+    uint64_t hits = pool.hits();
+    {
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[\"0123456789\",{\"k\":[2]}]"));
+        EXPECT_EQ(hits + 5, pool.hits());
+        // 复用的节点内容正确
+        EXPECT_EQ("0123456789", doc[0].getStringView());
+        EXPECT_EQ(2, doc[1]["k"][0].getInt32());
+        EXPECT_EQ(1u, doc[1].getSize());
+    }
+
+    // 超出上限的节点直接释放
+    pool.setLimits(2, 1 << 20);
+    EXPECT_EQ(2u, pool.nodes());
+    {
+        Value array(ValueType::TYPE_ARRAY);
+        for (int i = 0; i < 10; i++) array.addValue(Value("string"));
+    }
+    EXPECT_EQ(2u, pool.nodes());
+
+    pool.setLimits(100, 64);
+    EXPECT_LE(pool.bytes(), 64u);
+
+    pool.setLimits(0, 0);
+    EXPECT_EQ(0u, pool.nodes());
+    EXPECT_EQ(0u, pool.bytes());
+}
+
+// 各线程的缓存相互独立，在其他线程释放的节点进入该线程的缓存
+TEST(document_reuse, node_pool_threads) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[[1],[2],[3]]"));
+    std::thread([&doc]() {
+        NodePool::local().setLimits(100, 1 << 20);
+        doc.clear();
+        EXPECT_EQ(4u, NodePool::local().nodes());
+    }).join();
+    EXPECT_EQ(0u, NodePool::local().nodes());
+}
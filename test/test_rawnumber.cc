@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <MsgPackWriter.hpp>
+#include <Writer.hpp>
+
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+std::string roundtrip(std::string_view json) {
+    Document doc;
+    doc.setRawNumbers(true);
+    EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    return stringify(doc);
+}
+
+} // anonymous namespace
+
+TEST(raw_number, preserve_text) {
+    // 原文原样输出，不经过double往返
+    EXPECT_EQ("[1.50,1E+2,-0,0.1000000000000000055511151231257827]",
+              roundtrip("[1.50, 1E+2, -0, 0.1000000000000000055511151231257827]"));
+    // 超出int64与double范围的数字不再报错
+    EXPECT_EQ("{\"id\":123456789012345678901234567890,\"big\":1e400}",
+              roundtrip("{\"id\":123456789012345678901234567890,\"big\":1e400}"));
+    EXPECT_EQ("42", roundtrip("42"));
+
+    // 非法数字照常报错
+    Document doc;
+    doc.setRawNumbers(true);
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, doc.parse("[01]"));
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, doc.parse("[1.]"));
+}
+
+TEST(raw_number, lazy_conversion) {
+    Document doc;
+    doc.setRawNumbers(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[7, -2147483649, 2.5, 1e2, 18446744073709551616, 5i64, NaN]"));
+
+    EXPECT_TRUE(doc[0].isRawNumber());
+    EXPECT_EQ("7", doc[0].getRawNumber());
+    EXPECT_EQ(ValueType::TYPE_INT32, doc[0].getType());
+    EXPECT_EQ(7, doc[0].getInt32());
+    EXPECT_EQ(7, doc[0].getInt64());
+
+    EXPECT_EQ(ValueType::TYPE_INT64, doc[1].getType());
+    EXPECT_FALSE(doc[1].isInt32());
+    EXPECT_EQ(-2147483649LL, doc[1].getInt64());
+
+    EXPECT_TRUE(doc[2].isDouble());
+    EXPECT_EQ(2.5, doc[2].getDouble());
+    EXPECT_EQ(100.0, doc[3].getDouble());
+
+    // 超出int64的整数按double读取
+    EXPECT_EQ(ValueType::TYPE_DOUBLE, doc[4].getType());
+    EXPECT_EQ(18446744073709551616.0, doc[4].getDouble());
+
+    // 带后缀的数字与NaN照常转换
+    EXPECT_FALSE(doc[5].isRawNumber());
+    EXPECT_EQ(ValueType::TYPE_INT64, doc[5].getType());
+    EXPECT_FALSE(doc[6].isRawNumber());
+}
+
+TEST(raw_number, value_api) {
+    Value v = Value::rawNumber("3.14159265358979323846");
+    EXPECT_TRUE(v.isDouble());
+    EXPECT_EQ("3.14159265358979323846", stringify(v));
+
+    Value copy = v;
+    EXPECT_EQ("3.14159265358979323846", copy.getRawNumber());
+    v.setInt32(1);
+    EXPECT_EQ("3.14159265358979323846", copy.getRawNumber());
+
+    copy.setRawNumber("-12");
+    EXPECT_EQ(-12, copy.getInt32());
+
+    Value obj(ValueType::TYPE_OBJECT);
+    obj.addMember(Value("n"), Value::rawNumber("1.0"));
+    EXPECT_EQ("{\"n\":1.0}", stringify(obj));
+}
+
+TEST(raw_number, default_off) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[1.50]"));
+    EXPECT_FALSE(doc[0].isRawNumber());
+    EXPECT_EQ("[1.5]", stringify(doc));
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, doc.parse("[1e400]"));
+}
+
+TEST(raw_number, other_handlers) {
+    // 不接受原文的Handler收到转换后的值
+    Document doc;
+    doc.setRawNumbers(true);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[1,4294967296,0.5]"));
+
+    StringWriteStream os;
+    MsgPackWriter writer(os);
+    doc.writeTo(writer);
+
+    Document plain;
+    ASSERT_EQ(ParseError::PARSE_OK, plain.parse("[1,4294967296,0.5]"));
+    StringWriteStream expected;
+    MsgPackWriter expectedWriter(expected);
+    plain.writeTo(expectedWriter);
+    EXPECT_EQ(expected.getStringView(), os.getStringView());
+
+    EXPECT_EQ(doc.estimateSerializedSize(), std::string("[1,4294967296,0.5]").size());
+}
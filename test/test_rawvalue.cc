@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <MsgPackWriter.hpp>
+#include <Snapshot.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+TEST(raw_value, envelope) {
+    std::string cached = "{\"items\":[1,2,3],\"next\":null}";
+
+    Value envelope(ValueType::TYPE_OBJECT);
+    envelope.addMember(Value("status"), Value("ok"));
+    envelope.addMember(Value("data"), Value::raw(cached));
+    envelope.addMember(Value("extra"), Value::raw("[true, \"x\"]"));
+
+    EXPECT_TRUE(envelope["data"].isRaw());
+    EXPECT_EQ(ValueType::TYPE_RAW, envelope["data"].getType());
+    EXPECT_EQ(cached, envelope["data"].getRaw());
+    // 片段原样输出，其中的空白也保留
+    EXPECT_EQ("{\"status\":\"ok\",\"data\":" + cached + ",\"extra\":[true, \"x\"]}", stringify(envelope));
+
+    Value array(ValueType::TYPE_ARRAY);
+    array.addValue(Value::raw("1"));
+    array.addValue(Value::raw("{}"));
+    array.addValue(Value(2));
+    EXPECT_EQ("[1,{},2]", stringify(array));
+}
+
+TEST(raw_value, writer) {
+    StringWriteStream os;
+    Writer writer(os);
+    writer.StartObject();
+    writer.Key("a");
+    writer.RawValue("[1,2]");
+    writer.Key("b");
+    writer.RawValue("\"s\"");
+    writer.EndObject();
+    EXPECT_EQ("{\"a\":[1,2],\"b\":\"s\"}", os.getStringView());
+}
+
+TEST(raw_value, validate) {
+    EXPECT_EQ(ParseError::PARSE_OK, Reader::validate("{\"a\":[1,2.5,1e300]}"));
+    // 数字规则与Document::parse()相同
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, Reader::validate("[1e999]"));
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, Reader::validate("[9223372036854775808]"));
+    EXPECT_EQ(ParseError::PARSE_OK, Reader::validate(" null "));
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, Reader::validate(""));
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, Reader::validate("1 2"));
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, Reader::validate("[[[1]]]", 2));
+    EXPECT_NE(ParseError::PARSE_OK, Reader::validate("{\"a\":}"));
+}
+
+TEST(raw_value, checked_raw) {
+    ParseError err = ParseError::PARSE_USER_STOPPED;
+    Value ok = Value::raw("[1, {\"a\":null}]", err);
+    EXPECT_EQ(ParseError::PARSE_OK, err);
+    EXPECT_TRUE(ok.isRaw());
+    EXPECT_EQ("[1, {\"a\":null}]", ok.getRaw());
+
+    Value bad = Value::raw("[1e999]", err);
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, err);
+    EXPECT_TRUE(bad.isNull());
+    EXPECT_TRUE(Value::raw("{\"a\":", err).isNull());
+    EXPECT_NE(ParseError::PARSE_OK, err);
+    EXPECT_TRUE(Value::raw("[[1]]", err, 1).isNull());
+    EXPECT_EQ(ParseError::PARSE_DEPTH_EXCEEDED, err);
+
+    // 经过校验的片段可写入任何Handler
+    Value envelope(ValueType::TYPE_OBJECT);
+    envelope.addMember(Value("data"), Value::raw("[1.5,-2]", err));
+    ASSERT_EQ(ParseError::PARSE_OK, err);
+    Document doc;
+    EXPECT_TRUE(envelope.writeTo(doc));
+    EXPECT_EQ("{\"data\":[1.5,-2]}", stringify(doc));
+}
+
+TEST(raw_value, other_handlers) {
+    // 不接受RawValue()的Handler收到片段解析后的值，与直接写入解析结果相同
+    Value value(ValueType::TYPE_ARRAY);
+    value.addValue(Value::raw("{\"k\":[1,\"v\"]}"));
+    value.addValue(Value(true));
+
+    StringWriteStream os;
+    MsgPackWriter writer(os);
+    value.writeTo(writer);
+
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse("[{\"k\":[1,\"v\"]},true]"));
+    StringWriteStream expected;
+    MsgPackWriter expectedWriter(expected);
+    doc.writeTo(expectedWriter);
+    EXPECT_EQ(expected.getStringView(), os.getStringView());
+
+    // 片段写回Document等同于解析
+    Document copy;
+    value.writeTo(copy);
+    EXPECT_EQ("[{\"k\":[1,\"v\"]},true]", stringify(static_cast<const Value&>(copy)));
+}
+
+TEST(raw_value, copy_and_snapshot) {
+    Value raw = Value::raw("[1,2,3]");
+    Value copy = raw;
+    raw.setNull();
+    EXPECT_EQ("[1,2,3]", copy.getRaw());
+    copy.setRaw("{}");
+    EXPECT_EQ("{}", stringify(copy));
+    EXPECT_EQ(2u, copy.estimateSerializedSize());
+
+    Value obj(ValueType::TYPE_OBJECT);
+    obj.addMember(Value("r"), Value::raw("{\"x\":1}"));
+    StringWriteStream os;
+    SnapshotWriter::write(obj, os);
+    std::string data(os.getStringView());
+    Snapshot snapshot(data.data(), data.size());
+    ASSERT_TRUE(snapshot.valid());
+    EXPECT_TRUE(snapshot.root()["r"].isRaw());
+    EXPECT_EQ("{\"x\":1}", snapshot.root()["r"].getRaw());
+    EXPECT_EQ("{\"r\":{\"x\":1}}", stringify(snapshot.root()));
+}
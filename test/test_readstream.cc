@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+
+#include <Document.hpp>
+#include <PaddedReadStream.hpp>
+
+using namespace mudong::json;
+
+// 非连续的自定义ReadStream，不提供getConstIter()
+class DequeReadStream {
+public:
+    explicit DequeReadStream(std::string_view json): chars_(json.begin(), json.end()) { }
+
+    bool hasNext   () const { return !chars_.empty(); }
+    char peek      () const { return hasNext() ? chars_.front() : '\0'; }
+    char next      ()       {
+        if (!hasNext()) return '\0';
+        char ch = chars_.front();
+        chars_.pop_front();
+        return ch;
+    }
+    void assertNext(char c) { assert(peek() == c); next(); }
+
+private:
+    std::deque<char> chars_;
+};
+
+static_assert(IsContiguousReadStream<PaddedReadStream>::value);
+static_assert(IsContiguousReadStream<StringReadStream>::value);
+static_assert(!IsContiguousReadStream<DequeReadStream>::value);
+
+const char* kSample = "{\"a\":[1,-2.5e3,123456789012,true,null],\"s\":\"x\\u00e9y\",\"i\":7i64}";
+
+TEST(read_stream, custom_stream) {
+    DequeReadStream is(kSample);
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parseStream(is));
+    EXPECT_EQ(-2500.0, doc["a"][1].getDouble());
+    EXPECT_EQ(123456789012, doc["a"][2].getInt64());
+    EXPECT_EQ("x\xc3\xa9y", doc["s"].getStringView());
+    EXPECT_EQ(7, doc["i"].getInt64());
+
+    // 超出局部缓冲区长度的数字
+    std::string longNumber = "0." + std::string(100, '1');
+    DequeReadStream is2(longNumber);
+    Document doc2;
+    ASSERT_EQ(ParseError::PARSE_OK, doc2.parseStream(is2));
+    EXPECT_DOUBLE_EQ(0.1111111111111111, doc2.getDouble());
+}
+
+TEST(read_stream, padded) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(std::string(kSample)));
+    EXPECT_EQ(1, doc["a"][0].getInt32());
+
+    PaddedReadStream copied(std::string_view(kSample, 5)); // {"a":
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, Document().parseStream(copied));
+
+    // 临时字符串由流持有，流的生命周期内始终有效
+    PaddedReadStream owned(std::string(kSample) + "   ");
+    Document fromTemp;
+    ASSERT_EQ(ParseError::PARSE_OK, fromTemp.parseStream(owned));
+    EXPECT_EQ(7, fromTemp["i"].getInt64());
+
+    EXPECT_EQ(ParseError::PARSE_MISS_QUOTATION_MARK, Document().parse("\"abc"));
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, Document().parse("[1,tru"));
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, Document().parse("12i"));
+    EXPECT_EQ(ParseError::PARSE_EXPECT_VALUE, Document().parse(""));
+}
+
+TEST(read_stream, embedded_nul) {
+    using namespace std::string_literals;
+    EXPECT_EQ(ParseError::PARSE_BAD_STRING_CHAR, Document().parse("\"a\0b\""s));
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, Document().parse("1\0"s));
+    EXPECT_EQ(ParseError::PARSE_BAD_VALUE, Document().parse("[\0]"s));
+    EXPECT_EQ(ParseError::PARSE_ROOT_NOT_SINGULAR, Document().parse(std::string_view("1\0", 2)));
+}
+
+TEST(read_stream, unterminated_view) {
+    // 数字后紧跟的字符不属于string_view，不能被读取
+    const char buf[] = "12345";
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(std::string_view(buf, 2)));
+    EXPECT_EQ(12, doc.getInt32());
+    Document doc2;
+    ASSERT_EQ(ParseError::PARSE_OK, doc2.parse(std::string_view("1.5e3", 3)));
+    EXPECT_EQ(1.5, doc2.getDouble());
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include <Document.hpp>
+#include <Reclaimer.hpp>
+
+using namespace mudong::json;
+
+namespace {
+
+std::string makeArray(size_t count) {
+    std::string json = "[";
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\",\"tags\":[1,2,3]}";
+    }
+    json += "]";
+    return json;
+}
+
+} // anonymous namespace
+
+TEST(reclaimer, retire) {
+    Reclaimer reclaimer;
+    std::string json = makeArray(1000);
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    Value value = doc;
+
+    reclaimer.retire(std::move(doc), json.size());
+    EXPECT_TRUE(doc.isNull());
+    reclaimer.drain();
+    EXPECT_EQ(0u, reclaimer.pending());
+    EXPECT_EQ(0u, reclaimer.pendingBytes());
+    EXPECT_EQ(1u, reclaimer.reclaimed());
+    EXPECT_EQ(json.size(), reclaimer.reclaimedBytes());
+
+    // 仍被其他Value引用的部分不会被释放
+    EXPECT_EQ(1000u, value.getSize());
+    EXPECT_EQ(999, value[999]["id"].getInt32());
+
+    reclaimer.retire(std::move(value), json.size());
+    EXPECT_TRUE(value.isNull());
+    reclaimer.drain();
+    EXPECT_EQ(2u, reclaimer.reclaimed());
+    EXPECT_EQ(2 * json.size(), reclaimer.reclaimedBytes());
+}
+
+TEST(reclaimer, try_retire) {
+    Reclaimer reclaimer(100, 4);
+    // 空队列总能接收，即使超过字节数上限
+    Value big(ValueType::TYPE_ARRAY);
+    EXPECT_TRUE(reclaimer.tryRetire(std::move(big), 1000));
+    EXPECT_TRUE(big.isNull());
+
+    // 队列满时不阻塞，value保持不变。后台线程可能随时清空队列，反复尝试直到被拒绝
+    size_t accepted = 1;
+    for (int i = 0; i < 10000; i++) {
+        Value v(ValueType::TYPE_ARRAY);
+        if (!reclaimer.tryRetire(std::move(v), 60)) {
+            EXPECT_TRUE(v.isArray());
+            break;
+        }
+        EXPECT_TRUE(v.isNull());
+        accepted++;
+    }
+    reclaimer.drain();
+    EXPECT_EQ(0u, reclaimer.pendingBytes());
+    EXPECT_EQ(accepted, reclaimer.reclaimed());
+}
+
+TEST(reclaimer, backpressure) {
+    const size_t maxBytes = 10000, maxPending = 8;
+    Reclaimer reclaimer(maxBytes, maxPending);
+    std::string json = makeArray(50);
+
+    std::atomic<bool> done = false;
+    std::atomic<bool> exceeded = false;
+    std::thread monitor([&]() {
+        while (!done) {
+            if (reclaimer.pendingBytes() > maxBytes || reclaimer.pending() > maxPending) exceeded = true;
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++) {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < 200; i++) {
+                Document doc;
+                ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+                reclaimer.retire(std::move(doc), json.size());
+            }
+        });
+    }
+    for (auto& t: producers) t.join();
+    reclaimer.drain();
+    done = true;
+    monitor.join();
+
+    EXPECT_FALSE(exceeded);
+    EXPECT_EQ(800u, reclaimer.reclaimed());
+    EXPECT_EQ(800u * json.size(), reclaimer.reclaimedBytes());
+    EXPECT_EQ(0u, reclaimer.pending());
+}
+
+TEST(reclaimer, destructor_drains) {
+    Value kept;
+    {
+        Reclaimer reclaimer;
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(makeArray(100)));
+        kept = doc[0];
+        for (int i = 0; i < 10; i++) reclaimer.retire(Value(doc), 1);
+        reclaimer.retire(std::move(doc), 1);
+    }
+    EXPECT_EQ(0, kept["id"].getInt32());
+}
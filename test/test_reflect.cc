@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <Reflect.hpp>
+
+using namespace mudong::json;
+
+struct Item {
+    std::string name;
+    int64_t     id = 0;
+    double      price = 0;
+};
+
+struct Order {
+    int32_t                  version = 0;
+    bool                     paid = false;
+    std::optional<std::string> note;
+    std::vector<Item>        items;
+    std::vector<int>         codes;
+    std::optional<Item>      gift;
+    uint8_t                  flags = 0;
+};
+
+MUDONG_JSON_REFLECT(Item, name, id, price)
+MUDONG_JSON_REFLECT(Order, version, paid, note, items, codes, gift, flags)
+
+TEST(reflect, parse) {
+    Order order;
+    ParseError err = parseStruct(
+        "{\"version\":3,\"paid\":true,\"note\":\"fast\","
+        "\"items\":[{\"name\":\"pen\",\"id\":12345678901,\"price\":1.5},{\"name\":\"ink\",\"id\":2,\"price\":3}],"
+        "\"unknown\":{\"deep\":[1,{\"x\":[]}]},\"codes\":[1,2,3],\"gift\":null,\"flags\":255}", order);
+    ASSERT_EQ(ParseError::PARSE_OK, err);
+
+    EXPECT_EQ(3, order.version);
+    EXPECT_TRUE(order.paid);
+    ASSERT_TRUE(order.note.has_value());
+    EXPECT_EQ("fast", *order.note);
+    ASSERT_EQ(2u, order.items.size());
+    EXPECT_EQ("pen", order.items[0].name);
+    EXPECT_EQ(12345678901LL, order.items[0].id);
+    EXPECT_EQ(1.5, order.items[0].price);
+    EXPECT_EQ(3.0, order.items[1].price); // integer into double
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), order.codes);
+    EXPECT_FALSE(order.gift.has_value());
+    EXPECT_EQ(255, order.flags);
+}
+
+TEST(reflect, optional_struct) {
+    Order order;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("{\"gift\":{\"name\":\"card\"}}", order));
+    ASSERT_TRUE(order.gift.has_value());
+    EXPECT_EQ("card", order.gift->name);
+    EXPECT_TRUE(order.items.empty());
+}
+
+TEST(reflect, type_mismatch) {
+    Order order;
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("{\"version\":\"3\"}", order));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("{\"flags\":256}", order));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("{\"items\":{}}", order));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("[]", order));
+    EXPECT_EQ(ParseError::PARSE_MISS_COLON, parseStruct("{\"version\" 3}", order));
+}
+
+struct Keys {
+    int a = 0;
+    int b = 0;
+    int ab = 0;
+    int ba = 0;
+    int abc = 0;
+};
+
+MUDONG_JSON_REFLECT(Keys, a, b, ab, ba, abc)
+
+TEST(reflect, key_lookup) {
+    // 字段按名字长度分桶，同一长度的多个字段、无对应长度或更长的key均须正确处理
+    Keys keys;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct(
+            "{\"abc\":5,\"ba\":4,\"b\":2,\"\":0,\"c\":9,\"abd\":9,\"abcd\":9,\"ab\":3,\"a\":1}", keys));
+    EXPECT_EQ(1, keys.a);
+    EXPECT_EQ(2, keys.b);
+    EXPECT_EQ(3, keys.ab);
+    EXPECT_EQ(4, keys.ba);
+    EXPECT_EQ(5, keys.abc);
+}
+
+TEST(reflect, vector_root) {
+    std::vector<Item> items;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("[{\"id\":1},{\"id\":2}]", items));
+    ASSERT_EQ(2u, items.size());
+    EXPECT_EQ(2, items[1].id);
+}
+
+TEST(reflect, serialize) {
+    Order order;
+    order.version = 3;
+    order.paid = true;
+    order.items.push_back(Item{"pen \"blue\"", 12345678901LL, 1.5});
+    order.items.push_back(Item{"ink", 2, 3});
+    order.codes = {1, -2};
+    order.flags = 7;
+    std::string json = serializeStruct(order);
+    EXPECT_EQ("{\"version\":3,\"paid\":true,\"note\":null,"
+              "\"items\":[{\"name\":\"pen \\\"blue\\\"\",\"id\":12345678901,\"price\":1.5},"
+              "{\"name\":\"ink\",\"id\":2,\"price\":3.0}],"
+              "\"codes\":[1,-2],\"gift\":null,\"flags\":7}", json);
+
+    Order parsed;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct(json, parsed));
+    EXPECT_EQ(serializeStruct(parsed), json);
+}
+
+TEST(reflect, serialize_nested_in_writer) {
+    StringWriteStream os;
+    Writer writer(os);
+    writer.StartObject();
+    writer.Key("item");
+    writeStruct(writer, Item{"pen", 1, 0.5});
+    writer.Key("ids");
+    writeStruct(writer, std::vector<int>{1, 2});
+    writer.EndObject();
+    EXPECT_EQ("{\"item\":{\"name\":\"pen\",\"id\":1,\"price\":0.5},\"ids\":[1,2]}", os.getStringView());
+
+    // 根值之后未设置分隔符时不再写入
+    EXPECT_FALSE(writeStruct(writer, std::vector<int>{3}));
+    EXPECT_EQ("{\"item\":{\"name\":\"pen\",\"id\":1,\"price\":0.5},\"ids\":[1,2]}", os.getStringView());
+    writer.setRootSeparator("\n");
+    EXPECT_TRUE(writeStruct(writer, std::vector<int>{3}));
+    EXPECT_EQ("{\"item\":{\"name\":\"pen\",\"id\":1,\"price\":0.5},\"ids\":[1,2]}\n[3]", os.getStringView());
+}
+
+struct Counter {
+    uint64_t total = 0;
+    uint32_t small = 0;
+};
+
+MUDONG_JSON_REFLECT(Counter, total, small)
+
+TEST(reflect, serialize_uint64) {
+    // 超出int64范围的uint64按无符号输出
+    EXPECT_EQ("{\"total\":18446744073709551615,\"small\":4294967295}",
+              serializeStruct(Counter{UINT64_MAX, UINT32_MAX}));
+    EXPECT_EQ("{\"total\":9223372036854775808,\"small\":0}",
+              serializeStruct(Counter{uint64_t(INT64_MAX) + 1, 0}));
+    EXPECT_EQ("[0,9223372036854775807,18446744073709551615]",
+              serializeStruct(std::vector<uint64_t>{0, INT64_MAX, UINT64_MAX}));
+
+    Counter parsed;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("{\"total\":9223372036854775807,\"small\":1}", parsed));
+    EXPECT_EQ(uint64_t(INT64_MAX), parsed.total);
+}
+
+TEST(reflect, roundtrip_uint64) {
+    // 超出int64范围的整数经由Uint64()填入uint64_t成员，两个方向对称
+    Counter parsed;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct(serializeStruct(Counter{UINT64_MAX, 1}), parsed));
+    EXPECT_EQ(UINT64_MAX, parsed.total);
+    EXPECT_EQ(1u, parsed.small);
+    EXPECT_EQ("{\"total\":18446744073709551615,\"small\":1}", serializeStruct(parsed));
+
+    std::vector<uint64_t> values;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("[0,9223372036854775808,18446744073709551615]", values));
+    EXPECT_EQ((std::vector<uint64_t>{0, uint64_t(INT64_MAX) + 1, UINT64_MAX}), values);
+    EXPECT_EQ("[0,9223372036854775808,18446744073709551615]", serializeStruct(values));
+
+    std::optional<uint64_t> opt;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("18446744073709551615", opt));
+    EXPECT_EQ(UINT64_MAX, *opt);
+    double d = 0;
+    ASSERT_EQ(ParseError::PARSE_OK, parseStruct("18446744073709551615", d));
+    EXPECT_EQ(18446744073709551615.0, d);
+
+    // 有符号成员与更窄的成员不接受，超出uint64或为负时仍报错
+    int64_t i64 = 0;
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("9223372036854775808", i64));
+    EXPECT_EQ(ParseError::PARSE_USER_STOPPED, parseStruct("{\"small\":18446744073709551615}", parsed));
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, parseStruct("18446744073709551616", parsed.total));
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, parseStruct("-9223372036854775809", parsed.total));
+
+    // 不提供Uint64()的Handler行为不变
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_NUMBER_TOO_BIG, doc.parse("18446744073709551615"));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
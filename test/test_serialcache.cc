@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+#include "alloc_counter.hpp"
+#include "stringify.hpp"
+
+using namespace mudong::json;
+
+namespace {
+
+const char* kJson = "{\"meta\":{\"id\":1,\"tags\":[\"a\",\"b\"]},"
+                    "\"items\":[{\"price\":1.5,\"n\":2},{\"price\":3,\"n\":4}],"
+                    "\"name\":\"x\"}";
+
+} // anonymous namespace
+
+TEST(serialization_cache, unchanged) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+    EXPECT_FALSE(doc.hasSerializationCache());
+
+    doc.cacheSerialization(0);
+    const Value& root = doc;
+    EXPECT_TRUE(root.hasSerializationCache());
+    EXPECT_TRUE(root["meta"].hasSerializationCache());
+    EXPECT_TRUE(root["meta"]["tags"].hasSerializationCache());
+    EXPECT_TRUE(root["items"][1].hasSerializationCache());
+    EXPECT_EQ(kJson, stringify(doc));
+    EXPECT_EQ(std::string(kJson).size(), root.estimateSerializedSize());
+}
+
+TEST(serialization_cache, invalidate_path) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+    doc.cacheSerialization(0);
+
+    doc["items"][1]["price"].setDouble(4.5);
+    const Value& root = doc;
+    // 访问路径上的容器失效，其余保持
+    EXPECT_FALSE(root.hasSerializationCache());
+    EXPECT_FALSE(root["items"].hasSerializationCache());
+    EXPECT_FALSE(root["items"][1].hasSerializationCache());
+    EXPECT_TRUE(root["items"][0].hasSerializationCache());
+    EXPECT_TRUE(root["meta"].hasSerializationCache());
+
+    std::string expected = "{\"meta\":{\"id\":1,\"tags\":[\"a\",\"b\"]},"
+                           "\"items\":[{\"price\":1.5,\"n\":2},{\"price\":4.5,\"n\":4}],"
+                           "\"name\":\"x\"}";
+    EXPECT_EQ(expected, stringify(doc));
+
+    // 重新缓存后恢复
+    doc.cacheSerialization(0);
+    EXPECT_TRUE(root.hasSerializationCache());
+    EXPECT_TRUE(root["items"][1].hasSerializationCache());
+    EXPECT_EQ(expected, stringify(doc));
+}
+
+TEST(serialization_cache, mutations) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+    doc.cacheSerialization(0);
+
+    doc["meta"]["tags"].addValue(Value("c"));
+    doc["meta"].addMember("new", true);
+    auto iter = doc.findMember("name");
+    iter->value.setString("y");
+    EXPECT_EQ("{\"meta\":{\"id\":1,\"tags\":[\"a\",\"b\",\"c\"],\"new\":true},"
+              "\"items\":[{\"price\":1.5,\"n\":2},{\"price\":3,\"n\":4}],"
+              "\"name\":\"y\"}", stringify(doc));
+
+    doc.cacheSerialization(0);
+    for (auto it = doc.beginMember(); it != doc.endMember(); ++it) {
+        if (it->key.getStringView() == "name") it->value.setInt32(7);
+    }
+    EXPECT_FALSE(doc.hasSerializationCache());
+    EXPECT_EQ("{\"meta\":{\"id\":1,\"tags\":[\"a\",\"b\",\"c\"],\"new\":true},"
+              "\"items\":[{\"price\":1.5,\"n\":2},{\"price\":3,\"n\":4}],"
+              "\"name\":7}", stringify(doc));
+}
+
+TEST(serialization_cache, threshold_and_drop) {
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+    doc.cacheSerialization(30);
+    const Value& root = doc;
+    EXPECT_TRUE(root.hasSerializationCache());
+    EXPECT_FALSE(root["meta"].hasSerializationCache()); // 不足30字节
+    EXPECT_TRUE(root["items"].hasSerializationCache());
+    EXPECT_EQ(kJson, stringify(doc));
+
+    doc.dropSerializationCache();
+    EXPECT_FALSE(root.hasSerializationCache());
+    EXPECT_FALSE(root["items"].hasSerializationCache());
+    EXPECT_EQ(kJson, stringify(doc));
+
+    // 标量上调用无效果
+    Value scalar(1);
+    scalar.cacheSerialization(0);
+    EXPECT_FALSE(scalar.hasSerializationCache());
+}
+
+TEST(serialization_cache, other_handlers) {
+    // 不接受RawValue()的Handler照常遍历
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+    doc.cacheSerialization(0);
+    Document copy;
+    doc.writeTo(copy);
+    EXPECT_FALSE(copy.hasSerializationCache());
+    EXPECT_EQ(kJson, stringify(copy));
+}
+
+TEST(serialization_cache, nested_memory) {
+    // 嵌套depth层的对象，最内层是约100KB的数据；每层各存一份子树输出时占用约为depth倍
+    const int depth = 1000;
+    std::string payload(100 * 1024, 'x');
+    std::string json;
+    for (int i = 0; i < depth; i++) json += "{\"a\":";
+    json += "{\"payload\":\"" + payload + "\"}";
+    for (int i = 0; i < depth; i++) json += "}";
+
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    // 缓存的占用应与序列化一次相当，另加每个容器的少量记录
+    size_t writePeak;
+    {
+        alloc_counter::Scope scope;
+        stringify(doc);
+        writePeak = scope.peak();
+    }
+    {
+        alloc_counter::Scope scope;
+        doc.cacheSerialization(0);
+        EXPECT_LE(scope.peak(), writePeak + depth * 256);
+        EXPECT_LE(static_cast<size_t>(scope.growth()), writePeak + depth * 128);
+    }
+    EXPECT_EQ(json, stringify(doc));
+
+    // 修改外层后重新缓存：未修改的内层缓存移到新的输出，旧的输出被释放
+    {
+        alloc_counter::Scope scope;
+        doc["a"].addMember("b", 1);
+        doc.cacheSerialization(0);
+        EXPECT_LE(scope.growth(), static_cast<long>(depth * 64));
+        EXPECT_LE(scope.peak(), writePeak + depth * 256);
+    }
+    const Value& root = doc;
+    EXPECT_TRUE(root["a"]["a"].hasSerializationCache());
+    std::string expected = json;
+    expected.insert(expected.size() - 2, ",\"b\":1");
+    EXPECT_EQ(expected, stringify(doc));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include <Document.hpp>
+#include <Snapshot.hpp>
+#include <StringWriteStream.hpp>
+#include <FileWriteStream.hpp>
+#include <Writer.hpp>
+
+using namespace mudong::json;
+
+const char* kJson = "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"l\":12345678901,\"d\":1.5,"
+                    "\"s\":\"abc\",\"a\":[1,\"abc\",[]],\"o\":{\"z\":1,\"b\":{},\"m\":\"s\"}}";
+
+std::string makeSnapshot(const char* json) {
+    Document doc;
+    EXPECT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    StringWriteStream os;
+    SnapshotWriter::write(doc, os);
+    return os.take();
+}
+
+TEST(snapshot, query) {
+    std::string buffer = makeSnapshot(kJson);
+    Snapshot snapshot(buffer.data(), buffer.size());
+    ASSERT_TRUE(snapshot.valid());
+
+    SnapshotValue root = snapshot.root();
+    EXPECT_TRUE(root.isObject());
+    EXPECT_EQ(9u, root.getSize());
+    EXPECT_TRUE(root["n"].isNull());
+    EXPECT_FALSE(root["f"].getBool());
+    EXPECT_TRUE(root["t"].getBool());
+    EXPECT_EQ(123, root["i"].getInt32());
+    EXPECT_EQ(12345678901LL, root["l"].getInt64());
+    EXPECT_EQ(1.5, root["d"].getDouble());
+    EXPECT_EQ("abc", root["s"].getStringView());
+    EXPECT_STREQ("abc", root["s"].getCString());
+    EXPECT_EQ(3u, root["a"].getSize());
+    EXPECT_EQ("abc", root["a"][1].getStringView());
+    EXPECT_EQ("s", root["o"]["m"].getStringView());
+    EXPECT_TRUE(root.findMember("missing") == root.endMember());
+
+    std::string keys;
+    for (auto iter = root["o"].beginMember(); iter != root["o"].endMember(); ++iter)
+        keys += (*iter).key;
+    EXPECT_EQ("zbm", keys); // document order is preserved
+}
+
+TEST(snapshot, write_to) {
+    std::string buffer = makeSnapshot(kJson);
+    Snapshot snapshot(buffer.data(), buffer.size());
+    StringWriteStream os;
+    Writer writer(os);
+    snapshot.root().writeTo(writer);
+    EXPECT_EQ(kJson, os.getStringView());
+}
+
+TEST(snapshot, write_to_deep) {
+    // 写出不经过递归，深层快照不会使调用栈溢出
+    const size_t depth = 500000;
+    std::string json;
+    for (size_t i = 0; i < depth; i++) json += "[{\"k\":";
+    json += "1";
+    for (size_t i = 0; i < depth; i++) json += "},0]";
+    Document doc;
+    doc.setMaxDepth(2 * depth);
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+    StringWriteStream snapshotOs;
+    SnapshotWriter::write(doc, snapshotOs);
+    std::string buffer = snapshotOs.take();
+
+    Snapshot snapshot(buffer.data(), buffer.size());
+    ASSERT_TRUE(snapshot.valid());
+    StringWriteStream os;
+    Writer writer(os);
+    ASSERT_TRUE(snapshot.root().writeTo(writer));
+    EXPECT_EQ(json, os.getStringView());
+}
+
+TEST(snapshot, scalar_root) {
+    std::string buffer = makeSnapshot("\"hello\"");
+    Snapshot snapshot(buffer.data(), buffer.size());
+    ASSERT_TRUE(snapshot.valid());
+    EXPECT_EQ("hello", snapshot.root().getStringView());
+}
+
+TEST(snapshot, invalid) {
+    std::string buffer = makeSnapshot(kJson);
+    EXPECT_FALSE(Snapshot(buffer.data(), 8).valid());
+    buffer[0] = 'X';
+    EXPECT_FALSE(Snapshot(buffer.data(), buffer.size()).valid());
+
+    // 模拟字节序不同的机器写出的快照：标记按字节反转后不被接受
+    std::string swapped = makeSnapshot(kJson);
+    char* byteOrder = &swapped[offsetof(SnapshotHeader, byteOrder)];
+    std::reverse(byteOrder, byteOrder + sizeof(uint32_t));
+    EXPECT_FALSE(Snapshot(swapped.data(), swapped.size()).valid());
+}
+
+TEST(snapshot, mmap_file) {
+    char path[] = "/tmp/mudong-json-snapshot-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    FILE* output = fdopen(fd, "w");
+    {
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(kJson));
+        FileWriteStream os(output);
+        SnapshotWriter::write(doc, os);
+    }
+    fclose(output);
+
+    SnapshotFile file(path);
+    Snapshot snapshot = file.snapshot();
+    ASSERT_TRUE(snapshot.valid());
+    EXPECT_EQ(1, snapshot.root()["o"]["z"].getInt32());
+    unlink(path);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
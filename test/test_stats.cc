@@ -0,0 +1,98 @@
+#define MUDONG_JSON_ENABLE_STATS
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <Document.hpp>
+#include <ParseStats.hpp>
+
+using namespace mudong::json;
+
+TEST(parse_stats, counters) {
+    std::string json = "{\"a\":[1,2.5,true,null,\"x\\ny\"],\"b\":{\"c\":[[12345678901]]}} ";
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+
+    const ParseStats& stats = Reader::lastStats();
+    EXPECT_EQ(json.size(), stats.bytes);
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_NULL));
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_BOOL));
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_INT32));
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_INT64));
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_DOUBLE));
+    EXPECT_EQ(1u, stats.count(ValueType::TYPE_STRING));
+    EXPECT_EQ(3u, stats.count(ValueType::TYPE_ARRAY));
+    EXPECT_EQ(2u, stats.count(ValueType::TYPE_OBJECT));
+    EXPECT_EQ(0u, stats.count(ValueType::TYPE_RAW)); // 解析不会产生原始片段
+    EXPECT_EQ(3u, stats.keys);
+    EXPECT_EQ(3u + 3u, stats.stringBytes); // "x\ny" + a, b, c
+    EXPECT_EQ(1u, stats.escapes);
+    EXPECT_EQ(4u, stats.maxDepth);
+    EXPECT_GE(stats.allocations, 9u); // 5个容器节点 + 4个字符串节点(key与值)
+    EXPECT_GT(stats.allocatedBytes, 0u);
+    EXPECT_GE(stats.totalNanos, stats.handlerNanos);
+}
+
+TEST(parse_stats, reset_per_parse) {
+    Document doc1;
+    ASSERT_EQ(ParseError::PARSE_OK, doc1.parse("[[[[1]]]]"));
+    EXPECT_EQ(4u, Reader::lastStats().maxDepth);
+
+    Document doc2;
+    EXPECT_EQ(ParseError::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, doc2.parse("[1 2]"));
+    EXPECT_EQ(1u, Reader::lastStats().maxDepth);
+    EXPECT_EQ(1u, Reader::lastStats().count(ValueType::TYPE_INT32));
+}
+
+TEST(parse_stats, collector) {
+    ParseStatsCollector collector;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&collector, t]() {
+            for (int i = 0; i < 10; i++) {
+                Document doc;
+                std::string json(static_cast<size_t>(t + 1), '[');
+                json += std::string(static_cast<size_t>(t + 1), ']');
+                ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+                collector.add(Reader::lastStats());
+            }
+        });
+    }
+    for (auto& thread: threads) thread.join();
+
+    ParseStats total = collector.total();
+    EXPECT_EQ(40u, collector.parses());
+    EXPECT_EQ(4u, total.maxDepth);
+    EXPECT_EQ(10u * (1 + 2 + 3 + 4), total.count(ValueType::TYPE_ARRAY));
+    EXPECT_EQ(10u * 2 * (1 + 2 + 3 + 4), total.bytes);
+}
+
+TEST(parse_stats, actual_growth) {
+    // 追加元素按vector实际的容量变化记录
+    Value array(ValueType::TYPE_ARRAY);
+    ParseStats before = detail::activeStats();
+    uint64_t allocations = 0, bytes = 0;
+    for (int i = 0; i < 100; i++) {
+        size_t capacity = array.getArray().capacity();
+        array.addValue(Value(i));
+        if (array.getArray().capacity() != capacity) {
+            allocations++;
+            bytes += array.getArray().capacity() * sizeof(Value);
+        }
+    }
+    EXPECT_EQ(allocations, detail::activeStats().allocations - before.allocations);
+    EXPECT_EQ(bytes, detail::activeStats().allocatedBytes - before.allocatedBytes);
+
+    // 字符串缓冲区首次扩容计入统计，同一线程之后的解析复用其容量
+    std::string json = "[\"" + std::string(10000, 'x') + "\\n\"]";
+    std::thread([&json]() {
+        Document doc;
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+        ParseStats first = Reader::lastStats();
+        ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+        ParseStats second = Reader::lastStats();
+        EXPECT_EQ(first.allocations, second.allocations + 1);
+        EXPECT_GE(first.allocatedBytes - second.allocatedBytes, 10001u);
+    }).join();
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <Document.hpp>
+#include <StringWriteStream.hpp>
+#include <Writer.hpp>
+
+using namespace mudong::json;
+
+TEST(write_stream, reserve_commit) {
+    StringWriteStream os;
+    char* p = os.reserve(8);
+    std::memcpy(p, "abc", 3);
+    os.commit(3);
+    os.put('d');
+    os.put("ef");
+    EXPECT_EQ("abcdef", os.getStringView());
+    EXPECT_EQ(6u, os.size());
+}
+
+TEST(write_stream, take) {
+    StringWriteStream os(4);
+    os.put("hello world");
+    std::string s = os.take();
+    EXPECT_EQ("hello world", s);
+    EXPECT_EQ(0u, os.size());
+    os.put("again");
+    EXPECT_EQ("again", os.getStringView());
+}
+
+TEST(write_stream, take_without_copy) {
+    // 超出短字符串优化的长度，移交的是写入时使用的缓冲区本身
+    StringWriteStream os(1024);
+    os.put(std::string(1000, 'x'));
+    const char* data = os.getStringView().data();
+    std::string s = os.take();
+    EXPECT_EQ(data, s.data());
+    EXPECT_EQ(std::string(1000, 'x'), s);
+    EXPECT_EQ(0u, os.size());
+}
+
+TEST(write_stream, writer_escape) {
+    StringWriteStream os;
+    Writer writer(os);
+    writer.StartObject();
+    writer.Key("k\"ey");
+    writer.String(std::string_view("a\x01\n\"\\b", 6));
+    writer.Key("d");
+    writer.Double(1e100);
+    writer.EndObject();
+    EXPECT_EQ("{\"k\\\"ey\":\"a\\u0001\\n\\\"\\\\b\",\"d\":1e+100}", os.getStringView());
+}
+
+TEST(write_stream, estimate_serialized_size) {
+    const char* json = "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"l\":12345678901,"
+                       "\"d\":1.5,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":[]}}";
+    Document doc;
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(json));
+
+    size_t estimate = doc.estimateSerializedSize();
+    StringWriteStream os(estimate);
+    Writer writer(os);
+    doc.writeTo(writer);
+    EXPECT_GE(estimate, os.size());
+    EXPECT_EQ(json, os.take());
+
+    // 字符串按转义后的长度计算，不含数字时估计值即输出的大小
+    const char* escaped = "{\"k\\n\":[\"a\\u0001\\\"\",\"\\\\\\t\",\"plain\"]}";
+    ASSERT_EQ(ParseError::PARSE_OK, doc.parse(escaped));
+    EXPECT_EQ(std::string(escaped).size(), doc.estimateSerializedSize());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}